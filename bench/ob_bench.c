@@ -0,0 +1,85 @@
+/* the formatters are static, so the benchmark is compiled with their translation unit */
+#include "../src/asm_output.c"
+#include <time.h>
+
+#define BENCH_WORDS 8192  /* the lines of the largest .ob file */
+#define BENCH_ROUNDS 2000
+
+typedef void (*formatter_t)(char *out, uint32_t *words, int count, uint16_t line);
+
+/**
+ * @brief returns the time of a monotonic clock
+ *
+ * @return double the time in nanoseconds
+ */
+static double bench_now()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * @brief formats the words of a whole image again and again, in blocks of
+ * the size asm_output_format_range uses
+ *
+ * @param formatter the formatter
+ * @param out the formatted lines
+ * @param words the words
+ * @return double the time per word in nanoseconds
+ */
+static double bench_run(formatter_t formatter, char *out, uint32_t *words)
+{
+    double start = bench_now();
+    int round;
+    int block;
+
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for (block = 0; block < BENCH_WORDS; block += OB_BLOCK_WORDS)
+        {
+            formatter(out + block * OB_LINE_LENGTH, words + block, OB_BLOCK_WORDS, START_IC_VALUE + block);
+        }
+    }
+
+    return (bench_now() - start) / ((double)BENCH_ROUNDS * BENCH_WORDS);
+}
+
+/**
+ * @brief compares the SSSE3 formatter of the .ob lines with the scalar one
+ * on the same words, and checks that they give the same lines
+ */
+int main()
+{
+    static uint32_t words[BENCH_WORDS];
+    static char scalar[BENCH_WORDS * OB_LINE_LENGTH];
+    double scalar_time;
+    int word;
+
+    srand(1);
+    for (word = 0; word < BENCH_WORDS; word++)
+    {
+        words[word] = ((uint32_t)rand() << 8 ^ (uint32_t)rand()) & 0xFFFFF;
+    }
+    scalar_time = bench_run(asm_output_format_lines_scalar, scalar, words);
+    printf("scalar: %6.2f ns/word\n", scalar_time);
+
+#ifdef ASM_OUTPUT_SSSE3
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        static char vector[BENCH_WORDS * OB_LINE_LENGTH];
+        double vector_time = bench_run(asm_output_format_lines_ssse3, vector, words);
+
+        printf("ssse3:  %6.2f ns/word (%.2fx)\n", vector_time, scalar_time / vector_time);
+        if (memcmp(scalar, vector, sizeof(scalar)) != 0)
+        {
+            printf("the formatters give different lines\n");
+            return 1;
+        }
+        return 0;
+    }
+#endif
+    printf("ssse3:  not supported\n");
+    return 0;
+}
\ No newline at end of file
@@ -9,6 +9,7 @@ typedef enum {
 
 #include "asm_language.h"
 #include "errors.h"
+#include "expression.h"
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
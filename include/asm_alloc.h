@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* the parts of the assembler whose allocations are counted apart */
+typedef enum
+{
+    ALLOC_LABELS,   /* labels, their tables and journals */
+    ALLOC_TREE,     /* avl tree nodes */
+    ALLOC_LIST,     /* linked list nodes */
+    ALLOC_MACRO,    /* macros, their lines, includes and definitions */
+    ALLOC_MEMORY,   /* memory images */
+    ALLOC_PASSES,   /* lines, chunks, string pools and the pipeline */
+    ALLOC_OUTPUT,   /* .ob, .map, .sym, .rel and archive files */
+    ALLOC_IO,       /* io_uring files and paths */
+    ALLOC_SERVICE,  /* the daemon, the language server and the command line tools */
+    NUMBER_OF_SUBSYSTEMS /* Must be last */
+} alloc_subsystem_e;
+
+/**
+ * @brief allocates a block for a subsystem (as malloc). Every allocation
+ * of src/ goes through asm_alloc, so it can be counted and made to fail.
+ * An allocation that fails reports "Memory allocation failed" and exits
+ * with a failure status, so the asserts of the callers only document that
+ * the block isn't NULL. The buffers that the C library allocates
+ * (open_memstream) are freed with free
+ * @file asm_alloc.h
+ *
+ * @param subsystem the subsystem the block is counted for
+ * @param size the size of the block
+ * @return void* the block
+ */
+void *asm_alloc_malloc(alloc_subsystem_e subsystem, size_t size);
+
+/**
+ * @brief allocates a zeroed array for a subsystem (as calloc)
+ * @file asm_alloc.h
+ *
+ * @param subsystem the subsystem the block is counted for
+ * @param count the number of elements
+ * @param size the size of an element
+ * @return void* the block
+ */
+void *asm_alloc_calloc(alloc_subsystem_e subsystem, size_t count, size_t size);
+
+/**
+ * @brief resizes a block that was allocated by asm_alloc (as realloc). The
+ * block is counted for the given subsystem from now on
+ * @file asm_alloc.h
+ *
+ * @param subsystem the subsystem the block is counted for
+ * @param pointer the block (NULL allocates a new one)
+ * @param size the new size of the block
+ * @return void* the block
+ */
+void *asm_alloc_realloc(alloc_subsystem_e subsystem, void *pointer, size_t size);
+
+/**
+ * @brief frees a block that was allocated by asm_alloc (NULL is ignored)
+ * @file asm_alloc.h
+ *
+ * @param pointer the block
+ */
+void asm_alloc_free(void *pointer);
+
+/**
+ * @brief makes the given allocation fail (counting from when it was
+ * called), to test that the assembler stops cleanly when it runs out of
+ * memory
+ * @file asm_alloc.h
+ *
+ * @param allocation the number of the allocation that fails (0 fails none)
+ */
+void asm_alloc_fail_at(unsigned long allocation);
+
+/**
+ * @brief starts counting the allocations of a file. The peaks are restarted
+ * from the bytes that are allocated now
+ * @file asm_alloc.h
+ */
+void asm_alloc_start_file();
+
+/**
+ * @brief prints the allocations since asm_alloc_start_file, in total and
+ * for every subsystem that allocated: the number of allocations, the bytes
+ * they allocated, the peak of the allocated bytes and the bytes that are
+ * still allocated (the instances that are kept for the next files are
+ * counted for the file that created them)
+ * @file asm_alloc.h
+ *
+ * @param out the output
+ * @param file the name of the file
+ */
+void asm_alloc_report(FILE *out, char *file);
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "asm_symbols.h"
+#include "asm_io.h"
+#include "label.h"
+#include "asm_alloc.h"
+
+typedef struct asm_archive_t asm_archive_t;
+
+/**
+ * @brief packs assembled modules (their .ob, .ent and .ext files) into an
+ * archive with a directory of the symbols they export. Every number is a
+ * little-endian 32-bit word: "AARC", the version, the number of members,
+ * the offset and the size of the directory and the size of the names.
+ * Then the name offset, the data offset and the size of every member, the
+ * names (each ending with '\0') and the data of the members, every part
+ * starting at a multiple of 8. The directory is a .sym file (see
+ * asm_symbols.h) of the entry labels, in which the value is the address
+ * and the references field holds the index of the .ob member of the module
+ * instead of a count of references. A
+ * symbol that several modules export is kept for the first of them
+ * @file asm_archive.h
+ *
+ * @param path the path of the archive
+ * @param modules the modules (without a suffix, as in the command line)
+ * @param count the number of modules
+ * @param error returns the reason the archive wasn't written
+ * @return bool true if the archive was written
+ */
+bool asm_archive_create(char *path, char **modules, int count, char **error);
+
+/**
+ * @brief maps an archive, only its header is read until a member or a
+ * symbol is needed
+ * @file asm_archive.h
+ *
+ * @param path the path of the archive
+ * @return asm_archive_t* the archive (NULL if the file isn't a valid archive)
+ */
+asm_archive_t *asm_archive_open(char *path);
+
+/**
+ * @brief returns the number of members of an archive
+ * @file asm_archive.h
+ *
+ * @param archive the archive
+ * @return int the number of members
+ */
+int asm_archive_get_count(asm_archive_t *archive);
+
+/**
+ * @brief returns a member of an archive, in place
+ * @file asm_archive.h
+ *
+ * @param archive the archive
+ * @param member the index of the member
+ * @param name returns the name of the member
+ * @param data returns the content of the member (valid until the archive
+ * is closed)
+ * @param size returns the size of the member
+ */
+void asm_archive_get_member(asm_archive_t *archive, int member, char **name, unsigned char **data, size_t *size);
+
+/**
+ * @brief finds the module that exports a symbol through the directory
+ * @file asm_archive.h
+ *
+ * @param archive the archive
+ * @param symbol the symbol
+ * @param member returns the index of the .ob member of the module
+ * @param address returns the address of the symbol
+ * @return bool false if no member exports the symbol
+ */
+bool asm_archive_find(asm_archive_t *archive, char *symbol, int *member, long *address);
+
+/**
+ * @brief unmaps an archive
+ * @file asm_archive.h
+ *
+ * @param archive the archive
+ */
+void asm_archive_close(asm_archive_t *archive);
\ No newline at end of file
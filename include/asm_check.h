@@ -0,0 +1,18 @@
+#pragma once
+
+#include <assert.h>
+
+/**
+ * @brief checks an invariant of an inner loop. The values are validated
+ * where they enter the module, so the check is compiled out of the release
+ * build (make release defines ASM_RELEASE). Conditions that a bad file can
+ * cause are reported as errors instead (see errors.h)
+ * @file asm_check.h
+ *
+ * @param condition the invariant
+ */
+#ifdef ASM_RELEASE
+#define ASM_INVARIANT(condition) ((void)0)
+#else
+#define ASM_INVARIANT(condition) assert(condition)
+#endif
\ No newline at end of file
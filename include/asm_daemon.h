@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "assembler.h"
+#include "asm_alloc.h"
+
+#define ASM_DAEMON_REQUEST_LENGTH 4096
+
+/**
+ * @brief runs the assembler as a long-running daemon. The memory and the
+ * labels table stay allocated between builds, every given file is
+ * reassembled as soon as its .as file changes (encoding again only the
+ * lines that changed since its previous build), and clients can request
+ * builds over a local UNIX socket with one request line per connection:
+ * "build <file>", "watch <file>" or "shutdown". The daemon replies with the
+ * build's diagnostics followed by "ok" or "failed <errors count>"
+ * @file asm_daemon.h
+ *
+ * @param socket_path the path of the UNIX socket the daemon listens on
+ * @param files_count the number of files to watch
+ * @param files the files to watch (without the .as suffix, as in the
+ * command line)
+ * @return int 0 when the daemon was shut down, else -1
+ */
+int asm_daemon_run(char *socket_path, int files_count, char *files[]);
+
+/**
+ * @brief sends a single request line to a running daemon and copies its
+ * reply to the given output
+ * @file asm_daemon.h
+ *
+ * @param socket_path the path of the daemon's UNIX socket
+ * @param request the request line (without the new line)
+ * @param output the output for the daemon's reply
+ * @return int 0 if the daemon replied "ok", else -1
+ */
+int asm_daemon_request(char *socket_path, char *request, FILE *output);
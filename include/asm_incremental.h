@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "errors.h"
+#include "macro.h"
+#include "labels_table.h"
+#include "asm_memory.h"
+#include "asm_output.h"
+#include "asm_alloc.h"
+
+typedef struct asm_incremental_t asm_incremental_t;
+
+/**
+ * @brief creates the state of an incremental reassembly of a single file.
+ * The state keeps the lines of the previous run (after their macros were
+ * opened), the words each of them encoded, their label changes (as journals)
+ * and the .ob file that was written
+ * @file asm_incremental.h
+ *
+ * @return asm_incremental_t* the state
+ */
+asm_incremental_t *asm_incremental_create();
+
+/**
+ * @brief writes the am file and fills the memory and the labels table as
+ * the first pass would, encoding only the lines that changed since the
+ * previous run. The words of the unchanged lines before and after the
+ * changed span are copied in bulk (shifted to their new addresses) and the
+ * labels table is rebuilt from the lines' journals
+ * @file asm_incremental.h
+ *
+ * @param state the state
+ * @param as_file the assembly file
+ * @param am_file the am file (written)
+ * @param labels_table an empty labels table
+ * @param memory an empty memory
+ * @return bool true if the file has no errors. Else the memory and the
+ * labels table are left empty, so the am file can be analyzed again to
+ * report the errors
+ */
+bool asm_incremental_first_pass(asm_incremental_t *state, FILE *as_file, FILE *am_file, labels_table_t *labels_table, memory_t *memory);
+
+/**
+ * @brief writes the .ob file of the memory, rewriting only the words that
+ * differ from the previous run (when the file wasn't modified since)
+ * @file asm_incremental.h
+ *
+ * @param state the state
+ * @param path the .ob file path
+ * @param memory the memory (after the labels were inserted to it)
+ */
+void asm_incremental_write_ob(asm_incremental_t *state, char *path, memory_t *memory);
+
+/**
+ * @brief destroys the state
+ * @file asm_incremental.h
+ *
+ * @param state the state
+ */
+void asm_incremental_destroy(asm_incremental_t *state);
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "asm_alloc.h"
+
+#define ASM_IO_PREFETCH_WINDOW 16
+
+typedef struct asm_io_stats_t
+{
+    unsigned int written;   /* outputs whose content changed */
+    unsigned int unchanged; /* outputs that already had the same content */
+    unsigned int removed;   /* outputs that existed and were removed */
+} asm_io_stats_t;
+
+/**
+ * @brief chooses the file I/O backend. With io_uring, sources can be read
+ * ahead and outputs are written, closed and removed in batches that are
+ * submitted together while the next files are assembled. Without it (or
+ * when the kernel doesn't support it) the sources are read with stdio and
+ * the outputs are written as soon as they are closed
+ * @file asm_io.h
+ *
+ * @param use_uring should io_uring be used if it is available
+ * @return bool true if io_uring is used
+ */
+bool asm_io_init(bool use_uring);
+
+/**
+ * @brief starts reading a file that will be opened for reading soon
+ * @file asm_io.h
+ *
+ * @param path the file path
+ */
+void asm_io_prefetch(char *path);
+
+/**
+ * @brief opens a file for reading ("r") or for writing ("w"), like fopen
+ * @file asm_io.h
+ *
+ * @param path the file path
+ * @param mode "r" or "w"
+ * @return FILE* the opened file (NULL if it can't be opened)
+ */
+FILE *asm_io_open(char *path, char *mode);
+
+/**
+ * @brief closes a file that was opened with asm_io_open. An output is
+ * kept in memory until it is closed; it is then compared with the existing
+ * file and, only if it differs, written to a temporary file that is renamed
+ * to the output path (so the output is never partially written and an
+ * unchanged output keeps its modification time). With io_uring, the content
+ * may reach the disk only on the next asm_io_flush
+ * @file asm_io.h
+ *
+ * @param file the file
+ */
+void asm_io_close(FILE *file);
+
+/**
+ * @brief closes an output that was opened with asm_io_open and makes sure
+ * it doesn't remain on the disk
+ * @file asm_io.h
+ *
+ * @param file the file
+ * @param path the file path
+ */
+void asm_io_discard(FILE *file, char *path);
+
+/**
+ * @brief creates an output that is written at given offsets (with pwrite)
+ * rather than through a stream. Until it is closed with
+ * asm_io_close_descriptor, the content is in a temporary file next to it
+ * @file asm_io.h
+ *
+ * @param path the file path
+ * @return int the file descriptor (-1 if it can't be created)
+ */
+int asm_io_open_descriptor(char *path);
+
+/**
+ * @brief closes an output that was opened with asm_io_open_descriptor. A
+ * complete output is renamed to the file unless the file already has the
+ * same content (like asm_io_close), an incomplete one is removed
+ * @file asm_io.h
+ *
+ * @param fd the file descriptor
+ * @param is_complete was all of the content written
+ * @return bool true if the file has the content
+ */
+bool asm_io_close_descriptor(int fd, bool is_complete);
+
+/**
+ * @brief removes a file (if it exists)
+ * @file asm_io.h
+ *
+ * @param path the file path
+ */
+void asm_io_remove(char *path);
+
+/**
+ * @brief returns how many outputs were written, unchanged or removed
+ * @file asm_io.h
+ *
+ * @return asm_io_stats_t the statistics
+ */
+asm_io_stats_t asm_io_get_stats();
+
+/**
+ * @brief waits until all of the outputs and removals reached the disk
+ * @file asm_io.h
+ */
+void asm_io_flush();
+
+/**
+ * @brief flushes and releases the backend
+ * @file asm_io.h
+ */
+void asm_io_destroy();
\ No newline at end of file
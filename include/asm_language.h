@@ -4,50 +4,11 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <inttypes.h>
+#include "asm_check.h"
 #include "argument.h"
 
-typedef enum
-{
-    INVALID_ASM_WORD,
-    MOV,
-    CMP,
-    ADD,
-    SUB,
-    LEA,
-    CLR,
-    NOT,
-    INC,
-    DEC,
-    JMP,
-    BNE,
-    JSR,
-    RED,
-    PRN,
-    RTS,
-    STOP,
-    R0,
-    R1,
-    R2,
-    R3,
-    R4,
-    R5,
-    R6,
-    R7,
-    R8,
-    R9,
-    R10,
-    R11,
-    R12,
-    R13,
-    R14,
-    R15
-} asm_word_e;
-
-/**
- * @brief initialize the assembly language data
- * @file asm_language.h
- */
-void asm_language_init();
+/* the instructions and the registers are generated from isa/asm.isa by the makefile */
+#include "asm_isa.h"
 
 /**
  * @brief checks if a string is an assembly command
@@ -130,4 +91,14 @@ uint8_t asm_language_get_register_num(asm_word_e _register);
  * @param instruction assembly instruction
  * @return assembly instruction's number of arguments
  */
-uint8_t asm_language_get_instruction_args_num(asm_word_e instruction);
\ No newline at end of file
+uint8_t asm_language_get_instruction_args_num(asm_word_e instruction);
+
+/**
+ * @brief finds the assembly instruction with the given opcode and funct
+ * @file asm_language.h
+ *
+ * @param opcode the opcode
+ * @param funct the funct (0 for the instructions that don't have one)
+ * @return asm_word_e the instruction (INVALID_ASM_WORD if there isn't one)
+ */
+asm_word_e asm_language_get_instruction(uint8_t opcode, uint8_t funct);
\ No newline at end of file
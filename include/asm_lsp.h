@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "assembler.h"
+#include "json.h"
+#include "asm_alloc.h"
+
+/**
+ * @brief runs a language server over stdin/stdout (JSON-RPC with
+ * Content-Length headers). Every open document keeps its lines after the
+ * macros were opened, the analysis of each of these lines (its errors, its
+ * words count and a journal of its label changes) and a labels table. An
+ * edit re-analyzes only the lines whose text changed; the labels table is
+ * then rebuilt by replaying the lines' journals, and the diagnostics
+ * (including undefined and multiply defined labels) are published
+ * @file asm_lsp.h
+ *
+ * @return int 0 if the client sent "shutdown" before "exit", else 1
+ */
+int asm_lsp_run();
\ No newline at end of file
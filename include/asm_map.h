@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "macro.h"
+#include "asm_alloc.h"
+
+typedef struct asm_map_t asm_map_t;
+
+/**
+ * @brief creates an empty map from the addresses of an object file to the
+ * lines of its source
+ * @file asm_map.h
+ *
+ * @param source the name of the source file
+ * @return asm_map_t* the map
+ */
+asm_map_t *asm_map_create(char *source);
+
+/**
+ * @brief adds the range of words that starts at the given address. The
+ * range ends where the next range starts, so the ranges are added in the
+ * order of their addresses. A range that comes from the same lines as the
+ * range before it extends that range
+ * @file asm_map.h
+ *
+ * @param map the map
+ * @param address the address of the first word of the range
+ * @param source_line the line of the source the words came from
+ * @param origin how the words got to that line (see line_origin_e)
+ * @param file the file their text was read from (NULL for the source)
+ * @param file_line the line in that file
+ */
+void asm_map_add(asm_map_t *map, int address, unsigned int source_line, line_origin_e origin, char *file, unsigned int file_line);
+
+/**
+ * @brief writes the map as a .map file: "AMAP", a version byte and then
+ * variable-length numbers (7 bits per byte, the last byte of a number has
+ * its high bit cleared): the number of files and the length and the name
+ * of every file (the first is the source), the first and the end address,
+ * the number of ranges and then every range as the distance from the start
+ * of the previous range, its change of source line (zigzag encoded,
+ * shifted left by 2 above the origin), the index of its file and its
+ * change of line in that file (zigzag encoded)
+ * @file asm_map.h
+ *
+ * @param map_file the .map file
+ * @param map the map
+ * @param end the address after the last word
+ */
+void asm_map_write(FILE *map_file, asm_map_t *map, int end);
+
+/**
+ * @brief reads a .map file
+ * @file asm_map.h
+ *
+ * @param map_file the .map file
+ * @return asm_map_t* the map (NULL if the file isn't a valid .map file)
+ */
+asm_map_t *asm_map_read(FILE *map_file);
+
+/**
+ * @brief finds the source line of an address with a binary search over the
+ * ranges
+ * @file asm_map.h
+ *
+ * @param map the map
+ * @param address the address
+ * @param source returns the name of the source file (owned by the map)
+ * @param source_line returns the line in the source
+ * @param origin returns how the word got to that line
+ * @param file returns the file the text of the word's line was read from
+ * (owned by the map, the source itself for the lines of the source)
+ * @param file_line returns the line in that file
+ * @return bool false if the address isn't in the object file
+ */
+bool asm_map_lookup(asm_map_t *map, int address, char **source, unsigned int *source_line, line_origin_e *origin,
+                    char **file, unsigned int *file_line);
+
+/**
+ * @brief frees a map
+ * @file asm_map.h
+ *
+ * @param map the map
+ */
+void asm_map_destroy(asm_map_t *map);
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include "asm_check.h"
+#include "asm_alloc.h"
 
 #define START_IC_VALUE 100
 
@@ -24,6 +27,16 @@ typedef struct memory_t memory_t;
  */
 memory_t *asm_memory_get_instance();
 
+/**
+ * @brief replaces the asm memory instance of the calling thread (NULL makes
+ * the next asm_memory_get_instance create a new one)
+ * @file asm_memory.h
+ *
+ * @param asm_memory the new instance
+ * @return memory_t* the previous instance
+ */
+memory_t *asm_memory_set_instance(memory_t *asm_memory);
+
 /**
  * @brief gets the number of code words pushed
  * @file asm_memory.h
@@ -43,7 +56,7 @@ uint16_t asm_memory_get_ic(memory_t *asm_memory);
 uint16_t asm_memory_get_dc(memory_t *asm_memory);
 
 /**
- * @brief gets the number of words pushed
+ * @brief gets the number of words pushed and reserved
  * @file asm_memory.h
  *
  * @param asm_memory asm memory
@@ -51,6 +64,35 @@ uint16_t asm_memory_get_dc(memory_t *asm_memory);
  */
 uint16_t asm_memory_get_pc(memory_t *asm_memory);
 
+/**
+ * @brief returns the bss counter (the words that were reserved after the
+ * data, they are a part of the pc but aren't stored)
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ * @return uint16_t bss counter
+ */
+uint16_t asm_memory_get_bss(memory_t *asm_memory);
+
+/**
+ * @brief checks if words were dropped because the memory was full (the
+ * words that don't fit are dropped until the memory is reset)
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ * @return bool true if the memory is full
+ */
+bool asm_memory_is_full(memory_t *asm_memory);
+
+/**
+ * @brief reserves words after the data without storing them
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ * @param count the number of reserved words
+ */
+void asm_memory_reserve(memory_t *asm_memory, uint16_t count);
+
 /**
  * @brief push a 16-bit code word to the memory
  * @file asm_memory.h
@@ -100,6 +142,52 @@ uint32_t asm_memory_get_data(memory_t *asm_memory, uint16_t location);
  */
 void asm_memory_rewrite_code(memory_t *asm_memory, uint16_t code_word, word_ending_e ending, uint16_t location);
 
+/**
+ * @brief rewrites a 20-bit data word
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ * @param word a 16-bit word
+ * @param ending a 4-bit word ending
+ * @param location the word's location in the data (its dc)
+ */
+void asm_memory_rewrite_data(memory_t *asm_memory, uint16_t data_word, word_ending_e ending, uint16_t location);
+
+/**
+ * @brief pushes all of the code and data words of the source memory (and
+ * adds its reserved words), as if they were pushed to the given memory
+ * after its own words
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ * @param source the memory whose words are appended
+ */
+void asm_memory_append(memory_t *asm_memory, memory_t *source);
+
+/**
+ * @brief pushes a range of the code words and a range of the data words of
+ * the source memory, as if they were pushed to the given memory after its
+ * own words
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ * @param source the memory whose words are appended
+ * @param ic_start the first code word of the range (as in asm_memory_get_code)
+ * @param ic_count the number of code words
+ * @param dc_start the first data word of the range (as in asm_memory_get_data)
+ * @param dc_count the number of data words
+ */
+void asm_memory_append_range(memory_t *asm_memory, memory_t *source, uint16_t ic_start, uint16_t ic_count, uint16_t dc_start, uint16_t dc_count);
+
+/**
+ * @brief empties an asm memory so it can be reused for another file
+ * without allocating it again
+ * @file asm_memory.h
+ *
+ * @param asm_memory asm memory
+ */
+void asm_memory_reset(memory_t *asm_memory);
+
 /**
  * @brief destroys an asm memory
  * @file asm_memory.h
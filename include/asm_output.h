@@ -1,19 +1,22 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "asm_language.h"
 #include "label.h"
 #include "argument.h"
 #include "asm_memory.h"
+#include "asm_alloc.h"
 
 /**
- * @brief writes the label information to the extern file in the
- * required format
+ * @brief writes a single reference to an extern label to the extern file
+ * in the required format
  * 
  * @param ext_file the .ext file 
- * @param label the label
+ * @param symbol the label name
+ * @param location the ic of the reference
  */
-void asm_output_extern_label(FILE *ext_file, label_t *label);
+void asm_output_extern_reference(FILE *ext_file, char *symbol, int location);
 
 /**
  * @brief writes the label information to the entry file in the
@@ -30,4 +33,52 @@ void asm_output_entry_label(FILE *ent_file, label_t *label);
  * @param ob_file an object file
  * @param memory an asm memory
  */
-void asm_output_ob_file(FILE *ob_file, memory_t *memory);
\ No newline at end of file
+void asm_output_ob_file(FILE *ob_file, memory_t *memory);
+
+/**
+ * @brief writes an object file by splitting its lines into ranges that are
+ * formatted and written in parallel. Every line has the same width, so the
+ * file is allocated at its final size and each range is written at its own
+ * offset. The file is written through asm_io (see asm_io_open_descriptor),
+ * so an unchanged file isn't replaced. An image smaller than a range per
+ * thread uses fewer threads
+ * 
+ * @param path the path of the object file
+ * @param memory an asm memory
+ * @param threads the maximal number of threads
+ * @return bool true if the file was written
+ */
+bool asm_output_ob_file_parallel(char *path, memory_t *memory, int threads);
+
+/**
+ * @brief writes words as the lines of an object file (without its header)
+ * 
+ * @param ob_file an object file
+ * @param words binary 20-bit words
+ * @param count the number of words
+ * @param line the address of the first word
+ */
+void asm_output_ob_words(FILE *ob_file, uint32_t *words, int count, uint16_t line);
+
+/**
+ * @brief prints a relocation file: the number of labels in the code and
+ * then the location of the base word of every label (its offset word
+ * follows it), relative to the first word of the code. The expression
+ * words that move with the labels follow (see
+ * labels_table_write_relocations)
+ * 
+ * @param rel_file a relocation file
+ * @param memory an asm memory
+ */
+void asm_output_rel_file(FILE *rel_file, memory_t *memory);
+
+/**
+ * @brief writes an expression word that moves with the labels to the
+ * relocation file: its segment (CODE or DATA) and its location, relative
+ * to the first word of the segment
+ * 
+ * @param rel_file a relocation file
+ * @param location the ic or the dc of the word
+ * @param is_data is the word in the data
+ */
+void asm_output_relocatable_expression(FILE *rel_file, uint16_t location, bool is_data);
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include "asm_language.h"
+#include "asm_memory.h"
+#include "label.h"
+#include "asm_alloc.h"
+
+/**
+ * @brief finds the instructions that don't change the result of the
+ * program and removes their lines, so the lines can be analyzed again with
+ * the labels and the expressions at their new addresses. Removes:
+ * mov rX, rX / add #0, X and sub #0, X / a jmp to the instruction right
+ * after it / a clr rX right before a clr, mov or lea that overwrites rX
+ * without reading it. A removed line is left empty (so the lines keep their
+ * numbers) and its label is moved to the next instruction. An instruction
+ * whose label can't be moved is kept
+ * @file asm_peephole.h
+ *
+ * @param lines the lines of the am file
+ * @param lines_count the number of lines
+ * @param line_pc the ic and the dc before every line (and after the last line)
+ * @param memory the code of the lines, with the labels inserted
+ * @return int the number of removed instructions
+ */
+int asm_peephole_optimize(char (*lines)[LINE_LENGTH], int lines_count, uint16_t (*line_pc)[2], memory_t *memory);
\ No newline at end of file
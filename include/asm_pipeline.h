@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "macro.h"
+#include "asm_alloc.h"
+
+#define PIPELINE_RING_SIZE 256
+
+typedef struct asm_pipeline_task_t asm_pipeline_task_t;
+
+/**
+ * @brief opens the macros of the given file on a separate thread and passes
+ * every opened line to the handler on the calling thread, through a bounded
+ * single-producer/single-consumer ring. Returns once the whole file was
+ * handled
+ * @file asm_pipeline.h
+ *
+ * @param current_file the original file that is being read
+ * @param am_file the file the opened lines are also written to (may be NULL)
+ * @param handler the handler that receives the lines
+ * @param context the context given to the handler
+ */
+void asm_pipeline_expand(FILE *current_file, FILE *am_file, macro_line_handler_t handler, void *context);
+
+/**
+ * @brief runs the given task on a separate thread
+ * @file asm_pipeline.h
+ *
+ * @param task the task
+ * @param argument the argument given to the task
+ * @return asm_pipeline_task_t* the running task
+ */
+asm_pipeline_task_t *asm_pipeline_start_task(void (*task)(void*), void *argument);
+
+/**
+ * @brief waits for a task to end and frees it
+ * @file asm_pipeline.h
+ *
+ * @param task the running task
+ */
+void asm_pipeline_join_task(asm_pipeline_task_t *task);
\ No newline at end of file
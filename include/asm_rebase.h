@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "asm_output.h"
+#include "asm_io.h"
+#include "asm_alloc.h"
+
+/**
+ * @brief moves an assembled program to another load address without
+ * assembling it again. The .ob file is read in a single pass: every line
+ * gets its new address, the base and offset words of every label that
+ * the .rel file lists are computed again for the label's new address and
+ * the expression words it lists (the labels' addresses plus an absolute
+ * value) are moved as far as the labels. The addresses of the .ent and
+ * .ext files are moved too
+ * @file asm_rebase.h
+ *
+ * @param file the file (without a suffix, as in the command line)
+ * @param start the new address of the first word
+ * @param error returns the reason the file wasn't rebased
+ * @return bool true if the .ob file was rebased
+ */
+bool asm_rebase_file(char *file, int start, char **error);
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "asm_alloc.h"
+
+typedef struct asm_symbols_t asm_symbols_t;
+typedef struct asm_symbol_index_t asm_symbol_index_t;
+
+/* a symbol of a .sym file */
+typedef struct asm_symbol_t
+{
+    char *name;              /* points into the index */
+    long value;              /* the address of a label or the value of a constant */
+    int attributes;          /* the flags of label.h */
+    unsigned int references; /* the number of words that refer to the label (the index of the
+                              * module's .ob member in an archive directory, see asm_archive.h) */
+} asm_symbol_t;
+
+/**
+ * @brief creates an empty set of symbols to be written as a .sym file
+ * @file asm_symbols.h
+ *
+ * @return asm_symbols_t* the symbols
+ */
+asm_symbols_t *asm_symbols_create();
+
+/**
+ * @brief adds a symbol (the names are expected to be different)
+ * @file asm_symbols.h
+ *
+ * @param symbols the symbols
+ * @param name the name of the symbol
+ * @param value the address of a label or the value of a constant
+ * @param attributes the flags of label.h
+ * @param references the number of words that refer to the label
+ */
+void asm_symbols_add(asm_symbols_t *symbols, char *name, long value, int attributes, unsigned int references);
+
+/**
+ * @brief writes the symbols as a .sym file, a table that is looked up
+ * through a minimal perfect hash, so the file can be mapped and queried
+ * without being parsed. Every number is a little-endian 32-bit word:
+ * "ASYM", the version, the number of symbols (n), the number of buckets,
+ * the seed of the buckets and the size of the names. Then the displacement
+ * of every bucket, n entries (the offset of the name, the value, the
+ * attributes and the references) and the names, each ending with '\0'.
+ * The entry of a name is (hash(name, seed + (displacement + 1) *
+ * 0x9E3779B9) mod n), where the displacement is that of the bucket
+ * (hash(name, seed) mod buckets)
+ * @file asm_symbols.h
+ *
+ * @param sym_file the .sym file
+ * @param symbols the symbols
+ */
+void asm_symbols_write(FILE *sym_file, asm_symbols_t *symbols);
+
+/**
+ * @brief frees the symbols
+ * @file asm_symbols.h
+ *
+ * @param symbols the symbols
+ */
+void asm_symbols_destroy(asm_symbols_t *symbols);
+
+/**
+ * @brief maps a .sym file
+ * @file asm_symbols.h
+ *
+ * @param path the path of the .sym file
+ * @return asm_symbol_index_t* the index (NULL if the file isn't a valid
+ * .sym file)
+ */
+asm_symbol_index_t *asm_symbol_index_open(char *path);
+
+/**
+ * @brief reads a .sym file that is already in memory (a part of another
+ * file)
+ * @file asm_symbols.h
+ *
+ * @param data the content of the .sym file (kept by the caller until the
+ * index is closed)
+ * @param size the size of the .sym file
+ * @return asm_symbol_index_t* the index (NULL if the content isn't a valid
+ * .sym file)
+ */
+asm_symbol_index_t *asm_symbol_index_view(unsigned char *data, size_t size);
+
+/**
+ * @brief returns the number of symbols of an index
+ * @file asm_symbols.h
+ *
+ * @param index the index
+ * @return int the number of symbols
+ */
+int asm_symbol_index_get_count(asm_symbol_index_t *index);
+
+/**
+ * @brief returns a symbol by its position in the file
+ * @file asm_symbols.h
+ *
+ * @param index the index
+ * @param position the position (between 0 and the number of symbols)
+ * @param symbol returns the symbol
+ */
+void asm_symbol_index_get(asm_symbol_index_t *index, int position, asm_symbol_t *symbol);
+
+/**
+ * @brief finds a symbol by its name in constant time
+ * @file asm_symbols.h
+ *
+ * @param index the index
+ * @param name the name
+ * @param symbol returns the symbol
+ * @return bool false if the file has no such symbol
+ */
+bool asm_symbol_index_find(asm_symbol_index_t *index, char *name, asm_symbol_t *symbol);
+
+/**
+ * @brief unmaps a .sym file
+ * @file asm_symbols.h
+ *
+ * @param index the index
+ */
+void asm_symbol_index_close(asm_symbol_index_t *index);
\ No newline at end of file
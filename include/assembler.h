@@ -7,16 +7,73 @@
 #include "asm_language.h"
 #include "directive.h"
 #include "asm_memory.h"
+#include "asm_pipeline.h"
+#include "options.h"
+#include "asm_io.h"
+#include "asm_incremental.h"
+#include "asm_peephole.h"
+#include "asm_map.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include "asm_alloc.h"
 
 /**
  * @brief translates the given assembly file to machine code (creates .ob,
- * .ent, .ext and .err files)
+ * .ent, .ext and .err files). The memory and the labels table are emptied
+ * afterwards but kept allocated for the next file
  * @file assembler.h
  * 
  * @param file_name the name of the file that is being processed
  */
-void assembler_on_file(char *file_name);
\ No newline at end of file
+void assembler_on_file(char *file_name);
+
+/**
+ * @brief the same as assembler_on_file, but only the lines that changed
+ * since the previous call with the same state are encoded again, and only
+ * the changed words of the .ob file are rewritten (see asm_incremental.h)
+ * @file assembler.h
+ * 
+ * @param file_name the name of the file that is being processed
+ * @param incremental the state of the file's previous run
+ */
+void assembler_on_file_incremental(char *file_name, asm_incremental_t *incremental);
+
+/**
+ * @brief writes the machine code and data of a single line (after its
+ * macros were opened) to the memory structure and adds its labels to
+ * the labels table
+ * @file assembler.h
+ * 
+ * @param line the line (may be modified)
+ * @param labels_table labels_table
+ */
+void assembler_analyze_line(char *line, labels_table_t *labels_table);
+
+/**
+ * @brief starts reading the given assembly file ahead of its
+ * assembler_on_file call (only with io_uring, see asm_io.h)
+ * @file assembler.h
+ * 
+ * @param file_name the name of the file (without the .as suffix)
+ */
+void assembler_prefetch(char *file_name);
+
+/**
+ * @brief translates assembly code read from the given stream as it arrives
+ * and writes one combined output to the given stream, in delimited
+ * sections: "=== err ===" (diagnostics), and only when there are no errors
+ * "=== ob ===", "=== ent ===" and "=== ext ==="
+ * @file assembler.h
+ * 
+ * @param input the assembly source (e.g. stdin)
+ * @param output the combined output (e.g. stdout)
+ */
+void assembler_on_stream(FILE *input, FILE *output);
+
+/**
+ * @brief frees the memory and the labels table that are kept between files
+ * @file assembler.h
+ */
+void assembler_destroy();
\ No newline at end of file
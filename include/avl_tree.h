@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include "asm_alloc.h"
 
 typedef struct avl_node_t avl_node_t;
 
@@ -9,6 +9,7 @@
 #include <inttypes.h>
 #include "labels_table.h"
 #include "errors.h"
+#include "asm_alloc.h"
 
 typedef enum
 {
@@ -16,6 +17,11 @@ typedef enum
     STRING,
     ENTRY,
     DATA,
+    EQU,
+    SECTION,
+    SPACE,
+    ALIGN,
+    BSS,
     INVALID_DIRECTIVE
 } directive_e;
 
@@ -35,3 +41,39 @@ directive_e directive_get(char* directive);
  * @param line a directive line
  */
 void directive_handle(char *line);
+
+
+/**
+ * @brief starts pooling the string literals of a file: identical literals
+ * and literals that end another literal share a single copy in the data
+ * @file directive.h
+ *
+ * @param am_file the am file, its string directives are read and the file
+ * is returned to where it was
+ */
+void directive_start_string_pool(FILE *am_file);
+
+/**
+ * @brief forgets where the pooled literals were pushed, so the file can be
+ * analyzed again
+ * @file directive.h
+ */
+void directive_restart_string_pool();
+
+/**
+ * @brief stops pooling the string literals and frees the pool
+ * @file directive.h
+ */
+void directive_end_string_pool();
+
+/**
+ * @brief returns the pc of the literal of a string directive, before the
+ * directive is handled. A pooled literal is at its offset in the copy of
+ * its representative
+ * @file directive.h
+ *
+ * @param line the line after its label
+ * @param pc the current pc
+ * @return int the pc of the literal
+ */
+int directive_get_string_pc(char *line, int pc);
\ No newline at end of file
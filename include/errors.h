@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "asm_memory.h"
 
 typedef enum
@@ -26,9 +27,25 @@ typedef enum
     MULTIPLE_LABEL_DEFINITIONS,
     INVALID_LABEL_NAME,
     CONTRARY_LABEL_ATTRIBUTES,
+    INVALID_INCLUDE,
+    UNMATCHED_CONDITIONAL,
+    INVALID_EXPRESSION,
+    INVALID_SIZE,
+    INVALID_SECTION,
+    INVALID_OUTPUT,
+    INVALID_RELOCATION,
     NUMBER_OF_ERRORS /* Must be last */
 } error_e;
 
+/**
+ * @brief receives an error instead of it being printed
+ *
+ * @param error the error
+ * @param symbol the symbol the error refers to (NULL for line errors)
+ * @param context the context that was given to errors_set_hook
+ */
+typedef void (*errors_hook_t)(error_e error, char *symbol, void *context);
+
 /**
  * @brief prints an error with a line number
  * @file errors.h
@@ -39,7 +56,43 @@ typedef enum
 void errors_print_line(error_e error);
 
 /**
- * @brief sets the errors output file to the given file
+ * @brief prints an error that refers to a symbol rather than to a line
+ * @file errors.h
+ *
+ * @param error an error
+ * @param symbol the symbol the error refers to
+ */
+void errors_print_symbol(error_e error, char *symbol);
+
+/**
+ * @brief stops (or resumes) printing errors while still counting them
+ * @file errors.h
+ *
+ * @param muted should the errors be counted without being printed
+ */
+void errors_set_muted(bool muted);
+
+/**
+ * @brief passes the errors of the calling thread to the given hook instead
+ * of printing them (NULL restores printing). They are still counted
+ * @file errors.h
+ *
+ * @param hook the hook
+ * @param context the context given to the hook
+ */
+void errors_set_hook(errors_hook_t hook, void *context);
+
+/**
+ * @brief returns the message of an error
+ * @file errors.h
+ *
+ * @param error an error
+ * @return const char* the message
+ */
+const char *errors_get_message(error_e error);
+
+/**
+ * @brief sets the errors output file to the given file (stdout if NULL)
  * @file errors.h
  * @param out the error file
  */
@@ -49,4 +102,18 @@ void errors_set_output(FILE* out);
  * @brief increases the number of line of error
  * @file errors.h
  */
-void errors_increase_lines();
\ No newline at end of file
+void errors_increase_lines();
+
+/**
+ * @brief returns the number of errors printed since the last reset
+ * @file errors.h
+ *
+ * @return unsigned int the number of errors
+ */
+unsigned int errors_get_count();
+
+/**
+ * @brief resets the line number and the errors count before a new file
+ * @file errors.h
+ */
+void errors_reset();
\ No newline at end of file
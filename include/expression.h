@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+
+/**
+ * @brief returns the value of a symbol of an expression
+ *
+ * @param symbol the symbol
+ * @param value set to the value of the symbol
+ * @param context the context that was given to expression_evaluate
+ * @return bool false if the symbol has no value (the expression fails)
+ */
+typedef bool (*expression_resolver_t)(char *symbol, long *value, void *context);
+
+/**
+ * @brief evaluates an integer expression of numbers, symbols, parentheses,
+ * the unary + and - and the binary operators * / + - << >> & | (with the
+ * precedence they have in C). A value out of -LONG_MAX to LONG_MAX, a
+ * division by 0 and a shift by a negative count or by 32 or more make the
+ * expression invalid
+ * @file expression.h
+ *
+ * @param text the expression
+ * @param resolver returns the values of the symbols
+ * @param context the context given to the resolver
+ * @param value set to the value of the expression. If it is NULL, only the
+ * syntax is checked (the resolver is still called with every symbol, but
+ * its failures are ignored)
+ * @return bool true if the expression is valid
+ */
+bool expression_evaluate(char *text, expression_resolver_t resolver, void *context, long *value);
+
+/**
+ * @brief checks if an expression is a single (signed) number
+ * @file expression.h
+ *
+ * @param text the expression
+ * @param value set to the number
+ * @return bool true if the expression is a single number
+ */
+bool expression_is_number(char *text, long *value);
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <ctype.h>
+#include "asm_alloc.h"
+
+/**
+ * @brief finds the value of a key in a JSON object (nested objects and
+ * arrays are skipped, so only the object's own keys are matched)
+ * @file json.h
+ *
+ * @param object the object (may be NULL)
+ * @param key the key
+ * @return char* the start of the value (NULL if the key doesn't exist)
+ */
+char *json_find(char *object, char *key);
+
+/**
+ * @brief returns the first element of a JSON array
+ * @file json.h
+ *
+ * @param array the array (may be NULL)
+ * @return char* the first element (NULL if the array is empty)
+ */
+char *json_array_first(char *array);
+
+/**
+ * @brief returns the element that follows the given element of a JSON array
+ * @file json.h
+ *
+ * @param element the element
+ * @return char* the next element (NULL if it was the last one)
+ */
+char *json_array_next(char *element);
+
+/**
+ * @brief returns the end of a JSON value
+ * @file json.h
+ *
+ * @param value the value
+ * @return char* the character after the value
+ */
+char *json_skip(char *value);
+
+/**
+ * @brief decodes a JSON string
+ * @file json.h
+ *
+ * @param value the string value (may be NULL)
+ * @param length returns the length of the decoded string (may be NULL)
+ * @return char* the allocated decoded string (NULL if it isn't a string)
+ */
+char *json_get_string(char *value, size_t *length);
+
+/**
+ * @brief returns a JSON number as an integer
+ * @file json.h
+ *
+ * @param value the number value (may be NULL)
+ * @param default_value the integer when the value isn't a number
+ * @return long the integer
+ */
+long json_get_int(char *value, long default_value);
+
+/**
+ * @brief writes a string as a JSON string (with the quotes)
+ * @file json.h
+ *
+ * @param output the output
+ * @param string the string
+ */
+void json_write_string(FILE *output, char *string);
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "errors.h"
 #include "asm_language.h"
 #include "linked_list.h"
+#include "asm_alloc.h"
 
 #define LABEL_MAX_LENGTH 31
 #define LINE_LENGTH 81
@@ -18,6 +19,7 @@
 #define DATA_FLAG 2
 #define EXTERN_FLAG 4
 #define ENTRY_FLAG 8
+#define CONSTANT_FLAG 16 /* defined by .equ, the base address is the index of its value */
 
 typedef struct label_t label_t;
 
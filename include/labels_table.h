@@ -13,6 +13,9 @@
 #include "directive.h"
 #include "asm_output.h"
 #include "asm_memory.h"
+#include "expression.h"
+#include "asm_symbols.h"
+#include "asm_alloc.h"
 
 typedef struct labels_table_t labels_table_t;
 
@@ -24,6 +27,66 @@ typedef struct labels_table_t labels_table_t;
  */
 labels_table_t *labels_table_get_instance();
 
+/**
+ * @brief replaces the labels table instance of the calling thread (NULL
+ * makes the next labels_table_get_instance create a new one)
+ * @file labels_table.h
+ * 
+ * @param table the new instance
+ * @return labels_table_t* the previous instance
+ */
+labels_table_t *labels_table_set_instance(labels_table_t *table);
+
+/**
+ * @brief makes the table record the label definitions, entry/extern
+ * declarations and references in a journal instead of applying them, so
+ * they can be replayed later on another table (with rebased addresses)
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ */
+void labels_table_start_journal(labels_table_t *table);
+
+/**
+ * @brief applies the journal of journal_table to the given table, in the
+ * order it was recorded
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @param journal_table the table that recorded the journal
+ * @param ic_base the ic at which the journal's code starts
+ * @param pc_base the pc at which the journal's code and data start
+ */
+void labels_table_replay_journal(labels_table_t *table, labels_table_t *journal_table, int ic_base, int pc_base);
+
+/**
+ * @brief records that a line that was analyzed into the table depends on
+ * the pc it was analyzed at, so its journal can't be replayed at another pc
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ */
+void labels_table_mark_position_dependent(labels_table_t *table);
+
+/**
+ * @brief checks if a line that was analyzed into the table depends on the
+ * pc it was analyzed at
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @return bool true if a line depends on its pc
+ */
+bool labels_table_is_position_dependent(labels_table_t *table);
+
+/**
+ * @brief checks if the table recorded anything in its journal
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @return bool true if the journal isn't empty
+ */
+bool labels_table_has_journal(labels_table_t *table);
+
 /**
  * @brief checks if a given word is a label by searching it's hash
  * value in the avl tree of the labels table 
@@ -46,6 +109,40 @@ label_t *labels_table_does_label_exist(labels_table_t *table, char* word);
  */
 label_t *labels_table_get_forced_label(labels_table_t *table, char* symbol);
 
+/**
+ * @brief adds a reference to a label (a place in the code that should get
+ * the label's address), creating the label if it doesn't exist yet
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @param symbol the label symbol
+ * @param location the ic of the reference's words
+ */
+void labels_table_add_reference(labels_table_t *table, char *symbol, int location);
+
+/**
+ * @brief defines a constant from the operand of .equ (NAME expression). The
+ * expression may use numbers, labels and other constants, and it is
+ * evaluated after all of the labels were defined
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @param line the operand of the directive
+ */
+void labels_table_add_constant(labels_table_t *table, char *line);
+
+/**
+ * @brief adds a word whose value is an expression that can be computed only
+ * after all of the labels were defined (see labels_table_insert_labels_to_memory_proxy)
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @param expression the expression
+ * @param location the ic (or the dc) of the word
+ * @param is_data is the word in the data segment
+ */
+void labels_table_add_fixup(labels_table_t *table, char *expression, int location, bool is_data);
+
 /**
  * @brief returns the number of extern labels in the table
  * @file labels_table.h
@@ -86,18 +183,19 @@ void labels_table_add_entry_or_extern_labels(labels_table_t *table, char *line,
 void labels_table_add_if_definition(char **line, labels_table_t *table);
 
 /**
- * @brief opens the file (ext/ent) according to the label's attributes and
- * writes the labels information in the proper format based on the file type
+ * @brief writes the entry labels and the references to the extern labels in
+ * the proper format, each file sorted by address
  * @file labels_table.h
  * 
  * @param table the labels table
- * @param ext_file the file containing the external labels
- * @param ent_file the file containing the entry labels
+ * @param ext_file the file containing the external labels (NULL to skip them)
+ * @param ent_file the file containing the entry labels (NULL to skip them)
  */
 void labels_table_write_ext_and_ent_proxy(labels_table_t *table, FILE *ext_file, FILE *ent_file);
 
 /**
- * @brief inserts the labels to the memory structure
+ * @brief inserts the labels and the values of the expressions (computed by
+ * labels_table_check_labels_validity_proxy) to the memory structure
  * @file labels_table.h
  * 
  * @param table the labels table
@@ -105,6 +203,16 @@ void labels_table_write_ext_and_ent_proxy(labels_table_t *table, FILE *ext_file,
  */
 void labels_table_insert_labels_to_memory_proxy(labels_table_t *table, memory_t *memory);
 
+/**
+ * @brief adds every label with its address (the value of a constant), its
+ * attributes and the number of words that refer to it to the symbols
+ * @file labels_table.h
+ * 
+ * @param table the labels table
+ * @param symbols the symbols
+ */
+void labels_table_export_symbols(labels_table_t *table, asm_symbols_t *symbols);
+
 /**
  * @brief prints the labels table
  * @file labels_table.h
@@ -114,13 +222,46 @@ void labels_table_insert_labels_to_memory_proxy(labels_table_t *table, memory_t
 void labels_table_print(labels_table_t *table);
 
 /**
- * @brief checks that all of the labels are defined correctly
+ * @brief checks that all of the labels are defined correctly and evaluates
+ * the constants and the expressions of the words
  * @file labels_table.h
  * 
  * @param table the labels table
  */
 void labels_table_check_labels_validity_proxy(labels_table_t *table);
 
+/**
+ * @brief checks that the program can be moved to another address (--rel):
+ * the value of every expression word is either absolute or the address of
+ * a label plus an absolute value, and every entry label is an address.
+ * The expressions are evaluated again with the labels moved, so it is
+ * called after labels_table_check_labels_validity_proxy
+ * @file labels_table.h
+ *
+ * @param table the labels table
+ */
+void labels_table_check_relocations(labels_table_t *table);
+
+/**
+ * @brief writes the expression words that move with the labels (found by
+ * labels_table_check_relocations) to a relocation file: their number and
+ * then the segment and the location of every word
+ * @file labels_table.h
+ *
+ * @param table the labels table
+ * @param rel_file a relocation file
+ */
+void labels_table_write_relocations(labels_table_t *table, FILE *rel_file);
+
+/**
+ * @brief removes all of the labels from the table so it can be reused
+ * for another file
+ * @file labels_table.h
+ *
+ * @param table the labels table
+ */
+void labels_table_reset(labels_table_t *table);
+
 /**
  * @brief destroys the entire struct of the labels table
  * @file labels_table.h
@@ -10,9 +10,63 @@
 #include "linked_list.h"
 #include "avl_tree.h"
 #include "hash.h"
+#include "asm_alloc.h"
 
 #define LINE_LENGTH 81
 typedef avl_node_t* macro_t;
+typedef struct macro_includes_t macro_includes_t;
+
+/* where a line that was passed to the handler of macro_expand came from */
+typedef enum
+{
+    ORIGIN_SOURCE,  /* a line of the source */
+    ORIGIN_MACRO,   /* a line of a macro, at the line that called it */
+    ORIGIN_INCLUDE  /* a line of an included file, at the line that included it */
+} line_origin_e;
+
+/**
+ * @brief receives a single line of the source after its macros were opened
+ * 
+ * @param line the line (shouldn't be kept or modified by the handler)
+ * @param context the context that was given to macro_expand
+ */
+typedef void (*macro_line_handler_t)(char *line, void *context);
+
+/**
+ * @brief opens the macros of the given file line by line, passing every
+ * resulting line to the handler as soon as it is read. A line of the form
+ * .include "file" is replaced by the lines of the file and makes its
+ * macros callable. The lines between .if/.ifdef/.ifndef and the matching
+ * .else or .endif are kept only if the condition holds (see macro_define),
+ * inside a macro's content too, where they are evaluated when the macro
+ * is defined. Every included file is parsed once and shared by all the
+ * files that include it (until it or a defined name changes). The included files are
+ * recorded in the includes of the calling thread, with the origin of every
+ * line (see macro_includes_get_origin). Once a file uses
+ * .section NAME, its lines are laid out at the end of the file: the code
+ * of every section, then the data of every section and then the .space
+ * and .align lines of the .bss section (written as ".bss space N" and
+ * ".bss align N", reserved words that aren't stored), each group after
+ * the .section line of its section. The sections have no location
+ * counters of their own: the lines are only reordered, so the single ic,
+ * dc and bss counters of asm_memory give every label its final address
+ * @file macro.h
+ * 
+ * @param current_file the original file that is being read
+ * @param handler the handler that receives the lines
+ * @param context the context given to the handler
+ */
+void macro_expand(FILE *current_file, macro_line_handler_t handler, void *context);
+
+/**
+ * @brief returns the line number (starting at 1) in the original file of
+ * the line that is being passed to the handler of macro_expand. The lines
+ * of an opened macro get the line of the macro call
+ * @file macro.h
+ * 
+ * @return unsigned int the line number
+ */
+unsigned int macro_get_source_line();
 
 /**
  * @brief create the am file which contains the given file with
@@ -22,4 +76,109 @@ typedef avl_node_t* macro_t;
  * @param current_file the original file that is being read
  * @param am_file the file with the macros opened
  */
-void macro_write_am_file(FILE* current_file, FILE *am_file);
\ No newline at end of file
+void macro_write_am_file(FILE* current_file, FILE *am_file);
+
+/**
+ * @brief returns the includes of the calling thread (creating them if
+ * needed). They hold the directory the includes are relative to and the
+ * files the last expanded source included
+ * @file macro.h
+ * 
+ * @return macro_includes_t* the includes
+ */
+macro_includes_t *macro_includes_get_instance();
+
+/**
+ * @brief replaces the includes of the calling thread (so another thread can
+ * expand a file on its behalf)
+ * @file macro.h
+ * 
+ * @param includes the includes (NULL to create new ones on demand)
+ * @return macro_includes_t* the previous includes
+ */
+macro_includes_t *macro_includes_set_instance(macro_includes_t *includes);
+
+/**
+ * @brief sets the source file that is going to be expanded, its includes
+ * are searched relative to its directory
+ * @file macro.h
+ * 
+ * @param includes the includes
+ * @param path the path of the source (NULL for the working directory)
+ */
+void macro_includes_set_source(macro_includes_t *includes, char *path);
+
+/**
+ * @brief sets the prelude, a file whose macros every source can call as if
+ * it included the file first (its other lines are ignored). The prelude is
+ * parsed once and shared by all the threads, so setting it again is cheap
+ * unless the file changed
+ * @file macro.h
+ * 
+ * @param includes the includes
+ * @param path the path of the prelude (NULL for no prelude)
+ * @return bool false if the prelude couldn't be read
+ */
+bool macro_includes_set_prelude(macro_includes_t *includes, char *path);
+
+/**
+ * @brief writes a make rule that makes the target depend on the source and
+ * on every file it included
+ * @file macro.h
+ * 
+ * @param includes the includes
+ * @param d_file the .d file
+ * @param target the target of the rule
+ * @param source the source file
+ */
+void macro_includes_write_dependencies(macro_includes_t *includes, FILE *d_file, char *target, char *source);
+
+/**
+ * @brief returns where a line of the last expanded source came from (the
+ * lines are counted in the order they were passed to the handler, so the
+ * line of the am file)
+ * @file macro.h
+ * 
+ * @param includes the includes
+ * @param line the index of the line (starting at 0)
+ * @param source_line returns the line number in the source
+ * @param origin returns how the line got to that source line
+ * @param file returns the file the text of the line was read from: the
+ * source (NULL), an included file or the file that defined the macro. It is
+ * valid until the includes are used for another source
+ * @param file_line returns the line in that file
+ * @return bool false if the source had less lines
+ */
+bool macro_includes_get_origin(macro_includes_t *includes, int line, unsigned int *source_line, line_origin_e *origin,
+                               char **file, unsigned int *file_line);
+
+/**
+ * @brief frees the includes
+ * @file macro.h
+ * 
+ * @param includes the includes
+ */
+void macro_includes_destroy(macro_includes_t *includes);
+
+/**
+ * @brief frees every included file that was parsed
+ * @file macro.h
+ */
+void macro_destroy_include_cache();
+
+/**
+ * @brief defines a name for the conditional directives. .ifdef checks that
+ * the name is defined and .if NAME, .if NAME == VALUE and .if NAME != VALUE
+ * check its value. Should be called between files, not while a file is
+ * being expanded. The included files are parsed again for the files after it
+ * @file macro.h
+ * 
+ * @param definition NAME or NAME=VALUE (the value of NAME is 1)
+ */
+void macro_define(char *definition);
+
+/**
+ * @brief frees all of the defined names
+ * @file macro.h
+ */
+void macro_undefine_all();
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "macro.h"
+
+typedef struct options_t
+{
+    bool pipeline;     /* -p: macro stage and first pass on separate threads, .ent/.ext written during the .ob */
+    int chunks;        /* -j N: first pass over up to N chunks in parallel (ignored with -p) */
+    bool io_uring;     /* -u: read ahead sources and batch the outputs with io_uring */
+    bool stats;        /* --stats: report how many outputs were written, unchanged or removed */
+    char *prelude;     /* --prelude FILE: macros every file can call, parsed once */
+    bool optimize;     /* -O: remove the redundant instructions (takes precedence over -p and -j) */
+    bool pool_strings; /* --pool-strings: one copy of equal and suffix string literals (over -p and -j) */
+    int ob_threads;    /* --ob-threads N: format and write the .ob file over up to N threads */
+    bool relocations;  /* --rel: write the locations of the words that move with the labels to a .rel file (see --rebase) */
+    bool map;          /* --map: write the source line of every address to a .map file (over -p and -j) */
+    bool symbols;      /* --sym: write every label to a .sym file, indexed by a perfect hash (see --nm) */
+    bool dependencies; /* -MD: write the files every .ob depends on to a .d file, for make */
+    bool alloc_stats;  /* --alloc-stats: report the allocations of every file on stderr (see asm_alloc.h) */
+} options_t;
+
+/**
+ * @brief returns the instance of the command line options
+ * @file options.h
+ *
+ * @return options_t* the options
+ */
+options_t *options_get_instance();
+
+/**
+ * @brief parses the option at the given offset of the command line (if
+ * there is one). An option applies to all of the files that follow it.
+ * -D NAME[=VALUE] (or -DNAME[=VALUE]) defines a name for the conditional
+ * directives
+ * @file options.h
+ *
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @param offset the offset of the argument that is being checked
+ * @return int the number of arguments the option used (0 if the argument
+ * isn't an option)
+ */
+int options_parse(int argc, char *argv[], int offset);
\ No newline at end of file
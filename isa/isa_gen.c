@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_WORDS 255
+#define NAME_LENGTH 16
+#define LINE_LENGTH 256
+#define FIELD_VALUES 16     /* an opcode, a funct and a register number are 4 bits */
+#define NUMBER_OF_LETTERS 26
+#define KEY_LENGTH 3        /* the characters of a word that are hashed */
+#define SEARCH_ATTEMPTS 16
+#define SEARCH_STEPS 1024
+
+/* the same as asm_language.c: every character falls into one of 26 classes */
+#define ALPHA_INDEX(ch) ((unsigned char)((ch) - 'a') % NUMBER_OF_LETTERS)
+
+typedef struct
+{
+    char name[NAME_LENGTH + 1];
+    int opcode;             /* the opcode of an instruction or the number of a register */
+    int funct;
+    int address_src;        /* the addressing modes by bits (1 << address_e) */
+    int address_dest;
+    int is_register;
+} word_t;
+
+static char *address_names[] = {"immediate", "direct", "index", "register"};
+
+static word_t words[MAX_WORDS];
+static int words_count;
+static int instructions_count;
+static unsigned int asso_values[NUMBER_OF_LETTERS];
+static unsigned long random_state = 1;
+
+/**
+ * @brief reports an error in the description and exits
+ *
+ * @param path the path of the description
+ * @param line the line of the error (0 for the whole file)
+ * @param message the error
+ */
+static void isa_gen_fail(char *path, int line, char *message)
+{
+    if (line)
+    {
+        fprintf(stderr, "%s:%d: %s\n", path, line, message);
+    }
+    else
+    {
+        fprintf(stderr, "%s: %s\n", path, message);
+    }
+    exit(1);
+}
+
+/**
+ * @brief parses the addressing modes of an operand ("-" for none)
+ *
+ * @param text the modes, separated by "|"
+ * @return int the modes by bits (-1 if a mode is unknown)
+ */
+static int isa_gen_parse_modes(char *text)
+{
+    char *mode;
+    int modes = 0;
+    int address;
+
+    if (strcmp(text, "-") == 0)
+    {
+        return 0;
+    }
+    for (mode = strtok(text, "|"); mode; mode = strtok(NULL, "|"))
+    {
+        for (address = 0; address < 4 && strcmp(mode, address_names[address]) != 0; address++)
+            ;
+        if (address == 4)
+        {
+            return -1;
+        }
+        modes |= 1 << address;
+    }
+    return modes;
+}
+
+/**
+ * @brief checks if a name is made of lower case letters and digits and
+ * starts with a letter
+ *
+ * @param name the name
+ * @return int true if the name is valid
+ */
+static int isa_gen_is_valid_name(char *name)
+{
+    if (!islower((unsigned char)*name))
+    {
+        return 0;
+    }
+    for (; *name; name++)
+    {
+        if (!islower((unsigned char)*name) && !isdigit((unsigned char)*name))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief reads the description, the instructions come before the registers
+ *
+ * @param path the path of the description
+ */
+static void isa_gen_read(char *path)
+{
+    FILE *file;
+    char line[LINE_LENGTH];
+    char kind[LINE_LENGTH];
+    char name[LINE_LENGTH];
+    char source[LINE_LENGTH];
+    char destination[LINE_LENGTH];
+    word_t *word;
+    int line_number = 0;
+    int fields;
+    int other;
+
+    if (!(file = fopen(path, "r")))
+    {
+        isa_gen_fail(path, 0, "couldn't open the file");
+    }
+    while (fgets(line, LINE_LENGTH, file))
+    {
+        ++line_number;
+        if (sscanf(line, "%s", kind) != 1 || *kind == '#')
+        {
+            continue;
+        }
+        if (words_count == MAX_WORDS)
+        {
+            isa_gen_fail(path, line_number, "too many words");
+        }
+        word = &words[words_count];
+        memset(word, 0, sizeof(word_t));
+
+        if (strcmp(kind, "instruction") == 0)
+        {
+            fields = sscanf(line, "%*s %s %d %d %s %s", name, &word->opcode, &word->funct, source, destination);
+            if (fields != 5)
+            {
+                isa_gen_fail(path, line_number, "expected: instruction NAME OPCODE FUNCT SOURCE DESTINATION");
+            }
+            if (instructions_count != words_count)
+            {
+                isa_gen_fail(path, line_number, "the instructions have to come before the registers");
+            }
+            if ((word->address_src = isa_gen_parse_modes(source)) < 0
+                || (word->address_dest = isa_gen_parse_modes(destination)) < 0)
+            {
+                isa_gen_fail(path, line_number, "unknown addressing mode");
+            }
+            if (word->address_src && !word->address_dest)
+            {
+                isa_gen_fail(path, line_number, "an instruction with a source needs a destination");
+            }
+            ++instructions_count;
+        }
+        else if (strcmp(kind, "register") == 0)
+        {
+            if (sscanf(line, "%*s %s %d", name, &word->opcode) != 2)
+            {
+                isa_gen_fail(path, line_number, "expected: register NAME NUMBER");
+            }
+            word->is_register = 1;
+        }
+        else
+        {
+            isa_gen_fail(path, line_number, "unknown kind of word");
+        }
+
+        if (strlen(name) > NAME_LENGTH || !isa_gen_is_valid_name(name))
+        {
+            isa_gen_fail(path, line_number, "invalid name");
+        }
+        if (word->opcode < 0 || word->opcode >= FIELD_VALUES || word->funct < 0 || word->funct >= FIELD_VALUES)
+        {
+            isa_gen_fail(path, line_number, "a value doesn't fit in 4 bits");
+        }
+        strcpy(word->name, name);
+        for (other = 0; other < words_count; other++)
+        {
+            if (strcmp(words[other].name, name) == 0)
+            {
+                isa_gen_fail(path, line_number, "the name is already used");
+            }
+            if (!word->is_register && !words[other].is_register
+                && words[other].opcode == word->opcode && words[other].funct == word->funct)
+            {
+                isa_gen_fail(path, line_number, "another instruction has the same opcode and funct");
+            }
+        }
+        ++words_count;
+    }
+    fclose(file);
+
+    if (instructions_count == 0)
+    {
+        isa_gen_fail(path, 0, "there are no instructions");
+    }
+}
+
+/**
+ * @brief returns the length of the part of a word that is hashed
+ *
+ * @param word the word
+ * @return int the number of hashed characters
+ */
+static int isa_gen_key_length(word_t *word)
+{
+    int length = strlen(word->name);
+
+    return length < KEY_LENGTH ? length : KEY_LENGTH;
+}
+
+/**
+ * @brief counts the classes of the hashed characters of a word
+ *
+ * @param word the word
+ * @param classes returns the number of times every class appears
+ */
+static void isa_gen_count_classes(word_t *word, int *classes)
+{
+    int position;
+
+    memset(classes, 0, NUMBER_OF_LETTERS * sizeof(int));
+    for (position = 0; position < isa_gen_key_length(word); position++)
+    {
+        ++classes[ALPHA_INDEX(word->name[position])];
+    }
+}
+
+/**
+ * @brief the hash of asm_language.c: the length of the word and the
+ * values of its first characters
+ *
+ * @param word the word
+ * @return unsigned int the hash
+ */
+static unsigned int isa_gen_hash(word_t *word)
+{
+    unsigned int value = strlen(word->name);
+    int position;
+
+    for (position = 0; position < isa_gen_key_length(word); position++)
+    {
+        value += asso_values[ALPHA_INDEX(word->name[position])];
+    }
+    return value;
+}
+
+/**
+ * @brief returns a pseudo random number (the same on every machine, so the
+ * generated tables don't depend on the C library)
+ *
+ * @param bound the number is below it
+ * @return unsigned int the number
+ */
+static unsigned int isa_gen_random(unsigned int bound)
+{
+    random_state = (random_state * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+    return (random_state >> 16) % bound;
+}
+
+/**
+ * @brief finds two words with the same hash
+ *
+ * @param owners a table of the hashes (every entry is -1)
+ * @param first returns the first word
+ * @param second returns the second word
+ * @return int true if two words collide
+ */
+static int isa_gen_find_collision(int *owners, int *first, int *second)
+{
+    int word;
+    int collides = 0;
+
+    for (word = 0; word < words_count && !collides; word++)
+    {
+        if (owners[isa_gen_hash(&words[word])] >= 0)
+        {
+            *first = owners[isa_gen_hash(&words[word])];
+            *second = word;
+            collides = 1;
+        }
+        owners[isa_gen_hash(&words[word])] = word;
+    }
+    /* the table is cleared for the next check */
+    while (word-- > 0)
+    {
+        owners[isa_gen_hash(&words[word])] = -1;
+    }
+    return collides;
+}
+
+/**
+ * @brief searches values for the character classes that give every word
+ * a different hash, with the smallest values it can. A collision is fixed
+ * by changing the value of a class that one of the two words has more of
+ * than the other
+ *
+ * @param path the path of the description
+ */
+static void isa_gen_search(char *path)
+{
+    int first_classes[NUMBER_OF_LETTERS];
+    int second_classes[NUMBER_OF_LETTERS];
+    int differing[NUMBER_OF_LETTERS];
+    int differing_count;
+    int *owners;
+    int first;
+    int second;
+    int class;
+    int attempt;
+    int step;
+    unsigned int bound;
+
+    /* the hash can't tell apart words of the same length with the same classes */
+    for (first = 0; first < words_count; first++)
+    {
+        for (second = first + 1; second < words_count; second++)
+        {
+            isa_gen_count_classes(&words[first], first_classes);
+            isa_gen_count_classes(&words[second], second_classes);
+            if (strlen(words[first].name) == strlen(words[second].name)
+                && memcmp(first_classes, second_classes, sizeof(first_classes)) == 0)
+            {
+                fprintf(stderr, "%s: %s and %s can't be told apart by their first %d characters\n",
+                        path, words[first].name, words[second].name, KEY_LENGTH);
+                exit(1);
+            }
+        }
+    }
+
+    /* the words need as many different hashes, so the smaller bounds can't work */
+    bound = words_count > NAME_LENGTH + 1 ? (words_count - NAME_LENGTH - 1) / KEY_LENGTH + 1 : 1;
+    for (;; bound++)
+    {
+        /* a hash is at most the longest name and KEY_LENGTH values */
+        owners = malloc((NAME_LENGTH + KEY_LENGTH * bound + 1) * sizeof(int));
+        if (!owners)
+        {
+            isa_gen_fail(path, 0, "out of memory");
+        }
+        memset(owners, -1, (NAME_LENGTH + KEY_LENGTH * bound + 1) * sizeof(int));
+
+        for (attempt = 0; attempt < SEARCH_ATTEMPTS; attempt++)
+        {
+            for (class = 0; class < NUMBER_OF_LETTERS; class++)
+            {
+                asso_values[class] = isa_gen_random(bound);
+            }
+            for (step = 0; step < SEARCH_STEPS; step++)
+            {
+                if (!isa_gen_find_collision(owners, &first, &second))
+                {
+                    free(owners);
+                    return;
+                }
+                isa_gen_count_classes(&words[first], first_classes);
+                isa_gen_count_classes(&words[second], second_classes);
+                differing_count = 0;
+                for (class = 0; class < NUMBER_OF_LETTERS; class++)
+                {
+                    if (first_classes[class] != second_classes[class])
+                    {
+                        differing[differing_count++] = class;
+                    }
+                }
+                asso_values[differing[isa_gen_random(differing_count)]] = isa_gen_random(bound);
+            }
+        }
+        free(owners);
+    }
+}
+
+/**
+ * @brief writes an array of numbers, 10 in a line
+ *
+ * @param out the generated header
+ * @param values the numbers
+ * @param count the number of numbers
+ */
+static void isa_gen_write_values(FILE *out, unsigned int *values, int count)
+{
+    int value;
+
+    for (value = 0; value < count; value++)
+    {
+        fprintf(out, "%s%2u%s", value % 10 == 0 ? "    " : "", values[value],
+                value == count - 1 ? "\n" : (value % 10 == 9 ? ",\n" : ", "));
+    }
+}
+
+/**
+ * @brief writes the generated header
+ *
+ * @param out the generated header
+ * @param source the path of the description
+ */
+static void isa_gen_write(FILE *out, char *source)
+{
+    unsigned int *lookup;
+    unsigned int decode[FIELD_VALUES * FIELD_VALUES];
+    unsigned int hash_size = 0;
+    unsigned int name_length = 0;
+    int word;
+    char *letter;
+
+    memset(decode, 0, sizeof(decode));
+    for (word = 0; word < words_count; word++)
+    {
+        hash_size = isa_gen_hash(&words[word]) >= hash_size ? isa_gen_hash(&words[word]) + 1 : hash_size;
+        name_length = strlen(words[word].name) > name_length ? strlen(words[word].name) : name_length;
+    }
+    if (!(lookup = calloc(hash_size, sizeof(unsigned int))))
+    {
+        isa_gen_fail(source, 0, "out of memory");
+    }
+    for (word = 0; word < words_count; word++)
+    {
+        lookup[isa_gen_hash(&words[word])] = word + 1;
+        if (!words[word].is_register)
+        {
+            decode[words[word].opcode * FIELD_VALUES + words[word].funct] = word + 1;
+        }
+    }
+
+    fprintf(out, "/* generated by isa/isa_gen from %s, edit the description instead */\n", source);
+    fprintf(out, "#pragma once\n\n");
+    fprintf(out, "typedef enum\n{\n    INVALID_ASM_WORD");
+    for (word = 0; word < words_count; word++)
+    {
+        fprintf(out, ",\n    ");
+        for (letter = words[word].name; *letter; letter++)
+        {
+            fputc(toupper((unsigned char)*letter), out);
+        }
+    }
+    fprintf(out, "\n} asm_word_e;\n\n");
+    fprintf(out, "#define NUMBER_OF_INSTRUCTIONS %d\n", instructions_count);
+    fprintf(out, "#define NUMBER_OF_REGISTERS %d\n", words_count - instructions_count);
+    fprintf(out, "#define NUMBER_OF_ASM_WORDS %d\n", words_count);
+
+    fprintf(out, "\n#ifdef ASM_ISA_TABLES\n\n");
+    fprintf(out, "#define ASM_ISA_KEY_LENGTH %d /* the characters of a word that are hashed */\n", KEY_LENGTH);
+    fprintf(out, "#define ASM_ISA_HASH_SIZE %u\n", hash_size);
+    fprintf(out, "#define ASM_ISA_FIELD_VALUES %d\n\n", FIELD_VALUES);
+    fprintf(out, "typedef struct\n{\n");
+    fprintf(out, "    char name[%u];\n", name_length + 1);
+    fprintf(out, "    uint8_t opcode;       /* the opcode of an instruction or the number of a register */\n");
+    fprintf(out, "    uint8_t funct;\n");
+    fprintf(out, "    uint8_t address_src;  /* the source addressing modes by bits (1 << address_e) */\n");
+    fprintf(out, "    uint8_t address_dest; /* the destination addressing modes by bits */\n");
+    fprintf(out, "    uint8_t args_num;\n");
+    fprintf(out, "} asm_isa_word_t;\n\n");
+
+    fprintf(out, "/* the value of every class of characters (see ALPHA_INDEX) */\n");
+    fprintf(out, "static const unsigned char asm_isa_asso_values[%d] = {\n", NUMBER_OF_LETTERS);
+    isa_gen_write_values(out, asso_values, NUMBER_OF_LETTERS);
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "/* the word of every hash (INVALID_ASM_WORD if there isn't one) */\n");
+    fprintf(out, "static const unsigned char asm_isa_lookup[ASM_ISA_HASH_SIZE] = {\n");
+    isa_gen_write_values(out, lookup, hash_size);
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const asm_isa_word_t asm_isa_words[NUMBER_OF_ASM_WORDS + 1] = {\n");
+    fprintf(out, "    {\"\", 0, 0, 0, 0, 0}");
+    for (word = 0; word < words_count; word++)
+    {
+        fprintf(out, ",\n    {\"%s\", %d, %d, %d, %d, %d}", words[word].name, words[word].opcode, words[word].funct,
+                words[word].address_src, words[word].address_dest, !!words[word].address_src + !!words[word].address_dest);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "/* the instruction of every opcode and funct (INVALID_ASM_WORD if there isn't one) */\n");
+    fprintf(out, "static const unsigned char asm_isa_decode[ASM_ISA_FIELD_VALUES][ASM_ISA_FIELD_VALUES] = {\n");
+    for (word = 0; word < FIELD_VALUES * FIELD_VALUES; word++)
+    {
+        fprintf(out, "%s%2u%s", word % FIELD_VALUES == 0 ? "    {" : "", decode[word],
+                word % FIELD_VALUES < FIELD_VALUES - 1 ? ", " : (word == FIELD_VALUES * FIELD_VALUES - 1 ? "}\n" : "},\n"));
+    }
+    fprintf(out, "};\n\n#endif");
+    free(lookup);
+}
+
+/**
+ * @brief generates the instruction and register tables of asm_language.c
+ * from the description of the instruction set:
+ * isa_gen <description> <header>
+ *
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @return int 0 if the header was generated, else 1
+ */
+int main(int argc, char *argv[])
+{
+    FILE *out;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <description> <header>\n", argv[0]);
+        return 1;
+    }
+    isa_gen_read(argv[1]);
+    isa_gen_search(argv[1]);
+
+    if (!(out = fopen(argv[2], "w")))
+    {
+        isa_gen_fail(argv[2], 0, "couldn't write the file");
+    }
+    isa_gen_write(out, argv[1]);
+    if (fclose(out) != 0)
+    {
+        remove(argv[2]);
+        isa_gen_fail(argv[2], 0, "couldn't write the file");
+    }
+    return 0;
+}
\ No newline at end of file
@@ -1,14 +1,8 @@
 #include "argument.h"
 
 #define CHECK_IMMEDIATE_VALIDATION(argument, is_valid)   \
-    is_valid = *argument++ == '#' &&                     \
-               (isdigit(*argument) || *argument == '-'); \
-    if (is_valid)                                        \
-    {                                                    \
-        while (isdigit(*(++argument)))                   \
-            ;                                            \
-        is_valid = *argument == '\0';                    \
-    }
+    is_valid = *argument == '#' &&                       \
+               expression_evaluate(argument + 1, NULL, NULL, NULL);
 
 #define CHECK_DIRECT_VALIDATION(argument, is_valid)     \
     is_valid = !asm_language_is_saved_word(argument)    \
@@ -68,7 +62,7 @@ address_e argument_get_address(char *argument)
 uint8_t argument_get_words_by_address(address_e address)
 {
     uint8_t words;
-    assert("Address not valid" && (address >= 0 && address < 4));
+    ASM_INVARIANT("Address not valid" && (address >= 0 && address < 4));
 
     switch (address)
     {
@@ -94,7 +88,7 @@ bool argument_is_valid(char *argument, address_e address)
     char *argument_p;
     int len;
 
-    assert("Address not valid" && (address >= 0 && address < 4));
+    ASM_INVARIANT("Address not valid" && (address >= 0 && address < 4));
 
     switch (address)
     {
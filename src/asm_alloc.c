@@ -0,0 +1,234 @@
+#include "asm_alloc.h"
+#include <string.h>
+
+#define UNTRACKED -1
+#define TOTAL NUMBER_OF_SUBSYSTEMS /* the counters of all of the subsystems together */
+
+#define ATOMIC_ADD(pointer, value) __atomic_add_fetch(pointer, value, __ATOMIC_RELAXED)
+
+/* every block starts with its size, so it can be counted when it is freed */
+typedef union alloc_header_t
+{
+    struct
+    {
+        size_t size;
+        int subsystem;     /* UNTRACKED if the counting didn't start when it was allocated */
+    } info;
+    long double alignment; /* the block after the header is aligned as malloc's */
+} alloc_header_t;
+
+typedef struct alloc_counters_t
+{
+    unsigned long allocations;
+    unsigned long bytes;       /* the bytes that were allocated (freed or not) */
+    long live;                 /* the bytes that are allocated now */
+    long peak;
+} alloc_counters_t;
+
+static const char *subsystem_names[NUMBER_OF_SUBSYSTEMS] = {
+    "labels",   /* ALLOC_LABELS */
+    "tree",     /* ALLOC_TREE */
+    "list",     /* ALLOC_LIST */
+    "macro",    /* ALLOC_MACRO */
+    "memory",   /* ALLOC_MEMORY */
+    "passes",   /* ALLOC_PASSES */
+    "output",   /* ALLOC_OUTPUT */
+    "io",       /* ALLOC_IO */
+    "service",  /* ALLOC_SERVICE */
+};
+
+/* the counters are shared by all of the threads that work on a file */
+static alloc_counters_t counters[NUMBER_OF_SUBSYSTEMS + 1];
+static alloc_counters_t file_counters[NUMBER_OF_SUBSYSTEMS + 1]; /* the counters when the file started */
+static bool is_tracking;
+static unsigned long allocations_count;
+static unsigned long failing_allocation;
+
+/**
+ * @brief counts an allocated or a freed block
+ *
+ * @param counter the counters
+ * @param is_allocation true if the block was allocated
+ * @param change the change of the allocated bytes
+ */
+static void asm_alloc_count(alloc_counters_t *counter, bool is_allocation, long change)
+{
+    long live;
+    long peak;
+
+    if (is_allocation)
+    {
+        ATOMIC_ADD(&(counter->allocations), 1);
+        ATOMIC_ADD(&(counter->bytes), change);
+    }
+    live = ATOMIC_ADD(&(counter->live), change);
+    peak = __atomic_load_n(&(counter->peak), __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&(counter->peak), &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/**
+ * @brief counts a block for its subsystem and for the total (if the
+ * counting started)
+ *
+ * @param header the header of the block
+ * @param subsystem the subsystem of the block
+ */
+static void asm_alloc_track(alloc_header_t *header, alloc_subsystem_e subsystem)
+{
+    header->info.subsystem = UNTRACKED;
+    if (is_tracking)
+    {
+        header->info.subsystem = subsystem;
+        asm_alloc_count(&(counters[subsystem]), true, header->info.size);
+        asm_alloc_count(&(counters[TOTAL]), true, header->info.size);
+    }
+}
+
+/**
+ * @brief stops counting a block that is freed or resized
+ *
+ * @param header the header of the block
+ */
+static void asm_alloc_untrack(alloc_header_t *header)
+{
+    if (header->info.subsystem != UNTRACKED)
+    {
+        asm_alloc_count(&(counters[header->info.subsystem]), false, -(long)header->info.size);
+        asm_alloc_count(&(counters[TOTAL]), false, -(long)header->info.size);
+    }
+}
+
+/**
+ * @brief checks if the allocation that is made now should fail
+ *
+ * @return bool true if it should fail
+ */
+static bool asm_alloc_is_failing()
+{
+    return failing_allocation && ATOMIC_ADD(&allocations_count, 1) == failing_allocation;
+}
+
+/**
+ * @brief stops the assembler because an allocation failed: the error is
+ * reported and the exit handlers remove the outputs that are being written
+ */
+static void asm_alloc_fail()
+{
+    fputs("Memory allocation failed\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+void *asm_alloc_malloc(alloc_subsystem_e subsystem, size_t size)
+{
+    alloc_header_t *header;
+
+    if (asm_alloc_is_failing() || (header = malloc(sizeof(alloc_header_t) + size)) == NULL)
+    {
+        asm_alloc_fail();
+    }
+    header->info.size = size;
+    asm_alloc_track(header, subsystem);
+
+    return header + 1;
+}
+
+void *asm_alloc_calloc(alloc_subsystem_e subsystem, size_t count, size_t size)
+{
+    alloc_header_t *header;
+
+    /* calloc is kept for its pages that are zeroed lazily */
+    if ((size && count > ((size_t)-1 - sizeof(alloc_header_t)) / size) || asm_alloc_is_failing()
+        || (header = calloc(1, sizeof(alloc_header_t) + count * size)) == NULL)
+    {
+        asm_alloc_fail();
+    }
+    header->info.size = count * size;
+    asm_alloc_track(header, subsystem);
+
+    return header + 1;
+}
+
+void *asm_alloc_realloc(alloc_subsystem_e subsystem, void *pointer, size_t size)
+{
+    alloc_header_t *header;
+    alloc_header_t old_header;
+
+    if (pointer == NULL)
+    {
+        return asm_alloc_malloc(subsystem, size);
+    }
+
+    old_header = *((alloc_header_t*)pointer - 1);
+    if (asm_alloc_is_failing() || (header = realloc((alloc_header_t*)pointer - 1, sizeof(alloc_header_t) + size)) == NULL)
+    {
+        asm_alloc_fail();
+    }
+    asm_alloc_untrack(&old_header);
+    header->info.size = size;
+    asm_alloc_track(header, subsystem);
+
+    return header + 1;
+}
+
+void asm_alloc_free(void *pointer)
+{
+    alloc_header_t *header;
+
+    if (pointer)
+    {
+        header = (alloc_header_t*)pointer - 1;
+        asm_alloc_untrack(header);
+        free(header);
+    }
+}
+
+void asm_alloc_fail_at(unsigned long allocation)
+{
+    allocations_count = 0;
+    failing_allocation = allocation;
+}
+
+void asm_alloc_start_file()
+{
+    int subsystem;
+
+    is_tracking = true;
+    for (subsystem = 0; subsystem <= TOTAL; subsystem++)
+    {
+        __atomic_store_n(&(counters[subsystem].peak), __atomic_load_n(&(counters[subsystem].live), __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        file_counters[subsystem] = counters[subsystem];
+    }
+}
+
+/**
+ * @brief prints the counters of a subsystem since the file started
+ *
+ * @param out the output
+ * @param subsystem the subsystem (TOTAL for all of them)
+ */
+static void asm_alloc_print(FILE *out, int subsystem)
+{
+    alloc_counters_t *now = &(counters[subsystem]);
+    alloc_counters_t *start = &(file_counters[subsystem]);
+
+    fprintf(out, "%lu allocations, %lu bytes, %ld peak, %ld leaked\n", now->allocations - start->allocations,
+            now->bytes - start->bytes, now->peak, now->live - start->live);
+}
+
+void asm_alloc_report(FILE *out, char *file)
+{
+    int subsystem;
+
+    fprintf(out, "%s: ", file);
+    asm_alloc_print(out, TOTAL);
+    for (subsystem = 0; subsystem < TOTAL; subsystem++)
+    {
+        if (counters[subsystem].allocations != file_counters[subsystem].allocations
+            || counters[subsystem].live != file_counters[subsystem].live)
+        {
+            fprintf(out, "  %-8s ", subsystem_names[subsystem]);
+            asm_alloc_print(out, subsystem);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,435 @@
+#define _POSIX_C_SOURCE 200809L
+#include "asm_archive.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ARCHIVE_MAGIC "AARC"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_HEADER_WORDS 6  /* the magic, the version, the count, the directory offset and size, the names size */
+#define ARCHIVE_MEMBER_WORDS 3  /* the name offset, the data offset and the size */
+#define ARCHIVE_ALIGNMENT 8
+#define ARCHIVE_ALIGN(size) (((size) + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT)
+#define ARCHIVE_SUFFIXES_COUNT 3
+
+/* a file that is packed */
+typedef struct archive_member_t
+{
+    char *name;
+    char *data;
+    size_t size;
+    uint32_t offset;
+} archive_member_t;
+
+/* an entry label of a module */
+typedef struct archive_symbol_t
+{
+    char name[LABEL_MAX_LENGTH + 1];
+    long address;
+    int member;         /* the .ob member of the module */
+} archive_symbol_t;
+
+struct asm_archive_t
+{
+    unsigned char *data;  /* the mapped file */
+    size_t size;
+    uint32_t count;
+    unsigned char *members;
+    char *names;
+    uint32_t names_size;
+    asm_symbol_index_t *directory;
+};
+
+static char *suffixes[ARCHIVE_SUFFIXES_COUNT] = {".ob", ".ent", ".ext"};
+
+/**
+ * @brief writes a little-endian 32-bit word
+ *
+ * @param archive_file the archive
+ * @param word the word
+ */
+static void asm_archive_write_word(FILE *archive_file, uint32_t word)
+{
+    fputc(word & 0xFF, archive_file);
+    fputc((word >> 8) & 0xFF, archive_file);
+    fputc((word >> 16) & 0xFF, archive_file);
+    fputc((word >> 24) & 0xFF, archive_file);
+}
+
+/**
+ * @brief reads a little-endian 32-bit word
+ *
+ * @param data the word
+ * @return uint32_t the word
+ */
+static uint32_t asm_archive_read_word(unsigned char *data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+/**
+ * @brief pads the archive with zeros to the next multiple of the alignment
+ *
+ * @param archive_file the archive
+ * @param size the size that was written
+ */
+static void asm_archive_pad(FILE *archive_file, size_t size)
+{
+    for (; size % ARCHIVE_ALIGNMENT; size++)
+    {
+        fputc('\0', archive_file);
+    }
+}
+
+/**
+ * @brief reads a whole file
+ *
+ * @param path the path of the file
+ * @param member returns the content and the size of the file
+ * @return bool false if the file couldn't be read
+ */
+static bool asm_archive_read_file(char *path, archive_member_t *member)
+{
+    FILE *file;
+    char buffer[BUFSIZ];
+    size_t read;
+
+    if (!(file = asm_io_open(path, "r")))
+    {
+        return false;
+    }
+    member->data = NULL;
+    member->size = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        member->data = asm_alloc_realloc(ALLOC_OUTPUT, member->data, member->size + read);
+        assert("Memory allocation failed" && member->data != NULL);
+        memcpy(member->data + member->size, buffer, read);
+        member->size += read;
+    }
+    asm_io_close(file);
+
+    return true;
+}
+
+/**
+ * @brief adds the entry labels of a .ent member ("NAME,base,offset" lines)
+ *
+ * @param member the .ent member
+ * @param ob_member the index of the .ob member of the module
+ * @param symbols the symbols
+ * @param count the number of symbols (updated)
+ * @param capacity the capacity of the symbols (updated)
+ * @return bool false if a line is too long to be read
+ */
+static bool asm_archive_add_entries(archive_member_t *member, int ob_member, archive_symbol_t **symbols, int *count, int *capacity)
+{
+    char line[LINE_LENGTH];
+    size_t start;
+    size_t end;
+    int base;
+    int offset;
+
+    for (start = 0; start < member->size; start = end + 1)
+    {
+        for (end = start; end < member->size && member->data[end] != '\n'; end++)
+            ;
+        if (end - start >= LINE_LENGTH)
+        {
+            return false;
+        }
+        memcpy(line, member->data + start, end - start);
+        line[end - start] = '\0';
+
+        if (*count == *capacity)
+        {
+            *capacity = *capacity ? *capacity << 1 : 64;
+            *symbols = asm_alloc_realloc(ALLOC_OUTPUT, *symbols, *capacity * sizeof(archive_symbol_t));
+            assert("Memory allocation failed" && *symbols != NULL);
+        }
+        if (sscanf(line, "%31[^,],%d,%d", (*symbols)[*count].name, &base, &offset) == 3)
+        {
+            (*symbols)[*count].address = base + offset;
+            (*symbols)[(*count)++].member = ob_member;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief compares symbols by their name and then by their module (qsort
+ * comparator)
+ *
+ * @param first a symbol
+ * @param second a symbol
+ * @return int the order of the symbols
+ */
+static int asm_archive_compare_symbols(const void *first, const void *second)
+{
+    const archive_symbol_t *first_symbol = first;
+    const archive_symbol_t *second_symbol = second;
+    int order = strcmp(first_symbol->name, second_symbol->name);
+
+    return order ? order : first_symbol->member - second_symbol->member;
+}
+
+/**
+ * @brief builds the directory of the archive, the first module that
+ * exports a symbol gets it
+ *
+ * @param symbols the entry labels of all of the modules
+ * @param count the number of entry labels
+ * @param members the members
+ * @param directory returns the .sym file of the directory
+ * @param size returns the size of the directory
+ */
+static void asm_archive_build_directory(archive_symbol_t *symbols, int count, archive_member_t *members, char **directory, size_t *size)
+{
+    asm_symbols_t *index;
+    FILE *directory_file;
+    int symbol;
+
+    qsort(symbols, count, sizeof(archive_symbol_t), asm_archive_compare_symbols);
+    index = asm_symbols_create();
+    for (symbol = 0; symbol < count; symbol++)
+    {
+        if (symbol > 0 && strcmp(symbols[symbol].name, symbols[symbol - 1].name) == 0)
+        {
+            fprintf(stderr, "%s is exported by %s and %s, the first is kept\n", symbols[symbol].name,
+                    members[symbols[symbol - 1].member].name, members[symbols[symbol].member].name);
+        }
+        else
+        {
+            /* the references of a directory symbol are the index of its .ob member */
+            asm_symbols_add(index, symbols[symbol].name, symbols[symbol].address, ENTRY_FLAG, symbols[symbol].member);
+        }
+    }
+
+    directory_file = open_memstream(directory, size);
+    assert("Memory allocation failed" && directory_file != NULL);
+    asm_symbols_write(directory_file, index);
+    fclose(directory_file);
+    asm_symbols_destroy(index);
+}
+
+/**
+ * @brief writes the archive
+ *
+ * @param archive_file the archive
+ * @param members the members
+ * @param count the number of members
+ * @param directory the .sym file of the directory
+ * @param directory_size the size of the directory
+ */
+static void asm_archive_write(FILE *archive_file, archive_member_t *members, int count, char *directory, size_t directory_size)
+{
+    uint32_t names_size = 0;
+    uint32_t offset;
+    int member;
+
+    for (member = 0; member < count; member++)
+    {
+        names_size += strlen(members[member].name) + 1;
+    }
+    offset = ARCHIVE_ALIGN((ARCHIVE_HEADER_WORDS + count * ARCHIVE_MEMBER_WORDS) * 4) + ARCHIVE_ALIGN(names_size);
+    for (member = 0; member < count; member++)
+    {
+        members[member].offset = offset;
+        offset += ARCHIVE_ALIGN(members[member].size);
+    }
+
+    fputs(ARCHIVE_MAGIC, archive_file);
+    asm_archive_write_word(archive_file, ARCHIVE_VERSION);
+    asm_archive_write_word(archive_file, count);
+    asm_archive_write_word(archive_file, offset);
+    asm_archive_write_word(archive_file, directory_size);
+    asm_archive_write_word(archive_file, names_size);
+
+    names_size = 0;
+    for (member = 0; member < count; member++)
+    {
+        asm_archive_write_word(archive_file, names_size);
+        asm_archive_write_word(archive_file, members[member].offset);
+        asm_archive_write_word(archive_file, members[member].size);
+        names_size += strlen(members[member].name) + 1;
+    }
+    asm_archive_pad(archive_file, (ARCHIVE_HEADER_WORDS + count * ARCHIVE_MEMBER_WORDS) * 4);
+    for (member = 0; member < count; member++)
+    {
+        fputs(members[member].name, archive_file);
+        fputc('\0', archive_file);
+    }
+    asm_archive_pad(archive_file, names_size);
+
+    for (member = 0; member < count; member++)
+    {
+        fwrite(members[member].data, 1, members[member].size, archive_file);
+        asm_archive_pad(archive_file, members[member].size);
+    }
+    fwrite(directory, 1, directory_size, archive_file);
+}
+
+bool asm_archive_create(char *path, char **modules, int count, char **error)
+{
+    archive_member_t *members;
+    archive_symbol_t *symbols = NULL;
+    FILE *archive_file;
+    char *file;
+    char *base_name;
+    char *directory;
+    size_t directory_size;
+    int members_count = 0;
+    int symbols_count = 0;
+    int symbols_capacity = 0;
+    int module;
+    int suffix;
+    bool is_read = true;
+
+    members = asm_alloc_malloc(ALLOC_OUTPUT, (count * ARCHIVE_SUFFIXES_COUNT + 1) * sizeof(archive_member_t));
+    assert("Memory allocation failed" && members != NULL);
+
+    for (module = 0; module < count && is_read; module++)
+    {
+        file = asm_alloc_malloc(ALLOC_OUTPUT, strlen(modules[module]) + sizeof(".ent"));
+        assert("Memory allocation failed" && file != NULL);
+        /* the members are named without their directory, so they are extracted to the working directory */
+        base_name = strrchr(modules[module], '/') ? strrchr(modules[module], '/') + 1 : modules[module];
+
+        for (suffix = 0; suffix < ARCHIVE_SUFFIXES_COUNT && is_read; suffix++)
+        {
+            sprintf(file, "%s%s", modules[module], suffixes[suffix]);
+            if (asm_archive_read_file(file, &(members[members_count])))
+            {
+                members[members_count].name = asm_alloc_malloc(ALLOC_OUTPUT, strlen(base_name) + strlen(suffixes[suffix]) + 1);
+                assert("Memory allocation failed" && members[members_count].name != NULL);
+                sprintf(members[members_count].name, "%s%s", base_name, suffixes[suffix]);
+                if (suffix == 1 && !asm_archive_add_entries(&(members[members_count]), members_count - 1, &symbols, &symbols_count, &symbols_capacity))
+                {
+                    *error = "A line of a .ent file is too long";
+                    is_read = false;
+                }
+                ++members_count;
+            }
+            else if (suffix == 0)
+            {
+                /* a module without a .ob file wasn't assembled */
+                *error = "Couldn't open the .ob file of a module";
+                is_read = false;
+                break;
+            }
+        }
+        asm_alloc_free(file);
+    }
+
+    if (is_read)
+    {
+        asm_archive_build_directory(symbols, symbols_count, members, &directory, &directory_size);
+        archive_file = asm_io_open(path, "w");
+        asm_archive_write(archive_file, members, members_count, directory, directory_size);
+        asm_io_close(archive_file);
+        free(directory);
+    }
+
+    while (members_count-- > 0)
+    {
+        asm_alloc_free(members[members_count].name);
+        asm_alloc_free(members[members_count].data);
+    }
+    asm_alloc_free(members);
+    asm_alloc_free(symbols);
+    return is_read;
+}
+
+asm_archive_t *asm_archive_open(char *path)
+{
+    asm_archive_t *archive;
+    struct stat status;
+    uint32_t directory_offset;
+    uint32_t directory_size;
+    size_t names_offset;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+    {
+        return NULL;
+    }
+    archive = asm_alloc_calloc(ALLOC_OUTPUT, 1, sizeof(asm_archive_t));
+    assert("Memory allocation failed" && archive != NULL);
+    if (fstat(fd, &status) != 0 || status.st_size < ARCHIVE_HEADER_WORDS * 4
+        || (archive->data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        asm_alloc_free(archive);
+        return NULL;
+    }
+    close(fd);
+    archive->size = status.st_size;
+
+    archive->count = asm_archive_read_word(archive->data + 8);
+    directory_offset = asm_archive_read_word(archive->data + 12);
+    directory_size = asm_archive_read_word(archive->data + 16);
+    archive->names_size = asm_archive_read_word(archive->data + 20);
+    names_offset = ARCHIVE_ALIGN((ARCHIVE_HEADER_WORDS + (size_t)archive->count * ARCHIVE_MEMBER_WORDS) * 4);
+    archive->members = archive->data + ARCHIVE_HEADER_WORDS * 4;
+    archive->names = (char *)archive->data + names_offset;
+
+    /* the members are checked only when they are read, so opening an archive doesn't read all of it */
+    if (memcmp(archive->data, ARCHIVE_MAGIC, strlen(ARCHIVE_MAGIC)) != 0 || asm_archive_read_word(archive->data + 4) != ARCHIVE_VERSION
+        || archive->count > archive->size || archive->names_size > archive->size
+        || (size_t)names_offset + archive->names_size > archive->size
+        || (archive->names_size > 0 && archive->names[archive->names_size - 1] != '\0')
+        || directory_offset > archive->size || directory_size > archive->size - directory_offset
+        || !(archive->directory = asm_symbol_index_view(archive->data + directory_offset, directory_size)))
+    {
+        asm_archive_close(archive);
+        return NULL;
+    }
+
+    return archive;
+}
+
+int asm_archive_get_count(asm_archive_t *archive)
+{
+    return archive->count;
+}
+
+void asm_archive_get_member(asm_archive_t *archive, int member, char **name, unsigned char **data, size_t *size)
+{
+    unsigned char *entry = archive->members + (size_t)member * ARCHIVE_MEMBER_WORDS * 4;
+    uint32_t name_offset = asm_archive_read_word(entry);
+    uint32_t offset = asm_archive_read_word(entry + 4);
+
+    *name = name_offset < archive->names_size ? archive->names + name_offset : "";
+    *size = asm_archive_read_word(entry + 8);
+    if (offset > archive->size || *size > archive->size - offset)
+    {
+        offset = 0;
+        *size = 0;
+    }
+    *data = archive->data + offset;
+}
+
+bool asm_archive_find(asm_archive_t *archive, char *symbol, int *member, long *address)
+{
+    asm_symbol_t found;
+
+    if (!asm_symbol_index_find(archive->directory, symbol, &found) || found.references >= archive->count)
+    {
+        return false;
+    }
+    *member = found.references;
+    *address = found.value;
+    return true;
+}
+
+void asm_archive_close(asm_archive_t *archive)
+{
+    if (archive->directory)
+    {
+        asm_symbol_index_close(archive->directory);
+    }
+    munmap(archive->data, archive->size);
+    asm_alloc_free(archive);
+}
\ No newline at end of file
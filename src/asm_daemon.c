@@ -0,0 +1,444 @@
+#define _POSIX_C_SOURCE 200809L
+#include "asm_daemon.h"
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/inotify.h>
+
+#define INOTIFY_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+#define INOTIFY_BUFFER_SIZE 4096
+#define LISTEN_BACKLOG 8
+#define COMMAND_LENGTH 16
+#define CLIENT_TIMEOUT_SECONDS 5 /* a client that doesn't send its request in time is dropped */
+
+typedef struct watched_file_t
+{
+    char *name;        /* the file as given in the command line */
+    char *source_name; /* the .as file name without its directory */
+    int wd;            /* the inotify watch of the file's directory */
+    asm_incremental_t *incremental; /* the previous build, for reassembling only the changed lines */
+} watched_file_t;
+
+static volatile sig_atomic_t is_running;
+static linked_list_node_t *watched_files;
+static int inotify_fd = -1;
+
+/**
+ * @brief stops the daemon's loop (signal handler)
+ *
+ * @param signal_number the received signal
+ */
+static void asm_daemon_stop(int signal_number)
+{
+    (void)signal_number;
+    is_running = 0;
+}
+
+/**
+ * @brief builds the given file and reports the result to the given output
+ *
+ * @param file the file (without the .as suffix)
+ * @param output the output for the diagnostics and the result
+ * @param incremental the state of the file's previous build (NULL to build
+ * the entire file)
+ * @return bool true if the file was assembled without errors
+ */
+static bool asm_daemon_build(char *file, FILE *output, asm_incremental_t *incremental)
+{
+    char *source_name;
+    FILE *source;
+    unsigned int errors_count;
+
+    source_name = (char*)asm_alloc_malloc(ALLOC_SERVICE, strlen(file) + 4);
+    assert("Memory allocation failed" && source_name != NULL);
+    sprintf(source_name, "%s.as", file);
+    source = fopen(source_name, "r");
+    asm_alloc_free(source_name);
+
+    if (!source)
+    {
+        fprintf(output, "failed %s.as doesn't exist\n", file);
+        return false;
+    }
+    fclose(source);
+
+    errors_set_output(output);
+    if (incremental)
+    {
+        assembler_on_file_incremental(file, incremental);
+    }
+    else
+    {
+        assembler_on_file(file);
+    }
+    errors_set_output(NULL);
+
+    errors_count = errors_get_count();
+    if (errors_count)
+    {
+        fprintf(output, "failed %u\n", errors_count);
+    }
+    else
+    {
+        fprintf(output, "ok\n");
+    }
+    fflush(output);
+
+    return errors_count == 0;
+}
+
+/**
+ * @brief starts watching the directory of the given file and adds the file
+ * to the watched files (a file that is already watched, under any of its
+ * names, is kept as it is)
+ *
+ * @param file the file (without the .as suffix)
+ * @return watched_file_t* the watched file (NULL if it can't be watched)
+ */
+static watched_file_t *asm_daemon_watch(char *file)
+{
+    watched_file_t *watched;
+    linked_list_node_t *node;
+    char *directory;
+    char *separator;
+    int wd;
+
+    directory = (char*)asm_alloc_malloc(ALLOC_SERVICE, strlen(file) + 2);
+    assert("Memory allocation failed" && directory != NULL);
+    strcpy(directory, file);
+    if ((separator = strrchr(directory, '/')))
+    {
+        separator[1] = '\0';
+    }
+    else
+    {
+        strcpy(directory, ".");
+    }
+    wd = inotify_add_watch(inotify_fd, directory, INOTIFY_MASK);
+    asm_alloc_free(directory);
+
+    if (wd < 0)
+    {
+        return NULL;
+    }
+
+    /* a directory has a single watch, so the same file has the same watch and source name */
+    separator = strrchr(file, '/');
+    separator = separator ? separator + 1 : file;
+    for (node = watched_files; node; node = linked_list_get_next_address(node))
+    {
+        watched = linked_list_get_info(node);
+        if (watched->wd == wd && strlen(watched->source_name) == strlen(separator) + 3
+            && strncmp(watched->source_name, separator, strlen(separator)) == 0)
+        {
+            return watched;
+        }
+    }
+
+    watched = (watched_file_t*)asm_alloc_malloc(ALLOC_SERVICE, sizeof(watched_file_t));
+    assert("Memory allocation failed" && watched != NULL);
+    watched->name = (char*)asm_alloc_malloc(ALLOC_SERVICE, strlen(file) + 1);
+    assert("Memory allocation failed" && watched->name != NULL);
+    strcpy(watched->name, file);
+
+    watched->source_name = (char*)asm_alloc_malloc(ALLOC_SERVICE, strlen(separator) + 4);
+    assert("Memory allocation failed" && watched->source_name != NULL);
+    sprintf(watched->source_name, "%s.as", separator);
+    watched->wd = wd;
+    watched->incremental = asm_incremental_create();
+
+    linked_list_push(&watched_files);
+    linked_list_set_info(watched_files, watched);
+    return watched;
+}
+
+/**
+ * @brief frees all of the watched files
+ */
+static void asm_daemon_destroy_watched_files()
+{
+    watched_file_t *watched;
+
+    while (watched_files)
+    {
+        watched = linked_list_get_info(watched_files);
+        asm_alloc_free(watched->name);
+        asm_alloc_free(watched->source_name);
+        asm_incremental_destroy(watched->incremental);
+        asm_alloc_free(watched);
+        linked_list_pop(&watched_files);
+    }
+}
+
+/**
+ * @brief reassembles the watched files whose .as file has changed
+ */
+static void asm_daemon_on_inotify()
+{
+    union
+    {
+        struct inotify_event event;
+        char bytes[INOTIFY_BUFFER_SIZE];
+    } buffer;
+    struct inotify_event *event;
+    linked_list_node_t *node;
+    watched_file_t *watched;
+    ssize_t length;
+    ssize_t offset;
+
+    length = read(inotify_fd, buffer.bytes, INOTIFY_BUFFER_SIZE);
+    for (offset = 0; offset < length; offset += sizeof(struct inotify_event) + event->len)
+    {
+        event = (struct inotify_event*)(buffer.bytes + offset);
+        for (node = watched_files; node && event->len; node = linked_list_get_next_address(node))
+        {
+            watched = linked_list_get_info(node);
+            if (watched->wd == event->wd && strcmp(watched->source_name, event->name) == 0)
+            {
+                printf("%s\n", watched->name);
+                asm_daemon_build(watched->name, stdout, watched->incremental);
+            }
+        }
+    }
+}
+
+/**
+ * @brief returns the watched file with the given name
+ *
+ * @param file the file (without the .as suffix)
+ * @return watched_file_t* the watched file (NULL if it isn't watched)
+ */
+static watched_file_t *asm_daemon_find_watched(char *file)
+{
+    linked_list_node_t *node;
+
+    for (node = watched_files; node; node = linked_list_get_next_address(node))
+    {
+        if (strcmp(((watched_file_t*)linked_list_get_info(node))->name, file) == 0)
+        {
+            return linked_list_get_info(node);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief handles a single request of a connected client
+ *
+ * @param client the client's socket
+ */
+static void asm_daemon_on_client(int client)
+{
+    char request[ASM_DAEMON_REQUEST_LENGTH];
+    char command[COMMAND_LENGTH];
+    char *argument;
+    watched_file_t *watched;
+    struct timeval timeout;
+    FILE *input;
+    FILE *output;
+    int output_fd;
+    int command_length;
+
+    /* the daemon serves one client at a time, so a silent client can't stall the builds and the watched files */
+    timeout.tv_sec = CLIENT_TIMEOUT_SECONDS;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    /* each stream owns its own descriptor, so a stream that was opened is closed only by fclose */
+    if (!(input = fdopen(client, "r")))
+    {
+        close(client);
+        return;
+    }
+    if ((output_fd = dup(client)) < 0 || !(output = fdopen(output_fd, "w")))
+    {
+        if (output_fd >= 0)
+        {
+            close(output_fd);
+        }
+        fclose(input);
+        return;
+    }
+
+    command[0] = '\0';
+    if (fgets(request, ASM_DAEMON_REQUEST_LENGTH, input)
+        && sscanf(request, "%15s %n", command, &command_length) == 1)
+    {
+        argument = request + command_length;
+        argument[strcspn(argument, "\r\n")] = '\0';
+
+        if (strcmp(command, "build") == 0 && *argument)
+        {
+            watched = asm_daemon_find_watched(argument);
+            asm_daemon_build(argument, output, watched ? watched->incremental : NULL);
+        }
+        else if (strcmp(command, "watch") == 0 && *argument)
+        {
+            fprintf(output, asm_daemon_watch(argument) ? "ok\n" : "failed can't watch %s\n", argument);
+        }
+        else if (strcmp(command, "shutdown") == 0)
+        {
+            is_running = 0;
+            fprintf(output, "ok\n");
+        }
+        else
+        {
+            fprintf(output, "failed unknown request\n");
+        }
+    }
+
+    fclose(output);
+    fclose(input);
+}
+
+/**
+ * @brief creates the daemon's listening socket
+ *
+ * @param socket_path the path of the socket
+ * @return int the socket (-1 on failure)
+ */
+static int asm_daemon_listen(char *socket_path)
+{
+    struct sockaddr_un address;
+    int listener;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener >= 0)
+    {
+        unlink(socket_path);
+        if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0
+            || listen(listener, LISTEN_BACKLOG) < 0)
+        {
+            close(listener);
+            listener = -1;
+        }
+    }
+    return listener;
+}
+
+int asm_daemon_run(char *socket_path, int files_count, char *files[])
+{
+    struct pollfd fds[2];
+    struct sigaction action;
+    watched_file_t *watched;
+    int listener;
+    int client;
+    int offset;
+
+    inotify_fd = inotify_init();
+    listener = asm_daemon_listen(socket_path);
+    if (inotify_fd < 0 || listener < 0)
+    {
+        fprintf(stderr, "Couldn't start the daemon on %s\n", socket_path);
+        if (inotify_fd >= 0)
+        {
+            close(inotify_fd);
+        }
+        return -1;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = asm_daemon_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (offset = 0; offset < files_count; offset++)
+    {
+        if ((watched = asm_daemon_watch(files[offset])))
+        {
+            printf("%s\n", files[offset]);
+            asm_daemon_build(files[offset], stdout, watched->incremental);
+        }
+        else
+        {
+            fprintf(stderr, "Couldn't watch %s\n", files[offset]);
+        }
+    }
+
+    fds[0].fd = inotify_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = listener;
+    fds[1].events = POLLIN;
+
+    is_running = 1;
+    while (is_running)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            asm_daemon_on_inotify();
+        }
+        if ((fds[1].revents & POLLIN) && (client = accept(listener, NULL, NULL)) >= 0)
+        {
+            asm_daemon_on_client(client);
+        }
+    }
+
+    close(listener);
+    unlink(socket_path);
+    close(inotify_fd);
+    inotify_fd = -1;
+    asm_daemon_destroy_watched_files();
+
+    return 0;
+}
+
+int asm_daemon_request(char *socket_path, char *request, FILE *output)
+{
+    struct sockaddr_un address;
+    char line[ASM_DAEMON_REQUEST_LENGTH];
+    FILE *reply;
+    int server;
+    bool is_ok = false;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)
+        || (server = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    if (connect(server, (struct sockaddr*)&address, sizeof(address)) < 0
+        || write(server, request, strlen(request)) < 0
+        || write(server, "\n", 1) < 0
+        || !(reply = fdopen(server, "r")))
+    {
+        close(server);
+        return -1;
+    }
+    shutdown(server, SHUT_WR);
+
+    while (fgets(line, ASM_DAEMON_REQUEST_LENGTH, reply))
+    {
+        fputs(line, output);
+        is_ok = strcmp(line, "ok\n") == 0;
+    }
+    fclose(reply);
+
+    return is_ok ? 0 : -1;
+}
@@ -0,0 +1,400 @@
+#define _POSIX_C_SOURCE 200809L
+#include "asm_incremental.h"
+#include "assembler.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define OB_HEADER_LENGTH 10 /* "%4d\t%4d\n" */
+#define OB_LINE_LENGTH 20   /* "%04d\t" and five "Xx" parts separated by "-" */
+
+typedef struct incremental_line_t
+{
+    char text[LINE_LENGTH];   /* the line after its macros were opened */
+    unsigned long text_hash;
+    uint16_t ic;              /* the code words of the line */
+    uint16_t dc;              /* the data words of the line */
+    uint16_t bss;             /* the words the line reserved */
+    bool has_errors;
+    labels_table_t *journal;  /* the line's label changes (NULL if it has none) */
+} incremental_line_t;
+
+typedef struct incremental_lines_t
+{
+    incremental_line_t *lines;
+    int count;
+    int capacity;
+    FILE *am_file;
+} incremental_lines_t;
+
+struct asm_incremental_t
+{
+    incremental_lines_t lines;
+    memory_t *image;        /* the words of all of the lines, before the labels were inserted */
+    memory_t *line_memory;  /* the words of a single line that is being encoded */
+    char *ob_text;          /* the .ob file that was written last */
+    size_t ob_length;
+    struct stat ob_status;  /* the .ob file right after it was written */
+};
+
+/**
+ * @brief creates a memory that isn't the instance of the thread
+ *
+ * @return memory_t* the memory
+ */
+static memory_t *asm_incremental_create_memory()
+{
+    memory_t *previous;
+    memory_t *memory;
+
+    previous = asm_memory_set_instance(NULL);
+    memory = asm_memory_get_instance();
+    asm_memory_set_instance(previous);
+
+    return memory;
+}
+
+/**
+ * @brief frees the journals of the lines
+ *
+ * @param lines the lines
+ */
+static void asm_incremental_destroy_journals(incremental_lines_t *lines)
+{
+    int line;
+
+    for (line = 0; line < lines->count; line++)
+    {
+        if (lines->lines[line].journal)
+        {
+            labels_table_destroy(lines->lines[line].journal);
+            lines->lines[line].journal = NULL;
+        }
+    }
+}
+
+/**
+ * @brief adds a line after its macros were opened and writes it to the am
+ * file (macro line handler)
+ *
+ * @param text the line
+ * @param lines the lines
+ */
+static void asm_incremental_on_expanded_line(char *text, void *lines)
+{
+    incremental_lines_t *current = lines;
+    incremental_line_t *line;
+
+    fputs(text, current->am_file);
+    if (current->count == current->capacity)
+    {
+        current->capacity = current->capacity ? current->capacity << 1 : 64;
+        current->lines = asm_alloc_realloc(ALLOC_PASSES, current->lines, current->capacity * sizeof(incremental_line_t));
+        assert("Memory allocation failed" && current->lines != NULL);
+    }
+
+    line = &(current->lines[current->count++]);
+    strcpy(line->text, text);
+    line->text_hash = hash(text);
+    line->journal = NULL;
+}
+
+/**
+ * @brief checks if two lines have the same text
+ *
+ * @param first a line
+ * @param second a line
+ * @return bool true if the lines are the same
+ */
+static bool asm_incremental_is_same_line(incremental_line_t *first, incremental_line_t *second)
+{
+    return first->text_hash == second->text_hash && strcmp(first->text, second->text) == 0;
+}
+
+/**
+ * @brief moves the encoding of an old line to a new line with the same text
+ *
+ * @param line the new line
+ * @param old_line the old line
+ */
+static void asm_incremental_reuse_line(incremental_line_t *line, incremental_line_t *old_line)
+{
+    line->ic = old_line->ic;
+    line->dc = old_line->dc;
+    line->bss = old_line->bss;
+    line->has_errors = old_line->has_errors;
+    line->journal = old_line->journal;
+    old_line->journal = NULL;
+}
+
+/**
+ * @brief encodes a single line on its own and appends its words to the
+ * image. Its labels are kept in a journal that is replayed with the line's
+ * actual ic
+ *
+ * @param state the state
+ * @param image the image the words are appended to
+ * @param line the line
+ */
+static void asm_incremental_encode_line(asm_incremental_t *state, memory_t *image, incremental_line_t *line)
+{
+    char text[LINE_LENGTH];
+    labels_table_t *previous_table;
+    memory_t *previous_memory;
+    unsigned int errors_count;
+
+    strcpy(text, line->text);
+    errors_count = errors_get_count();
+
+    previous_memory = asm_memory_set_instance(state->line_memory);
+    previous_table = labels_table_set_instance(NULL);
+    line->journal = labels_table_get_instance();
+    labels_table_start_journal(line->journal);
+
+    assembler_analyze_line(text, line->journal);
+
+    /* a line that depends on its pc is encoded again with the rest of the file */
+    line->has_errors = errors_get_count() != errors_count || labels_table_is_position_dependent(line->journal);
+    line->ic = asm_memory_get_ic(state->line_memory);
+    line->dc = asm_memory_get_dc(state->line_memory);
+    line->bss = asm_memory_get_bss(state->line_memory);
+    asm_memory_append(image, state->line_memory);
+    asm_memory_reset(state->line_memory);
+    asm_memory_set_instance(previous_memory);
+    labels_table_set_instance(previous_table);
+
+    if (!labels_table_has_journal(line->journal))
+    {
+        labels_table_destroy(line->journal);
+        line->journal = NULL;
+    }
+}
+
+asm_incremental_t *asm_incremental_create()
+{
+    asm_incremental_t *state;
+
+    state = asm_alloc_calloc(ALLOC_PASSES, 1, sizeof(asm_incremental_t));
+    assert("Memory allocation failed" && state != NULL);
+    state->image = asm_incremental_create_memory();
+    state->line_memory = asm_incremental_create_memory();
+
+    return state;
+}
+
+bool asm_incremental_first_pass(asm_incremental_t *state, FILE *as_file, FILE *am_file, labels_table_t *labels_table, memory_t *memory)
+{
+    incremental_lines_t old_lines = state->lines;
+    incremental_lines_t *lines = &(state->lines);
+    memory_t *image;
+    int prefix;
+    int suffix;
+    int line;
+    int ic = 0;
+    int dc = 0;
+    int suffix_ic = 0;
+    int suffix_dc = 0;
+    int bss;
+    bool is_valid = true;
+
+    lines->lines = NULL;
+    lines->count = 0;
+    lines->capacity = 0;
+    lines->am_file = am_file;
+    macro_expand(as_file, asm_incremental_on_expanded_line, lines);
+
+    /* the lines are encoded while the errors are muted, they are reported by the caller */
+    errors_set_muted(true);
+    image = asm_incremental_create_memory();
+
+    for (prefix = 0; prefix < lines->count && prefix < old_lines.count
+         && asm_incremental_is_same_line(&(lines->lines[prefix]), &(old_lines.lines[prefix])); prefix++)
+    {
+        asm_incremental_reuse_line(&(lines->lines[prefix]), &(old_lines.lines[prefix]));
+        ic += lines->lines[prefix].ic;
+        dc += lines->lines[prefix].dc;
+    }
+    asm_memory_append_range(image, state->image, 0, ic, 0, dc);
+
+    for (suffix = 0; suffix < lines->count - prefix && suffix < old_lines.count - prefix
+         && asm_incremental_is_same_line(&(lines->lines[lines->count - 1 - suffix]), &(old_lines.lines[old_lines.count - 1 - suffix])); suffix++)
+    {
+        asm_incremental_reuse_line(&(lines->lines[lines->count - 1 - suffix]), &(old_lines.lines[old_lines.count - 1 - suffix]));
+        suffix_ic += lines->lines[lines->count - 1 - suffix].ic;
+        suffix_dc += lines->lines[lines->count - 1 - suffix].dc;
+    }
+
+    for (line = prefix; line < lines->count - suffix; line++)
+    {
+        asm_incremental_encode_line(state, image, &(lines->lines[line]));
+    }
+
+    /* the words after the changed span are shifted to their new addresses at once */
+    asm_memory_append_range(image, state->image, asm_memory_get_ic(state->image) - suffix_ic, suffix_ic,
+                            asm_memory_get_dc(state->image) - suffix_dc, suffix_dc);
+
+    asm_incremental_destroy_journals(&old_lines);
+    asm_alloc_free(old_lines.lines);
+    asm_memory_destroy(state->image);
+    state->image = image;
+
+    ic = 0;
+    dc = 0;
+    bss = 0;
+    for (line = 0; line < lines->count; line++)
+    {
+        is_valid = is_valid && !lines->lines[line].has_errors;
+        if (lines->lines[line].journal)
+        {
+            labels_table_replay_journal(labels_table, lines->lines[line].journal, ic, ic + dc + bss);
+        }
+        ic += lines->lines[line].ic;
+        dc += lines->lines[line].dc;
+        bss += lines->lines[line].bss;
+    }
+    labels_table_check_labels_validity_proxy(labels_table);
+    is_valid = is_valid && errors_get_count() == 0 && !asm_memory_is_full(image);
+    if (asm_memory_is_full(image))
+    {
+        /* the image lost words, so none of its lines can be reused */
+        asm_incremental_destroy_journals(lines);
+        lines->count = 0;
+    }
+
+    errors_set_muted(false);
+    errors_reset();
+    if (is_valid)
+    {
+        asm_memory_append(memory, image);
+    }
+    else
+    {
+        labels_table_reset(labels_table);
+    }
+
+    return is_valid;
+}
+
+/**
+ * @brief writes the given range of the .ob file
+ *
+ * @param fd the .ob file
+ * @param text the content of the .ob file
+ * @param start the start of the range
+ * @param end the end of the range
+ * @return bool true if the range was written
+ */
+static bool asm_incremental_write_range(int fd, char *text, size_t start, size_t end)
+{
+    ssize_t written;
+
+    while (start < end)
+    {
+        if ((written = pwrite(fd, text + start, end - start, start)) < 0)
+        {
+            return false;
+        }
+        start += written;
+    }
+    return true;
+}
+
+/**
+ * @brief rewrites only the lines of the .ob file that differ from the
+ * previous run
+ *
+ * @param state the state
+ * @param fd the .ob file, as it was written last
+ * @param text the new content of the .ob file
+ * @param length the length of the new content
+ * @return bool true if the file was updated
+ */
+static bool asm_incremental_patch_ob(asm_incremental_t *state, int fd, char *text, size_t length)
+{
+    size_t offset = 0;
+    size_t next;
+    size_t run_start = 0;
+    bool is_in_run = false;
+    bool is_ok = true;
+
+    while (offset < length && is_ok)
+    {
+        next = offset + (offset == 0 ? OB_HEADER_LENGTH : OB_LINE_LENGTH);
+        next = next < length ? next : length;
+        if (next > state->ob_length || memcmp(text + offset, state->ob_text + offset, next - offset) != 0)
+        {
+            if (!is_in_run)
+            {
+                run_start = offset;
+                is_in_run = true;
+            }
+        }
+        else if (is_in_run)
+        {
+            is_ok = asm_incremental_write_range(fd, text, run_start, offset);
+            is_in_run = false;
+        }
+        offset = next;
+    }
+    if (is_in_run && is_ok)
+    {
+        is_ok = asm_incremental_write_range(fd, text, run_start, length);
+    }
+
+    return is_ok && (length >= state->ob_length || ftruncate(fd, length) == 0);
+}
+
+void asm_incremental_write_ob(asm_incremental_t *state, char *path, memory_t *memory)
+{
+    FILE *formatted;
+    char *text = NULL;
+    size_t length = 0;
+    struct stat status;
+    int fd;
+    bool is_patched = false;
+
+    formatted = open_memstream(&text, &length);
+    assert("Memory allocation failed" && formatted != NULL);
+    asm_output_ob_file(formatted, memory);
+    fclose(formatted);
+
+    /* the file is patched only if nobody else changed it since it was written */
+    if (state->ob_text && (fd = open(path, O_WRONLY)) >= 0)
+    {
+        if (fstat(fd, &status) == 0 && status.st_ino == state->ob_status.st_ino
+            && status.st_size == state->ob_status.st_size
+            && status.st_mtim.tv_sec == state->ob_status.st_mtim.tv_sec
+            && status.st_mtim.tv_nsec == state->ob_status.st_mtim.tv_nsec)
+        {
+            is_patched = asm_incremental_patch_ob(state, fd, text, length);
+        }
+        close(fd);
+    }
+    if (!is_patched && (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) >= 0)
+    {
+        if (!asm_incremental_write_range(fd, text, 0, length))
+        {
+            fprintf(stderr, "Couldn't write %s\n", path);
+        }
+        close(fd);
+    }
+
+    free(state->ob_text);
+    state->ob_text = text;
+    state->ob_length = length;
+    if (stat(path, &(state->ob_status)) != 0)
+    {
+        free(state->ob_text);
+        state->ob_text = NULL;
+    }
+}
+
+void asm_incremental_destroy(asm_incremental_t *state)
+{
+    asm_incremental_destroy_journals(&(state->lines));
+    asm_alloc_free(state->lines.lines);
+    asm_memory_destroy(state->image);
+    asm_memory_destroy(state->line_memory);
+    free(state->ob_text);
+    asm_alloc_free(state);
+}
\ No newline at end of file
@@ -0,0 +1,820 @@
+#define _GNU_SOURCE
+#include "asm_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES 64
+#define REQUEST_KIND_MASK 7
+#define COMPARE_BUFFER_SIZE 4096
+
+#define LOAD_ACQUIRE(pointer) __atomic_load_n(pointer, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELEASE)
+
+typedef enum
+{
+    REQUEST_READ,
+    REQUEST_WRITE,
+    REQUEST_CLOSE,
+    REQUEST_UNLINK,
+    REQUEST_RENAME
+} request_e;
+
+/* a source that is read ahead or an output that is being written */
+typedef struct io_file_t
+{
+    char *path;
+    char *temp_path; /* an output is written here and then renamed to the path */
+    FILE *file;     /* the stream given to the caller */
+    char *buffer;   /* the content of the file */
+    size_t size;
+    int fd;
+    int pending;    /* requests in flight */
+    bool is_open;   /* the caller hasn't closed the stream yet */
+    bool is_ready;  /* the content of a source was read */
+    bool is_output;
+    struct io_file_t *next;
+} io_file_t;
+
+typedef struct uring_t
+{
+    int fd;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int sq_entries;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    unsigned int cq_entries;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    unsigned int to_submit; /* requests that weren't submitted yet */
+    unsigned int in_flight; /* submitted requests that weren't completed */
+} uring_t;
+
+static uring_t uring;
+static bool is_uring_used;
+static io_file_t *files; /* sources and outputs that are open or in flight */
+static asm_io_stats_t stats;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief checks that the kernel supports all of the used requests
+ *
+ * @return bool true if they are supported
+ */
+static bool asm_io_probe()
+{
+    struct io_uring_probe *probe;
+    size_t size;
+    bool is_supported = false;
+
+    size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    probe = asm_alloc_calloc(ALLOC_IO, 1, size);
+    assert("Memory allocation failed" && probe != NULL);
+
+    if (syscall(__NR_io_uring_register, uring.fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0)
+    {
+        is_supported = probe->last_op >= IORING_OP_UNLINKAT && probe->last_op >= IORING_OP_RENAMEAT
+            && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+            && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED)
+            && (probe->ops[IORING_OP_CLOSE].flags & IO_URING_OP_SUPPORTED)
+            && (probe->ops[IORING_OP_UNLINKAT].flags & IO_URING_OP_SUPPORTED)
+            && (probe->ops[IORING_OP_RENAMEAT].flags & IO_URING_OP_SUPPORTED);
+    }
+    asm_alloc_free(probe);
+
+    return is_supported;
+}
+
+/**
+ * @brief releases the rings
+ */
+static void asm_io_unmap()
+{
+    if (uring.sqes && uring.sqes != MAP_FAILED)
+    {
+        munmap(uring.sqes, uring.sqes_size);
+    }
+    if (uring.cq_ring && uring.cq_ring != MAP_FAILED && uring.cq_ring != uring.sq_ring)
+    {
+        munmap(uring.cq_ring, uring.cq_ring_size);
+    }
+    if (uring.sq_ring && uring.sq_ring != MAP_FAILED)
+    {
+        munmap(uring.sq_ring, uring.sq_ring_size);
+    }
+    close(uring.fd);
+    memset(&uring, 0, sizeof(uring));
+}
+
+/**
+ * @brief sets up the io_uring instance and maps its rings
+ *
+ * @return bool true if io_uring can be used
+ */
+static bool asm_io_setup_uring()
+{
+    struct io_uring_params params;
+
+    memset(&uring, 0, sizeof(uring));
+    memset(&params, 0, sizeof(params));
+    uring.fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (uring.fd < 0)
+    {
+        return false;
+    }
+
+    uring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    uring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (uring.cq_ring_size > uring.sq_ring_size)
+        {
+            uring.sq_ring_size = uring.cq_ring_size;
+        }
+        uring.cq_ring_size = uring.sq_ring_size;
+    }
+
+    uring.sq_ring = mmap(NULL, uring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQ_RING);
+    uring.cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? uring.sq_ring
+        : mmap(NULL, uring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_CQ_RING);
+    uring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring.sqes = mmap(NULL, uring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQES);
+
+    if (uring.sq_ring == MAP_FAILED || uring.cq_ring == MAP_FAILED || uring.sqes == MAP_FAILED || !asm_io_probe())
+    {
+        asm_io_unmap();
+        return false;
+    }
+
+    uring.sq_head = (unsigned int*)((char*)uring.sq_ring + params.sq_off.head);
+    uring.sq_tail = (unsigned int*)((char*)uring.sq_ring + params.sq_off.tail);
+    uring.sq_mask = (unsigned int*)((char*)uring.sq_ring + params.sq_off.ring_mask);
+    uring.sq_array = (unsigned int*)((char*)uring.sq_ring + params.sq_off.array);
+    uring.sq_entries = params.sq_entries;
+    uring.cq_head = (unsigned int*)((char*)uring.cq_ring + params.cq_off.head);
+    uring.cq_tail = (unsigned int*)((char*)uring.cq_ring + params.cq_off.tail);
+    uring.cq_mask = (unsigned int*)((char*)uring.cq_ring + params.cq_off.ring_mask);
+    uring.cq_entries = params.cq_entries;
+    uring.cqes = (struct io_uring_cqe*)((char*)uring.cq_ring + params.cq_off.cqes);
+
+    return true;
+}
+
+/**
+ * @brief frees a file once the caller closed it and none of its requests
+ * is in flight
+ *
+ * @param file the file
+ */
+static void asm_io_release(io_file_t *file)
+{
+    io_file_t **link;
+
+    if (file->is_open || file->pending)
+    {
+        return;
+    }
+
+    for (link = &files; *link && *link != file; link = &((*link)->next))
+        ;
+    if (*link)
+    {
+        *link = file->next;
+    }
+    free(file->buffer);
+    asm_alloc_free(file->temp_path);
+    asm_alloc_free(file->path);
+    asm_alloc_free(file);
+}
+
+/**
+ * @brief checks if a file already has the given content
+ *
+ * @param path the file path
+ * @param buffer the content
+ * @param size the size of the content
+ * @return bool true if the file exists and has the same content
+ */
+static bool asm_io_is_unchanged(char *path, char *buffer, size_t size)
+{
+    char existing[COMPARE_BUFFER_SIZE];
+    struct stat status;
+    ssize_t length = 1;
+    size_t offset = 0;
+    bool is_same;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        return false;
+    }
+
+    is_same = fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && (size_t)status.st_size == size;
+    while (is_same && offset < size && (length = read(fd, existing, COMPARE_BUFFER_SIZE)) > 0)
+    {
+        is_same = offset + length <= size && memcmp(existing, buffer + offset, length) == 0;
+        offset += length;
+    }
+    close(fd);
+
+    return is_same && offset == size;
+}
+
+/**
+ * @brief removes the temporary files of the outputs that are being written
+ * when the assembler exits before renaming them (an allocation that failed,
+ * see asm_alloc.h). Runs at exit, while another thread may hold the lock,
+ * so the files are read without it
+ */
+static void asm_io_remove_temp_files()
+{
+    io_file_t *file;
+
+    for (file = files; file; file = file->next)
+    {
+        if (file->temp_path)
+        {
+            unlink(file->temp_path);
+        }
+    }
+}
+
+/**
+ * @brief registers asm_io_remove_temp_files to run at exit
+ */
+static void asm_io_register_exit_handler()
+{
+    atexit(asm_io_remove_temp_files);
+}
+
+/**
+ * @brief creates a new temporary file next to the given path (so it can be
+ * renamed to the path atomically)
+ *
+ * @param path the path
+ * @param fd returns the temporary file (-1 on failure)
+ * @return char* the allocated temporary file path
+ */
+static char *asm_io_create_temp(char *path, int *fd)
+{
+    static unsigned int counter;
+    static pthread_once_t exit_handler_once = PTHREAD_ONCE_INIT;
+    char *temp_path;
+
+    pthread_once(&exit_handler_once, asm_io_register_exit_handler);
+    temp_path = asm_alloc_malloc(ALLOC_IO, strlen(path) + 32);
+    assert("Memory allocation failed" && temp_path != NULL);
+    do
+    {
+        sprintf(temp_path, "%s.%ld.%u.tmp", path, (long)getpid(), counter++);
+    } while ((*fd = open(temp_path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666)) < 0 && errno == EEXIST);
+
+    return temp_path;
+}
+
+/**
+ * @brief writes the content of a file to a temporary file and renames it
+ * to the file, so the file is never partially written
+ *
+ * @param path the file path
+ * @param buffer the content
+ * @param size the size of the content
+ */
+static void asm_io_write_atomically(char *path, char *buffer, size_t size)
+{
+    char *temp_path;
+    ssize_t length = 0;
+    size_t offset = 0;
+    int fd;
+
+    temp_path = asm_io_create_temp(path, &fd);
+    while (fd >= 0 && offset < size && (length = write(fd, buffer + offset, size - offset)) > 0)
+    {
+        offset += length;
+    }
+
+    if (fd < 0 || close(fd) != 0 || offset != size || rename(temp_path, path) != 0)
+    {
+        fprintf(stderr, "Couldn't write %s\n", path);
+        unlink(temp_path);
+    }
+    asm_alloc_free(temp_path);
+}
+
+/**
+ * @brief handles the completion of a request
+ *
+ * @param user_data the file of the request and the request kind
+ * @param result the result of the request
+ */
+static void asm_io_complete(uint64_t user_data, int result)
+{
+    io_file_t *file = (io_file_t*)(uintptr_t)(user_data & ~(uint64_t)REQUEST_KIND_MASK);
+
+    switch ((request_e)(user_data & REQUEST_KIND_MASK))
+    {
+    case REQUEST_READ:
+        file->is_ready = true;
+        if (result < 0 || (size_t)result != file->size)
+        {
+            /* the source will be opened again with stdio */
+            free(file->buffer);
+            file->buffer = NULL;
+        }
+        break;
+    case REQUEST_WRITE:
+        break; /* a failed or short write cancels the rename */
+    case REQUEST_CLOSE:
+        if (result == -ECANCELED)
+        {
+            close(file->fd); /* the request before it failed */
+        }
+        break;
+    case REQUEST_UNLINK:
+        if (result == 0)
+        {
+            ++(stats.removed);
+        }
+        else if (result != -ENOENT && remove(file->path) == 0)
+        {
+            ++(stats.removed);
+        }
+        break;
+    case REQUEST_RENAME:
+        if (result < 0)
+        {
+            unlink(file->temp_path);
+            asm_io_write_atomically(file->path, file->buffer, file->size);
+        }
+        break;
+    }
+
+    --(file->pending);
+    asm_io_release(file);
+}
+
+/**
+ * @brief submits the queued requests and handles the completed ones
+ *
+ * @param min_complete the number of completions to wait for
+ */
+static void asm_io_submit(unsigned int min_complete)
+{
+    struct io_uring_cqe *cqe;
+    unsigned int head;
+    long submitted;
+
+    do
+    {
+        submitted = syscall(__NR_io_uring_enter, uring.fd, uring.to_submit, min_complete,
+                            min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+
+    if (submitted > 0)
+    {
+        uring.to_submit -= submitted;
+        uring.in_flight += submitted;
+    }
+
+    head = *(uring.cq_head);
+    while (head != LOAD_ACQUIRE(uring.cq_tail))
+    {
+        cqe = &(uring.cqes[head & *(uring.cq_mask)]);
+        ++head;
+        --(uring.in_flight);
+        STORE_RELEASE(uring.cq_head, head);
+        asm_io_complete(cqe->user_data, cqe->res);
+    }
+}
+
+/**
+ * @brief makes room for the given number of requests, so linked requests
+ * are submitted together (a link doesn't span submissions)
+ *
+ * @param count the number of requests
+ */
+static void asm_io_reserve(unsigned int count)
+{
+    while (*(uring.sq_tail) - LOAD_ACQUIRE(uring.sq_head) + count > uring.sq_entries
+           || uring.in_flight + uring.to_submit + count > uring.cq_entries)
+    {
+        asm_io_submit(uring.in_flight ? 1 : 0);
+    }
+}
+
+/**
+ * @brief queues a request (submitting the queued ones first if the rings
+ * are full)
+ *
+ * @param opcode the io_uring opcode
+ * @param file the file of the request
+ * @param kind the request kind
+ * @param fd the file descriptor
+ * @param address the buffer or the path
+ * @param length the buffer length
+ * @param address2 the second path (of a rename)
+ * @param is_linked should the next request run only after this one succeeded
+ */
+static void asm_io_queue(int opcode, io_file_t *file, request_e kind, int fd, void *address, size_t length, void *address2, bool is_linked)
+{
+    struct io_uring_sqe *sqe;
+    unsigned int tail;
+    unsigned int index;
+
+    tail = *(uring.sq_tail);
+    while (tail - LOAD_ACQUIRE(uring.sq_head) == uring.sq_entries
+           || uring.in_flight + uring.to_submit >= uring.cq_entries)
+    {
+        asm_io_submit(uring.in_flight ? 1 : 0);
+    }
+
+    index = tail & *(uring.sq_mask);
+    sqe = &(uring.sqes[index]);
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)address;
+    sqe->len = length;
+    sqe->addr2 = (uint64_t)(uintptr_t)address2;
+    sqe->flags = is_linked ? IOSQE_IO_LINK : 0;
+    sqe->user_data = (uint64_t)(uintptr_t)file | kind;
+
+    uring.sq_array[index] = index;
+    STORE_RELEASE(uring.sq_tail, tail + 1);
+    ++(uring.to_submit);
+    ++(file->pending);
+}
+
+/**
+ * @brief creates a file entry
+ *
+ * @param path the file path
+ * @param is_output is the file an output
+ * @return io_file_t* the entry
+ */
+static io_file_t *asm_io_create_file(char *path, bool is_output)
+{
+    io_file_t *file;
+
+    file = asm_alloc_calloc(ALLOC_IO, 1, sizeof(io_file_t));
+    assert("Memory allocation failed" && file != NULL);
+    file->path = asm_alloc_malloc(ALLOC_IO, strlen(path) + 1);
+    assert("Memory allocation failed" && file->path != NULL);
+    strcpy(file->path, path);
+    file->fd = -1;
+    file->is_output = is_output;
+
+    file->next = files;
+    files = file;
+    return file;
+}
+
+/**
+ * @brief waits for the requests of other entries of the same path, so the
+ * requests of a path reach the disk in the order they were made
+ *
+ * @param path the path
+ * @param current the entry that is about to queue requests
+ */
+static void asm_io_wait_for_path(char *path, io_file_t *current)
+{
+    io_file_t *file;
+
+    do
+    {
+        for (file = files; file && (file == current || !file->pending || strcmp(file->path, path) != 0); file = file->next)
+            ;
+        if (file)
+        {
+            asm_io_submit(1);
+        }
+    } while (file);
+}
+
+bool asm_io_init(bool use_uring)
+{
+    if (use_uring && !is_uring_used)
+    {
+        is_uring_used = asm_io_setup_uring();
+    }
+    return is_uring_used;
+}
+
+void asm_io_prefetch(char *path)
+{
+    io_file_t *file;
+    struct stat status;
+    int fd;
+
+    if (!is_uring_used)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    for (file = files; file && (file->is_output || !file->is_open || file->file || strcmp(file->path, path) != 0); file = file->next)
+        ;
+    if (!file && (fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0)
+    {
+        if (fstat(fd, &status) == 0 && status.st_size > 0)
+        {
+            file = asm_io_create_file(path, false);
+            file->size = status.st_size;
+            file->fd = fd;
+            file->is_open = true; /* kept until the caller opens it */
+            file->buffer = malloc(file->size); /* freed with the buffers of open_memstream */
+            assert("Memory allocation failed" && file->buffer != NULL);
+            asm_io_reserve(2);
+            asm_io_queue(IORING_OP_READ, file, REQUEST_READ, fd, file->buffer, file->size, NULL, true);
+            asm_io_queue(IORING_OP_CLOSE, file, REQUEST_CLOSE, fd, NULL, 0, NULL, false);
+        }
+        else
+        {
+            close(fd); /* empty files are simply opened later */
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+FILE *asm_io_open(char *path, char *mode)
+{
+    io_file_t *file;
+    FILE *stream;
+
+    if (!is_uring_used && *mode != 'w')
+    {
+        return fopen(path, mode);
+    }
+
+    /* outputs are kept in memory until they are closed */
+    pthread_mutex_lock(&lock);
+    if (*mode == 'w')
+    {
+        file = asm_io_create_file(path, true);
+        stream = file->file = open_memstream(&(file->buffer), &(file->size));
+        file->is_open = stream != NULL;
+        asm_io_release(file);
+    }
+    else
+    {
+        for (file = files; file && (file->is_output || !file->is_open || file->file || strcmp(file->path, path) != 0); file = file->next)
+            ;
+        while (file && !file->is_ready)
+        {
+            asm_io_submit(1);
+        }
+
+        stream = (file && file->buffer) ? fmemopen(file->buffer, file->size, mode) : NULL;
+        if (stream)
+        {
+            file->file = stream;
+        }
+        else
+        {
+            if (file)
+            {
+                file->is_open = false;
+                asm_io_release(file);
+            }
+            stream = fopen(path, mode);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return stream;
+}
+
+void asm_io_close(FILE *file)
+{
+    io_file_t *current;
+    int fd;
+
+    pthread_mutex_lock(&lock);
+    for (current = files; current && current->file != file; current = current->next)
+        ;
+    fclose(file);
+
+    if (current)
+    {
+        current->is_open = false;
+        current->file = NULL;
+        if (current->is_output)
+        {
+            asm_io_wait_for_path(current->path, current);
+            if (asm_io_is_unchanged(current->path, current->buffer, current->size))
+            {
+                ++(stats.unchanged); /* keeps its modification time */
+            }
+            else if (is_uring_used)
+            {
+                current->temp_path = asm_io_create_temp(current->path, &fd);
+                if (fd < 0)
+                {
+                    asm_io_write_atomically(current->path, current->buffer, current->size);
+                }
+                else
+                {
+                    current->fd = fd;
+                    asm_io_reserve(3);
+                    if (current->size)
+                    {
+                        asm_io_queue(IORING_OP_WRITE, current, REQUEST_WRITE, fd, current->buffer, current->size, NULL, true);
+                    }
+                    asm_io_queue(IORING_OP_CLOSE, current, REQUEST_CLOSE, fd, NULL, 0, NULL, true);
+                    asm_io_queue(IORING_OP_RENAMEAT, current, REQUEST_RENAME, AT_FDCWD, current->temp_path, (unsigned int)AT_FDCWD, current->path, false);
+                }
+                ++(stats.written);
+            }
+            else
+            {
+                asm_io_write_atomically(current->path, current->buffer, current->size);
+                ++(stats.written);
+            }
+        }
+        asm_io_release(current);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+int asm_io_open_descriptor(char *path)
+{
+    io_file_t *file;
+    int fd;
+
+    pthread_mutex_lock(&lock);
+    file = asm_io_create_file(path, true);
+    file->temp_path = asm_io_create_temp(path, &fd);
+    file->fd = fd;
+    file->is_open = fd >= 0;
+    asm_io_release(file);
+    pthread_mutex_unlock(&lock);
+
+    return fd;
+}
+
+bool asm_io_close_descriptor(int fd, bool is_complete)
+{
+    io_file_t *current;
+    struct stat status;
+    char *content = "";
+    bool is_unchanged = false;
+
+    pthread_mutex_lock(&lock);
+    for (current = files; current && (!current->is_open || current->file || current->fd != fd); current = current->next)
+        ;
+    if (!current)
+    {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+    current->is_open = false;
+    asm_io_wait_for_path(current->path, current);
+    is_complete = is_complete && fstat(fd, &status) == 0;
+    if (is_complete && status.st_size > 0)
+    {
+        /* the content is compared through a mapping instead of being read back */
+        content = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        is_complete = content != MAP_FAILED;
+    }
+    if (is_complete)
+    {
+        is_unchanged = asm_io_is_unchanged(current->path, content, status.st_size);
+        if (status.st_size > 0)
+        {
+            munmap(content, status.st_size);
+        }
+    }
+
+    is_complete = close(fd) == 0 && is_complete;
+    if (is_complete && is_unchanged)
+    {
+        ++(stats.unchanged); /* keeps its modification time */
+        unlink(current->temp_path);
+    }
+    else if (is_complete && rename(current->temp_path, current->path) == 0)
+    {
+        ++(stats.written);
+    }
+    else
+    {
+        is_complete = false;
+        unlink(current->temp_path);
+    }
+    asm_io_release(current);
+    pthread_mutex_unlock(&lock);
+
+    return is_complete;
+}
+
+void asm_io_discard(FILE *file, char *path)
+{
+    io_file_t *current;
+
+    pthread_mutex_lock(&lock);
+    for (current = files; current && current->file != file; current = current->next)
+        ;
+    fclose(file);
+    if (current)
+    {
+        /* the output was never created, only an old version may exist */
+        current->is_open = false;
+        current->file = NULL;
+        asm_io_wait_for_path(current->path, current);
+        if (is_uring_used)
+        {
+            asm_io_queue(IORING_OP_UNLINKAT, current, REQUEST_UNLINK, AT_FDCWD, current->path, 0, NULL, false);
+        }
+        else if (remove(current->path) == 0)
+        {
+            ++(stats.removed);
+        }
+        asm_io_release(current);
+    }
+    else if (remove(path) == 0)
+    {
+        ++(stats.removed);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void asm_io_remove(char *path)
+{
+    io_file_t *file;
+
+    pthread_mutex_lock(&lock);
+    if (is_uring_used)
+    {
+        file = asm_io_create_file(path, true);
+        asm_io_wait_for_path(path, file);
+        asm_io_queue(IORING_OP_UNLINKAT, file, REQUEST_UNLINK, AT_FDCWD, file->path, 0, NULL, false);
+    }
+    else if (remove(path) == 0)
+    {
+        ++(stats.removed);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+asm_io_stats_t asm_io_get_stats()
+{
+    asm_io_stats_t current;
+
+    pthread_mutex_lock(&lock);
+    current = stats;
+    pthread_mutex_unlock(&lock);
+
+    return current;
+}
+
+void asm_io_flush()
+{
+    if (!is_uring_used)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    while (uring.to_submit || uring.in_flight)
+    {
+        asm_io_submit(uring.in_flight ? 1 : 0);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void asm_io_destroy()
+{
+    io_file_t *file;
+
+    asm_io_flush();
+    while (files)
+    {
+        /* sources that were read ahead but never opened */
+        file = files;
+        files = file->next;
+        free(file->buffer);
+        asm_alloc_free(file->temp_path);
+        asm_alloc_free(file->path);
+        asm_alloc_free(file);
+    }
+    if (is_uring_used)
+    {
+        asm_io_unmap();
+        is_uring_used = false;
+    }
+}
\ No newline at end of file
@@ -12,6 +12,18 @@
     }                                                         \
     argument[i] = '\0';
 
+/* an immediate is an expression that may have spaces, it ends at a comma */
+#define SCAN_EXPRESSION(line, argument, i)                              \
+    for (i = 0; *line && *line != ',' && *line != '\n'; ++line, ++i)    \
+    {                                                                   \
+        argument[i] = *line;                                            \
+    }                                                                   \
+    while (i > 0 && isspace(argument[i - 1]))                           \
+    {                                                                   \
+        --i;                                                            \
+    }                                                                   \
+    argument[i] = '\0';
+
 #define SEARCH_COMMA(line)            \
     while (*line && *(line++) != ',') \
         ;                             \
@@ -22,7 +34,8 @@
  * it to the memory and returns the num of words it wrote to the memory.
  * Else, writes an error to the error file
  * 
- * @param line the line in which the argument is present
+ * @param line the line in which the argument is present (moved to after
+ * the argument)
  * @param instruction the asm instruction to which the argument belongs
  * @param is_src is the argument src or dest
  * @param reg pointer to a register number
@@ -30,17 +43,24 @@
  * @param memory the memory structure
  * @return uint8_t the number of words it wrote to the memory
  */
-static uint8_t asm_line_handle_argument(char *line, asm_word_e instruction, bool is_src, uint8_t *reg, uint8_t *addr, memory_t *memory)
+static uint8_t asm_line_handle_argument(char **line, asm_word_e instruction, bool is_src, uint8_t *reg, uint8_t *addr, memory_t *memory)
 {
     uint8_t i;
     address_e address;
-    label_t *label;
     char *opening_bracket;
     char *closing_bracket;
-    char argument[LABEL_MAX_LENGTH];
+    char argument[LINE_LENGTH];
     uint8_t words = 0;
+    long value;
 
-    SCAN_ARGUMENT(line, argument, i)
+    if (**line == '#')
+    {
+        SCAN_EXPRESSION(*line, argument, i)
+    }
+    else
+    {
+        SCAN_ARGUMENT(*line, argument, i)
+    }
     address = argument_get_address(argument);
 
     if (argument_is_valid(argument, address))
@@ -60,8 +80,7 @@ static uint8_t asm_line_handle_argument(char *line, asm_word_e instruction, bool
                 *closing_bracket = '\0';
                 *reg = asm_language_get_register_num(asm_language_is_register(opening_bracket));
             case DIRECT:
-                label = labels_table_get_forced_label(labels_table_get_instance(), argument);
-                label_insert_line(label, asm_memory_get_ic(asm_memory_get_instance()));
+                labels_table_add_reference(labels_table_get_instance(), argument, asm_memory_get_ic(asm_memory_get_instance()));
                 asm_memory_push_code(memory, 0); /* skips lable lines */
                 asm_memory_push_code(memory, 0);
                 break;
@@ -69,7 +88,13 @@ static uint8_t asm_line_handle_argument(char *line, asm_word_e instruction, bool
                 *reg = asm_language_get_register_num(asm_language_is_register(argument));
                 break;
             case IMMEDIATE:
-                asm_memory_push_code(memory, atoi(argument + 1));
+                if (!expression_is_number(argument + 1, &value))
+                {
+                    /* the value is written once the labels and the constants are known */
+                    labels_table_add_fixup(labels_table_get_instance(), argument + 1, asm_memory_get_ic(memory), false);
+                    value = 0;
+                }
+                asm_memory_push_code(memory, value);
                 break;
             }
         }
@@ -111,7 +136,7 @@ static uint16_t asm_line_get_args_word(asm_word_e instruction, uint8_t reg_src,
  */
 static void asm_line_analyze_command(char *line)
 {
-    char instruction_name[6];
+    char instruction_name[7];
     asm_word_e instruction;
     uint8_t args_num;
     uint8_t reg_src = 0, reg_dest = 0;
@@ -119,6 +144,7 @@ static void asm_line_analyze_command(char *line)
     memory_t *memory;
     uint8_t words = 1;
     uint16_t args_word;
+    char extraneous[2];
 
     SKIP_SPACES(line)
     sscanf(line, "%6s", instruction_name);
@@ -134,25 +160,25 @@ static void asm_line_analyze_command(char *line)
         {
             asm_memory_push_code(memory, 0); /* skips the args word */
             SKIP_SPACES(line)
-            words += asm_line_handle_argument(line, instruction, false, &reg_dest, &addr_dest, memory);
+            words += asm_line_handle_argument(&line, instruction, false, &reg_dest, &addr_dest, memory);
             args_word = asm_line_get_args_word(instruction, reg_src, addr_src, reg_dest, addr_dest);
             asm_memory_rewrite_code(memory, args_word, 4, asm_memory_get_ic(memory) - words);
-            while (!isspace(*line)) ++line;
+            while (*line && !isspace(*line)) ++line;
         }
         else if (args_num == 2)
         {
             asm_memory_push_code(memory, 0); /* skips the args word */
             SKIP_SPACES(line)
-            words += asm_line_handle_argument(line, instruction, true, &reg_src, &addr_src, memory);
+            words += asm_line_handle_argument(&line, instruction, true, &reg_src, &addr_src, memory);
             
             SEARCH_COMMA(line)
             if (*(line++) == ',')
             {
                 SKIP_SPACES(line)
-                words += asm_line_handle_argument(line, instruction, false, &reg_dest, &addr_dest, memory);
+                words += asm_line_handle_argument(&line, instruction, false, &reg_dest, &addr_dest, memory);
                 args_word = asm_line_get_args_word(instruction, reg_src, addr_src, reg_dest, addr_dest);
                 asm_memory_rewrite_code(memory, args_word, 4, asm_memory_get_ic(memory) - words);
-                while (!isspace(*line)) ++line;
+                while (*line && !isspace(*line)) ++line;
             }
             else
             {
@@ -162,7 +188,7 @@ static void asm_line_analyze_command(char *line)
         }
         
         
-        if (sscanf(line, "%1s", &args_num) == 1)
+        if (sscanf(line, "%1s", extraneous) == 1)
         {
             printf("%s", line);
             errors_print_line(EXTRANEOUS_TEXT);
@@ -176,10 +202,10 @@ static void asm_line_analyze_command(char *line)
 
 void asm_line_analyze(char *line)
 {
-    char first_char;
-    sscanf(line, "%1s", &first_char);
+    char first_char[2];
+    sscanf(line, "%1s", first_char);
 
-    if (first_char == '.')
+    if (first_char[0] == '.')
     {
         directive_handle(line);
     }
@@ -0,0 +1,776 @@
+#define _POSIX_C_SOURCE 200809L
+#include "asm_lsp.h"
+#include <unistd.h>
+
+#define HEADER_LENGTH 256
+#define LINE_ERRORS_MAX 4
+#define JSONRPC_METHOD_NOT_FOUND -32601
+
+typedef struct lsp_line_t
+{
+    char text[LINE_LENGTH];   /* the line after its macros were opened */
+    unsigned long text_hash;
+    unsigned int source_line; /* the line in the document (starting at 0) */
+    uint16_t ic;              /* the code words of the line */
+    uint16_t dc;              /* the data words of the line */
+    int ic_base;              /* the ic at which the line starts */
+    uint8_t errors_count;
+    error_e errors[LINE_ERRORS_MAX];
+    labels_table_t *journal;  /* the line's label changes (NULL if it has none) */
+} lsp_line_t;
+
+typedef struct lsp_lines_t
+{
+    lsp_line_t *lines;
+    int count;
+    int capacity;
+} lsp_lines_t;
+
+typedef struct lsp_diagnostic_t
+{
+    unsigned int source_line;
+    error_e error;
+    char symbol[LABEL_MAX_LENGTH + 1];
+} lsp_diagnostic_t;
+
+typedef struct lsp_document_t
+{
+    char *uri;
+    char *text;
+    size_t length;
+    lsp_lines_t lines;
+    labels_table_t *labels_table;      /* rebuilt from the lines' journals */
+    lsp_diagnostic_t *diagnostics;     /* the errors found by the labels table */
+    int diagnostics_count;
+    int diagnostics_capacity;
+    int current_line;                  /* the line whose journal is replayed */
+} lsp_document_t;
+
+static linked_list_node_t *documents;
+
+/**
+ * @brief creates a labels table that isn't the instance of the thread
+ *
+ * @return labels_table_t* the table
+ */
+static labels_table_t *asm_lsp_create_table()
+{
+    labels_table_t *previous;
+    labels_table_t *table;
+
+    previous = labels_table_set_instance(NULL);
+    table = labels_table_get_instance();
+    labels_table_set_instance(previous);
+
+    return table;
+}
+
+/**
+ * @brief adds an error of a line to the line (errors hook)
+ *
+ * @param error the error
+ * @param symbol unused (line errors don't have a symbol)
+ * @param line the line that is being analyzed
+ */
+static void asm_lsp_on_line_error(error_e error, char *symbol, void *line)
+{
+    lsp_line_t *current = line;
+
+    (void)symbol;
+    if (current->errors_count < LINE_ERRORS_MAX)
+    {
+        current->errors[current->errors_count++] = error;
+    }
+}
+
+/**
+ * @brief analyzes a single line on its own: its errors and words are kept
+ * in the line, and its labels are kept in a journal that is replayed with
+ * the line's actual ic
+ *
+ * @param line the line
+ * @param memory a memory for the line's words
+ */
+static void asm_lsp_analyze_line(lsp_line_t *line, memory_t *memory)
+{
+    char text[LINE_LENGTH];
+    labels_table_t *previous_table;
+    memory_t *previous_memory;
+
+    strcpy(text, line->text);
+    line->errors_count = 0;
+
+    previous_memory = asm_memory_set_instance(memory);
+    previous_table = labels_table_set_instance(NULL);
+    line->journal = labels_table_get_instance();
+    labels_table_start_journal(line->journal);
+    errors_set_hook(asm_lsp_on_line_error, line);
+
+    assembler_analyze_line(text, line->journal);
+
+    errors_set_hook(NULL, NULL);
+    line->ic = asm_memory_get_ic(memory);
+    line->dc = asm_memory_get_dc(memory);
+    asm_memory_reset(memory);
+    asm_memory_set_instance(previous_memory);
+    labels_table_set_instance(previous_table);
+
+    if (!labels_table_has_journal(line->journal))
+    {
+        labels_table_destroy(line->journal);
+        line->journal = NULL;
+    }
+}
+
+/**
+ * @brief adds a line after its macros were opened (macro line handler)
+ *
+ * @param text the line
+ * @param lines the lines
+ */
+static void asm_lsp_on_expanded_line(char *text, void *lines)
+{
+    lsp_lines_t *current = lines;
+    lsp_line_t *line;
+
+    if (current->count == current->capacity)
+    {
+        current->capacity = current->capacity ? current->capacity << 1 : 64;
+        current->lines = asm_alloc_realloc(ALLOC_SERVICE, current->lines, current->capacity * sizeof(lsp_line_t));
+        assert("Memory allocation failed" && current->lines != NULL);
+    }
+
+    line = &(current->lines[current->count++]);
+    strcpy(line->text, text);
+    line->text_hash = hash(text);
+    line->source_line = macro_get_source_line() - 1;
+    line->journal = NULL;
+}
+
+/**
+ * @brief moves the analysis of an old line to a new line with the same text
+ *
+ * @param line the new line
+ * @param old_line the old line
+ */
+static void asm_lsp_reuse_line(lsp_line_t *line, lsp_line_t *old_line)
+{
+    line->ic = old_line->ic;
+    line->dc = old_line->dc;
+    line->errors_count = old_line->errors_count;
+    memcpy(line->errors, old_line->errors, sizeof(line->errors));
+    line->journal = old_line->journal;
+    old_line->journal = NULL;
+}
+
+/**
+ * @brief checks if two lines have the same text
+ *
+ * @param first a line
+ * @param second a line
+ * @return bool true if the lines are the same
+ */
+static bool asm_lsp_is_same_line(lsp_line_t *first, lsp_line_t *second)
+{
+    return first->text_hash == second->text_hash && strcmp(first->text, second->text) == 0;
+}
+
+/**
+ * @brief adds an error found by the labels table to the document
+ *
+ * @param document the document
+ * @param source_line the line of the error
+ * @param error the error
+ * @param symbol the symbol of the error (may be NULL)
+ */
+static void asm_lsp_add_diagnostic(lsp_document_t *document, unsigned int source_line, error_e error, char *symbol)
+{
+    lsp_diagnostic_t *diagnostic;
+
+    if (document->diagnostics_count == document->diagnostics_capacity)
+    {
+        document->diagnostics_capacity = document->diagnostics_capacity ? document->diagnostics_capacity << 1 : 16;
+        document->diagnostics = asm_alloc_realloc(ALLOC_SERVICE, document->diagnostics, document->diagnostics_capacity * sizeof(lsp_diagnostic_t));
+        assert("Memory allocation failed" && document->diagnostics != NULL);
+    }
+
+    diagnostic = &(document->diagnostics[document->diagnostics_count++]);
+    diagnostic->source_line = source_line;
+    diagnostic->error = error;
+    diagnostic->symbol[0] = '\0';
+    if (symbol)
+    {
+        strncat(diagnostic->symbol, symbol, LABEL_MAX_LENGTH);
+    }
+}
+
+/**
+ * @brief returns the line that contains the word at the given ic
+ *
+ * @param document the document
+ * @param location the ic
+ * @return int the line (-1 if there is no such line)
+ */
+static int asm_lsp_find_line_by_ic(lsp_document_t *document, int location)
+{
+    lsp_line_t *lines = document->lines.lines;
+    int low = 0;
+    int high = document->lines.count;
+    int middle;
+
+    /* the first line that ends after the location */
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (lines[middle].ic_base + lines[middle].ic > location)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low < document->lines.count ? low : -1;
+}
+
+/**
+ * @brief adds an error that the labels table found (errors hook). An
+ * undefined label is reported on every line that refers to it
+ *
+ * @param error the error
+ * @param symbol the symbol of the error (NULL for line errors)
+ * @param document the document
+ */
+static void asm_lsp_on_labels_error(error_e error, char *symbol, void *document)
+{
+    lsp_document_t *current = document;
+    linked_list_node_t *reference;
+    label_t *label;
+    int line;
+    int previous_line = -1;
+
+    if (!symbol)
+    {
+        asm_lsp_add_diagnostic(current, current->lines.lines[current->current_line].source_line, error, NULL);
+        return;
+    }
+
+    label = labels_table_does_label_exist(current->labels_table, symbol);
+    reference = label ? label_get_lines(label) : NULL;
+    if (!reference)
+    {
+        asm_lsp_add_diagnostic(current, 0, error, symbol);
+    }
+    for (; reference; reference = linked_list_get_next_address(reference))
+    {
+        line = asm_lsp_find_line_by_ic(current, *(int*)linked_list_get_info(reference));
+        if (line >= 0 && line != previous_line)
+        {
+            asm_lsp_add_diagnostic(current, current->lines.lines[line].source_line, error, symbol);
+            previous_line = line;
+        }
+    }
+}
+
+/**
+ * @brief opens the macros of the document and analyzes the lines whose
+ * text changed since the last update (the unchanged lines at the start and
+ * at the end of the document keep their analysis), then rebuilds the
+ * labels table from the lines' journals
+ *
+ * @param document the document
+ */
+static void asm_lsp_update(lsp_document_t *document)
+{
+    lsp_lines_t old_lines = document->lines;
+    lsp_lines_t *lines = &(document->lines);
+    memory_t *memory = asm_memory_get_instance();
+    FILE *text;
+    int prefix;
+    int suffix;
+    int line;
+    int ic = 0;
+    int dc = 0;
+
+    lines->lines = NULL;
+    lines->count = 0;
+    lines->capacity = 0;
+    if (document->length && (text = fmemopen(document->text, document->length, "r")))
+    {
+        macro_expand(text, asm_lsp_on_expanded_line, lines);
+        fclose(text);
+    }
+
+    for (prefix = 0; prefix < lines->count && prefix < old_lines.count
+         && asm_lsp_is_same_line(&(lines->lines[prefix]), &(old_lines.lines[prefix])); prefix++)
+    {
+        asm_lsp_reuse_line(&(lines->lines[prefix]), &(old_lines.lines[prefix]));
+    }
+    for (suffix = 0; suffix < lines->count - prefix && suffix < old_lines.count - prefix
+         && asm_lsp_is_same_line(&(lines->lines[lines->count - 1 - suffix]), &(old_lines.lines[old_lines.count - 1 - suffix])); suffix++)
+    {
+        asm_lsp_reuse_line(&(lines->lines[lines->count - 1 - suffix]), &(old_lines.lines[old_lines.count - 1 - suffix]));
+    }
+    for (line = prefix; line < lines->count - suffix; line++)
+    {
+        asm_lsp_analyze_line(&(lines->lines[line]), memory);
+    }
+
+    for (line = 0; line < old_lines.count; line++)
+    {
+        if (old_lines.lines[line].journal)
+        {
+            labels_table_destroy(old_lines.lines[line].journal);
+        }
+    }
+    asm_alloc_free(old_lines.lines);
+
+    labels_table_reset(document->labels_table);
+    document->diagnostics_count = 0;
+    errors_set_hook(asm_lsp_on_labels_error, document);
+    for (line = 0; line < lines->count; line++)
+    {
+        lines->lines[line].ic_base = ic;
+        if (lines->lines[line].journal)
+        {
+            document->current_line = line;
+            labels_table_replay_journal(document->labels_table, lines->lines[line].journal, ic, ic + dc);
+        }
+        ic += lines->lines[line].ic;
+        dc += lines->lines[line].dc;
+    }
+    labels_table_check_labels_validity_proxy(document->labels_table);
+    errors_set_hook(NULL, NULL);
+}
+
+/**
+ * @brief writes a single diagnostic
+ *
+ * @param output the output
+ * @param is_first is it the first diagnostic of the document
+ * @param source_line the line of the diagnostic
+ * @param error the error
+ * @param symbol the symbol of the error (may be NULL or empty)
+ */
+static void asm_lsp_write_diagnostic(FILE *output, bool is_first, unsigned int source_line, error_e error, char *symbol)
+{
+    char message[LINE_LENGTH + LABEL_MAX_LENGTH];
+
+    if (symbol && *symbol)
+    {
+        sprintf(message, "%s \"%s\"", errors_get_message(error), symbol);
+    }
+    else
+    {
+        strcpy(message, errors_get_message(error));
+    }
+
+    fprintf(output, "%s{\"range\":{\"start\":{\"line\":%u,\"character\":0},\"end\":{\"line\":%u,\"character\":0}},"
+                    "\"severity\":1,\"source\":\"assembler\",\"message\":",
+            is_first ? "" : ",", source_line, source_line + 1);
+    json_write_string(output, message);
+    fputc('}', output);
+}
+
+/**
+ * @brief writes a message with its Content-Length header
+ *
+ * @param output the output
+ * @param body the message
+ * @param length the length of the message
+ */
+static void asm_lsp_send(FILE *output, char *body, size_t length)
+{
+    fprintf(output, "Content-Length: %lu\r\n\r\n", (unsigned long)length);
+    fwrite(body, 1, length, output);
+    fflush(output);
+}
+
+/**
+ * @brief publishes the diagnostics of a document
+ *
+ * @param output the output
+ * @param uri the uri of the document
+ * @param document the document (NULL to clear its diagnostics)
+ */
+static void asm_lsp_publish(FILE *output, char *uri, lsp_document_t *document)
+{
+    FILE *message;
+    char *body = NULL;
+    size_t length = 0;
+    lsp_line_t *line;
+    bool is_first = true;
+    int offset;
+    int error;
+
+    message = open_memstream(&body, &length);
+    assert("Memory allocation failed" && message != NULL);
+    fputs("{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":", message);
+    json_write_string(message, uri);
+    fputs(",\"diagnostics\":[", message);
+
+    for (offset = 0; document && offset < document->lines.count; offset++)
+    {
+        line = &(document->lines.lines[offset]);
+        for (error = 0; error < line->errors_count; error++)
+        {
+            asm_lsp_write_diagnostic(message, is_first, line->source_line, line->errors[error], NULL);
+            is_first = false;
+        }
+    }
+    for (offset = 0; document && offset < document->diagnostics_count; offset++)
+    {
+        asm_lsp_write_diagnostic(message, is_first, document->diagnostics[offset].source_line,
+                                 document->diagnostics[offset].error, document->diagnostics[offset].symbol);
+        is_first = false;
+    }
+
+    fputs("]}}", message);
+    fclose(message);
+    asm_lsp_send(output, body, length);
+    free(body);
+}
+
+/**
+ * @brief returns the open document with the given uri
+ *
+ * @param uri the uri
+ * @return lsp_document_t* the document (NULL if it isn't open)
+ */
+static lsp_document_t *asm_lsp_find_document(char *uri)
+{
+    linked_list_node_t *node;
+
+    for (node = documents; node; node = linked_list_get_next_address(node))
+    {
+        if (strcmp(((lsp_document_t*)linked_list_get_info(node))->uri, uri) == 0)
+        {
+            return linked_list_get_info(node);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief frees a document
+ *
+ * @param document the document
+ */
+static void asm_lsp_destroy_document(lsp_document_t *document)
+{
+    int line;
+
+    for (line = 0; line < document->lines.count; line++)
+    {
+        if (document->lines.lines[line].journal)
+        {
+            labels_table_destroy(document->lines.lines[line].journal);
+        }
+    }
+    asm_alloc_free(document->lines.lines);
+    labels_table_destroy(document->labels_table);
+    asm_alloc_free(document->diagnostics);
+    asm_alloc_free(document->text);
+    asm_alloc_free(document->uri);
+    asm_alloc_free(document);
+}
+
+/**
+ * @brief removes a document from the open documents
+ *
+ * @param uri the uri of the document
+ */
+static void asm_lsp_close_document(char *uri)
+{
+    linked_list_node_t *node;
+    linked_list_node_t *next;
+
+    if (!documents)
+    {
+        return;
+    }
+    if (strcmp(((lsp_document_t*)linked_list_get_info(documents))->uri, uri) == 0)
+    {
+        asm_lsp_destroy_document(linked_list_get_info(documents));
+        linked_list_pop(&documents);
+        return;
+    }
+    for (node = documents; (next = linked_list_get_next_address(node)); node = next)
+    {
+        if (strcmp(((lsp_document_t*)linked_list_get_info(next))->uri, uri) == 0)
+        {
+            asm_lsp_destroy_document(linked_list_get_info(next));
+            linked_list_delete_after_node(node);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief returns the offset of a position in the document's text
+ *
+ * @param document the document
+ * @param position the position (a JSON object with line and character)
+ * @return size_t the offset
+ */
+static size_t asm_lsp_get_offset(lsp_document_t *document, char *position)
+{
+    long line = json_get_int(json_find(position, "line"), 0);
+    long character = json_get_int(json_find(position, "character"), 0);
+    size_t offset = 0;
+
+    while (line > 0 && offset < document->length)
+    {
+        if (document->text[offset++] == '\n')
+        {
+            --line;
+        }
+    }
+    while (character > 0 && offset < document->length && document->text[offset] != '\n')
+    {
+        ++offset;
+        --character;
+    }
+    return offset;
+}
+
+/**
+ * @brief applies a change of the document's text (a range that is replaced,
+ * or the entire text when there is no range)
+ *
+ * @param document the document
+ * @param change the change (a TextDocumentContentChangeEvent)
+ */
+static void asm_lsp_apply_change(lsp_document_t *document, char *change)
+{
+    char *range = json_find(change, "range");
+    char *text;
+    char *new_text;
+    size_t length;
+    size_t start;
+    size_t end;
+
+    if (!(text = json_get_string(json_find(change, "text"), &length)))
+    {
+        return;
+    }
+    if (!range)
+    {
+        asm_alloc_free(document->text);
+        document->text = text;
+        document->length = length;
+        return;
+    }
+
+    start = asm_lsp_get_offset(document, json_find(range, "start"));
+    end = asm_lsp_get_offset(document, json_find(range, "end"));
+    if (end < start)
+    {
+        end = start;
+    }
+
+    new_text = asm_alloc_malloc(ALLOC_SERVICE, document->length - (end - start) + length + 1);
+    assert("Memory allocation failed" && new_text != NULL);
+    memcpy(new_text, document->text, start);
+    memcpy(new_text + start, text, length);
+    memcpy(new_text + start + length, document->text + end, document->length - end);
+    document->length = document->length - (end - start) + length;
+    new_text[document->length] = '\0';
+
+    asm_alloc_free(text);
+    asm_alloc_free(document->text);
+    document->text = new_text;
+}
+
+/**
+ * @brief handles a textDocument notification
+ *
+ * @param output the output
+ * @param method the method
+ * @param params the params of the notification
+ */
+static void asm_lsp_on_document(FILE *output, char *method, char *params)
+{
+    char *text_document = json_find(params, "textDocument");
+    char *uri = json_get_string(json_find(text_document, "uri"), NULL);
+    lsp_document_t *document;
+    char *change;
+
+    if (!uri)
+    {
+        return;
+    }
+
+    document = asm_lsp_find_document(uri);
+    if (strcmp(method, "textDocument/didOpen") == 0 && !document)
+    {
+        document = asm_alloc_calloc(ALLOC_SERVICE, 1, sizeof(lsp_document_t));
+        assert("Memory allocation failed" && document != NULL);
+        document->uri = uri;
+        document->labels_table = asm_lsp_create_table();
+        if (!(document->text = json_get_string(json_find(text_document, "text"), &(document->length))))
+        {
+            document->text = asm_alloc_calloc(ALLOC_SERVICE, 1, 1);
+            assert("Memory allocation failed" && document->text != NULL);
+        }
+        linked_list_push(&documents);
+        linked_list_set_info(documents, document);
+        uri = NULL;
+    }
+    else if (strcmp(method, "textDocument/didChange") == 0 && document)
+    {
+        for (change = json_array_first(json_find(params, "contentChanges")); change; change = json_array_next(change))
+        {
+            asm_lsp_apply_change(document, change);
+        }
+    }
+    else if (strcmp(method, "textDocument/didClose") == 0 && document)
+    {
+        asm_lsp_close_document(uri);
+        asm_lsp_publish(output, uri, NULL);
+        document = NULL;
+    }
+    else
+    {
+        document = NULL;
+    }
+
+    if (document)
+    {
+        asm_lsp_update(document);
+        asm_lsp_publish(output, document->uri, document);
+    }
+    asm_alloc_free(uri);
+}
+
+/**
+ * @brief reads a single message (after its Content-Length header)
+ *
+ * @param input the input
+ * @return char* the allocated message (NULL at the end of the input)
+ */
+static char *asm_lsp_read_message(FILE *input)
+{
+    char header[HEADER_LENGTH];
+    unsigned long length = 0;
+    bool has_length = false;
+    char *body;
+
+    while (fgets(header, HEADER_LENGTH, input))
+    {
+        if (strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0)
+        {
+            if (!has_length)
+            {
+                continue;
+            }
+            body = asm_alloc_malloc(ALLOC_SERVICE, length + 1);
+            assert("Memory allocation failed" && body != NULL);
+            if (fread(body, 1, length, input) != length)
+            {
+                asm_alloc_free(body);
+                return NULL;
+            }
+            body[length] = '\0';
+            return body;
+        }
+        if (sscanf(header, "Content-Length: %lu", &length) == 1)
+        {
+            has_length = true;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief sends the response of a request
+ *
+ * @param output the output
+ * @param id the id of the request (a JSON value)
+ * @param result the result (a JSON value, NULL for a "method not found" error)
+ */
+static void asm_lsp_respond(FILE *output, char *id, char *result)
+{
+    FILE *message;
+    char *body = NULL;
+    size_t length = 0;
+
+    message = open_memstream(&body, &length);
+    assert("Memory allocation failed" && message != NULL);
+    fputs("{\"jsonrpc\":\"2.0\",\"id\":", message);
+    fwrite(id, 1, json_skip(id) - id, message);
+    if (result)
+    {
+        fprintf(message, ",\"result\":%s}", result);
+    }
+    else
+    {
+        fprintf(message, ",\"error\":{\"code\":%d,\"message\":\"Method not found\"}}", JSONRPC_METHOD_NOT_FOUND);
+    }
+    fclose(message);
+
+    asm_lsp_send(output, body, length);
+    free(body);
+}
+
+int asm_lsp_run()
+{
+    FILE *output;
+    char *message;
+    char *method;
+    char *id;
+    bool is_shut_down = false;
+    bool is_running = true;
+
+    /* only the protocol is written to stdout, anything else goes to stderr */
+    fflush(stdout);
+    output = fdopen(dup(STDOUT_FILENO), "w");
+    assert("Couldn't open the output" && output != NULL);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    while (is_running && (message = asm_lsp_read_message(stdin)))
+    {
+        method = json_get_string(json_find(message, "method"), NULL);
+        id = json_find(message, "id");
+
+        if (!method)
+        {
+            /* a response to a request of the server (it doesn't send any) */
+        }
+        else if (strcmp(method, "initialize") == 0 && id)
+        {
+            asm_lsp_respond(output, id, "{\"capabilities\":{\"textDocumentSync\":{\"openClose\":true,\"change\":2}},"
+                                        "\"serverInfo\":{\"name\":\"assembler\"}}");
+        }
+        else if (strcmp(method, "shutdown") == 0 && id)
+        {
+            is_shut_down = true;
+            asm_lsp_respond(output, id, "null");
+        }
+        else if (strcmp(method, "exit") == 0)
+        {
+            is_running = false;
+        }
+        else if (strncmp(method, "textDocument/did", 16) == 0)
+        {
+            asm_lsp_on_document(output, method, json_find(message, "params"));
+        }
+        else if (id)
+        {
+            asm_lsp_respond(output, id, NULL);
+        }
+
+        asm_alloc_free(method);
+        asm_alloc_free(message);
+    }
+
+    while (documents)
+    {
+        asm_lsp_destroy_document(linked_list_get_info(documents));
+        linked_list_pop(&documents);
+    }
+    fclose(output);
+
+    return is_shut_down ? 0 : 1;
+}
\ No newline at end of file
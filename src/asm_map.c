@@ -0,0 +1,344 @@
+#include "asm_map.h"
+
+#define MAP_MAGIC "AMAP"
+#define MAP_VERSION 2
+#define MAP_MAX_NAME 4096
+#define MAP_MAX_ADDRESS 0xFFFF
+#define MAP_NUMBER_BYTES 5 /* 35 bits hold any line number */
+#define MAP_ORIGIN_BITS 2
+
+/* the words from address until the next range came from source_line,
+ * and their text from file_line of the file */
+typedef struct map_range_t
+{
+    int address;
+    unsigned int source_line;
+    line_origin_e origin;
+    int file;               /* the index of the file (0 for the source) */
+    unsigned int file_line;
+} map_range_t;
+
+struct asm_map_t
+{
+    char *source;
+    char **files;  /* the files the ranges came from, the first is the source */
+    int files_count;
+    int files_capacity;
+    map_range_t *ranges;
+    int count;
+    int capacity;
+    int end; /* the address after the last word */
+};
+
+/**
+ * @brief writes a variable-length number, 7 bits per byte with the high
+ * bit set on every byte but the last
+ *
+ * @param map_file the .map file
+ * @param value the number
+ */
+static void asm_map_write_number(FILE *map_file, unsigned long value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)(value & 0x7F) | 0x80, map_file);
+        value >>= 7;
+    }
+    fputc((int)value, map_file);
+}
+
+/**
+ * @brief reads a variable-length number
+ *
+ * @param map_file the .map file
+ * @param value returns the number
+ * @return bool false if the file ended or the number is too long
+ */
+static bool asm_map_read_number(FILE *map_file, unsigned long *value)
+{
+    int byte;
+    int count;
+
+    *value = 0;
+    for (count = 0; count < MAP_NUMBER_BYTES; count++)
+    {
+        if ((byte = fgetc(map_file)) == EOF)
+        {
+            return false;
+        }
+        *value |= (unsigned long)(byte & 0x7F) << (7 * count);
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief encodes the change between two line numbers: the lines go back
+ * and forth (a macro, an include or the data after the code), so the
+ * change is zigzag encoded
+ *
+ * @param previous the previous line
+ * @param line the line
+ * @return unsigned long the encoded change
+ */
+static unsigned long asm_map_encode_line(unsigned long previous, unsigned long line)
+{
+    return line >= previous ? (line - previous) << 1 : ((previous - line) << 1) - 1;
+}
+
+/**
+ * @brief decodes the change between two line numbers
+ *
+ * @param line the previous line, returns the line
+ * @param delta the encoded change
+ * @return bool false if the line would be negative
+ */
+static bool asm_map_decode_line(unsigned long *line, unsigned long delta)
+{
+    if (delta & 1)
+    {
+        if ((delta + 1) >> 1 > *line)
+        {
+            return false;
+        }
+        *line -= (delta + 1) >> 1;
+    }
+    else
+    {
+        *line += delta >> 1;
+    }
+    return true;
+}
+
+/**
+ * @brief adds a file to the files of the map
+ *
+ * @param map the map
+ * @param file the path of the file
+ * @param length the length of the path
+ * @return int the index of the file
+ */
+static int asm_map_push_file(asm_map_t *map, char *file, size_t length)
+{
+    if (map->files_count == map->files_capacity)
+    {
+        map->files_capacity = map->files_capacity ? map->files_capacity << 1 : 8;
+        map->files = asm_alloc_realloc(ALLOC_OUTPUT, map->files, map->files_capacity * sizeof(char *));
+        assert("Memory allocation failed" && map->files != NULL);
+    }
+    map->files[map->files_count] = asm_alloc_malloc(ALLOC_OUTPUT, length + 1);
+    assert("Memory allocation failed" && map->files[map->files_count] != NULL);
+    memcpy(map->files[map->files_count], file, length);
+    map->files[map->files_count][length] = '\0';
+
+    return map->files_count++;
+}
+
+/**
+ * @brief adds a range at the end of the map
+ *
+ * @param map the map
+ * @param range the range
+ */
+static void asm_map_push(asm_map_t *map, map_range_t *range)
+{
+    if (map->count == map->capacity)
+    {
+        map->capacity = map->capacity ? map->capacity << 1 : 64;
+        map->ranges = asm_alloc_realloc(ALLOC_OUTPUT, map->ranges, map->capacity * sizeof(map_range_t));
+        assert("Memory allocation failed" && map->ranges != NULL);
+    }
+    map->ranges[map->count++] = *range;
+}
+
+asm_map_t *asm_map_create(char *source)
+{
+    asm_map_t *map;
+
+    map = asm_alloc_calloc(ALLOC_OUTPUT, 1, sizeof(asm_map_t));
+    assert("Memory allocation failed" && map != NULL);
+    asm_map_push_file(map, source, strlen(source));
+    map->source = map->files[0];
+
+    return map;
+}
+
+void asm_map_add(asm_map_t *map, int address, unsigned int source_line, line_origin_e origin, char *file, unsigned int file_line)
+{
+    map_range_t *last = map->count ? &(map->ranges[map->count - 1]) : NULL;
+    map_range_t added;
+
+    added.address = address;
+    added.source_line = source_line;
+    added.origin = origin;
+    added.file_line = file_line;
+    /* a source has few files, so they are searched in order */
+    for (added.file = 0; file && added.file < map->files_count && strcmp(map->files[added.file], file) != 0; added.file++)
+        ;
+    if (file && added.file == map->files_count)
+    {
+        asm_map_push_file(map, file, strlen(file));
+    }
+    added.file = file ? added.file : 0;
+
+    if (!last || last->source_line != source_line || last->origin != origin || last->file != added.file
+        || last->file_line != added.file_line)
+    {
+        asm_map_push(map, &added);
+    }
+}
+
+void asm_map_write(FILE *map_file, asm_map_t *map, int end)
+{
+    unsigned long previous_line = 0;
+    unsigned long previous_file_line = 0;
+    int previous_address;
+    int range;
+    int file;
+
+    fputs(MAP_MAGIC, map_file);
+    fputc(MAP_VERSION, map_file);
+    asm_map_write_number(map_file, map->files_count);
+    for (file = 0; file < map->files_count; file++)
+    {
+        asm_map_write_number(map_file, strlen(map->files[file]));
+        fputs(map->files[file], map_file);
+    }
+
+    previous_address = map->count ? map->ranges[0].address : end;
+    asm_map_write_number(map_file, previous_address);
+    asm_map_write_number(map_file, end);
+    asm_map_write_number(map_file, map->count);
+
+    for (range = 0; range < map->count; range++)
+    {
+        asm_map_write_number(map_file, map->ranges[range].address - previous_address);
+        asm_map_write_number(map_file, asm_map_encode_line(previous_line, map->ranges[range].source_line) << MAP_ORIGIN_BITS
+                                       | map->ranges[range].origin);
+        asm_map_write_number(map_file, map->ranges[range].file);
+        asm_map_write_number(map_file, asm_map_encode_line(previous_file_line, map->ranges[range].file_line));
+        previous_address = map->ranges[range].address;
+        previous_line = map->ranges[range].source_line;
+        previous_file_line = map->ranges[range].file_line;
+    }
+}
+
+asm_map_t *asm_map_read(FILE *map_file)
+{
+    char magic[sizeof(MAP_MAGIC)];
+    char name[MAP_MAX_NAME];
+    asm_map_t *map = NULL;
+    map_range_t range;
+    unsigned long files_count;
+    unsigned long length;
+    unsigned long address;
+    unsigned long end = 0;
+    unsigned long count;
+    unsigned long distance;
+    unsigned long value;
+    unsigned long file;
+    unsigned long line = 0;
+    unsigned long file_line = 0;
+    unsigned long file_delta;
+    bool is_valid;
+
+    is_valid = fread(magic, 1, strlen(MAP_MAGIC), map_file) == strlen(MAP_MAGIC) && memcmp(magic, MAP_MAGIC, strlen(MAP_MAGIC)) == 0
+               && fgetc(map_file) == MAP_VERSION && asm_map_read_number(map_file, &files_count) && files_count > 0
+               && files_count <= MAP_MAX_ADDRESS + 1;
+    /* the first file is the source */
+    while (is_valid && (!map || (unsigned long)map->files_count < files_count))
+    {
+        is_valid = asm_map_read_number(map_file, &length) && length < MAP_MAX_NAME && fread(name, 1, length, map_file) == length;
+        if (is_valid && !map)
+        {
+            name[length] = '\0';
+            map = asm_map_create(name);
+        }
+        else if (is_valid)
+        {
+            asm_map_push_file(map, name, length);
+        }
+    }
+
+    /* every range holds at least a word, so there are no more ranges than words */
+    is_valid = is_valid && asm_map_read_number(map_file, &address) && asm_map_read_number(map_file, &end)
+               && asm_map_read_number(map_file, &count) && address <= end && end <= MAP_MAX_ADDRESS + 1
+               && count <= end - address;
+    if (map)
+    {
+        map->end = end;
+    }
+
+    while (is_valid && (unsigned long)map->count < count)
+    {
+        is_valid = asm_map_read_number(map_file, &distance) && asm_map_read_number(map_file, &value)
+                   && asm_map_read_number(map_file, &file) && asm_map_read_number(map_file, &file_delta)
+                   && (distance > 0 || map->count == 0) && address + distance < end
+                   && (value & ((1 << MAP_ORIGIN_BITS) - 1)) <= ORIGIN_INCLUDE && file < (unsigned long)map->files_count
+                   && asm_map_decode_line(&line, value >> MAP_ORIGIN_BITS) && asm_map_decode_line(&file_line, file_delta);
+        address += distance;
+        if (is_valid)
+        {
+            range.address = address;
+            range.source_line = line;
+            range.origin = (line_origin_e)(value & ((1 << MAP_ORIGIN_BITS) - 1));
+            range.file = file;
+            range.file_line = file_line;
+            asm_map_push(map, &range);
+        }
+    }
+
+    if (!is_valid && map)
+    {
+        asm_map_destroy(map);
+    }
+    return is_valid ? map : NULL;
+}
+
+bool asm_map_lookup(asm_map_t *map, int address, char **source, unsigned int *source_line, line_origin_e *origin,
+                    char **file, unsigned int *file_line)
+{
+    int low = 0;
+    int high = map->count;
+    int middle;
+
+    if (map->count == 0 || address < map->ranges[0].address || address >= map->end)
+    {
+        return false;
+    }
+
+    /* the last range that starts at or before the address */
+    while (high - low > 1)
+    {
+        middle = low + (high - low) / 2;
+        if (map->ranges[middle].address <= address)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *source = map->source;
+    *source_line = map->ranges[low].source_line;
+    *origin = map->ranges[low].origin;
+    *file = map->files[map->ranges[low].file];
+    *file_line = map->ranges[low].file_line;
+    return true;
+}
+
+void asm_map_destroy(asm_map_t *map)
+{
+    while (map->files_count > 0)
+    {
+        asm_alloc_free(map->files[--(map->files_count)]);
+    }
+    asm_alloc_free(map->files);
+    asm_alloc_free(map->ranges);
+    asm_alloc_free(map);
+}
\ No newline at end of file
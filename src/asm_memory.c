@@ -1,4 +1,5 @@
 #include "asm_memory.h"
+#include <string.h>
 
 #define WORD_START 0xFFFF
 #define WORD_END 0xF0000
@@ -22,9 +23,11 @@ struct memory_t
     memory_cell_t *memory;
     uint16_t ic;
     uint16_t dc;
+    uint16_t bss;          /* the words that were reserved after the data without being stored */
+    bool is_full;          /* words were dropped since the memory was reset */
 };
 
-static memory_t *memory_instance;
+static __thread memory_t *memory_instance; /* every thread assembles into its own memory */
 
 /**
  * @brief initializes an asm memory
@@ -35,14 +38,16 @@ static memory_t* asm_memory_init()
 {
     memory_t *new_memory;
 
-    new_memory = (memory_t*)malloc(sizeof(memory_t));
+    new_memory = (memory_t*)asm_alloc_malloc(ALLOC_MEMORY, sizeof(memory_t));
     assert("Memory allocation failed (literally)" && new_memory != NULL);
 
-    new_memory->memory = (memory_cell_t*)calloc((MEMORY_SIZE >> 1), sizeof(memory_cell_t));
+    new_memory->memory = (memory_cell_t*)asm_alloc_calloc(ALLOC_MEMORY, (MEMORY_SIZE >> 1), sizeof(memory_cell_t));
     assert("Memory allocation failed (literally)" && new_memory->memory != NULL);
 
     new_memory->ic = START_IC_VALUE;
     new_memory->dc = MEMORY_SIZE - 1;
+    new_memory->bss = 0;
+    new_memory->is_full = false;
     return new_memory;
 }
 
@@ -55,6 +60,13 @@ memory_t* asm_memory_get_instance()
     return memory_instance;
 }
 
+memory_t* asm_memory_set_instance(memory_t *asm_memory)
+{
+    memory_t *previous_instance = memory_instance;
+    memory_instance = asm_memory;
+    return previous_instance;
+}
+
 uint16_t asm_memory_get_ic(memory_t* asm_memory)
 {
     return asm_memory->ic - START_IC_VALUE;
@@ -65,13 +77,24 @@ uint16_t asm_memory_get_dc(memory_t* asm_memory)
     return MEMORY_SIZE - 1 - asm_memory->dc;
 }
 
+uint16_t asm_memory_get_bss(memory_t* asm_memory)
+{
+    return asm_memory->bss;
+}
+
+bool asm_memory_is_full(memory_t* asm_memory)
+{
+    return asm_memory->is_full;
+}
+
 uint16_t asm_memory_get_pc(memory_t* asm_memory)
 {
-    return asm_memory->ic - START_IC_VALUE + MEMORY_SIZE - 1 - asm_memory->dc;
+    return asm_memory->ic - START_IC_VALUE + MEMORY_SIZE - 1 - asm_memory->dc + asm_memory->bss;
 }
 
 /**
- * @brief writes a 20-bit word into the memory
+ * @brief writes a 20-bit word into the memory (the callers check that the
+ * word fits)
  * @file asm_memory.h
  * 
  * @param asm_memory asm memory
@@ -84,8 +107,8 @@ static void asm_memory_write_word(memory_t* asm_memory, uint16_t word, word_endi
     memory_cell_t *cell;
     uint16_t index = location >> 1;
 
-    assert("Memory overflow" && asm_memory->ic < asm_memory->dc);
-    assert("Invalid memory access" && location < MEMORY_SIZE);
+    ASM_INVARIANT("Memory overflow" && asm_memory->ic <= asm_memory->dc);
+    ASM_INVARIANT("Invalid memory access" && location < MEMORY_SIZE);
 
     cell = &(asm_memory->memory[index]);
     if ((location & 1) == 0)
@@ -104,14 +127,40 @@ static void asm_memory_write_word(memory_t* asm_memory, uint16_t word, word_endi
 
 void asm_memory_push_code(memory_t* asm_memory, uint16_t code_word)
 {
-    asm_memory_write_word(asm_memory, code_word, A, asm_memory->ic);
-    ++(asm_memory->ic);
+    if (asm_memory->ic < asm_memory->dc)
+    {
+        asm_memory_write_word(asm_memory, code_word, A, asm_memory->ic);
+        ++(asm_memory->ic);
+    }
+    else
+    {
+        asm_memory->is_full = true;
+    }
 }
 
 void asm_memory_push_data(memory_t* asm_memory, uint16_t data_word)
 {
-    asm_memory_write_word(asm_memory, data_word, A, asm_memory->dc);
-    --(asm_memory->dc);
+    if (asm_memory->ic < asm_memory->dc)
+    {
+        asm_memory_write_word(asm_memory, data_word, A, asm_memory->dc);
+        --(asm_memory->dc);
+    }
+    else
+    {
+        asm_memory->is_full = true;
+    }
+}
+
+void asm_memory_reserve(memory_t* asm_memory, uint16_t count)
+{
+    if (asm_memory->bss + count <= MEMORY_SIZE)
+    {
+        asm_memory->bss += count;
+    }
+    else
+    {
+        asm_memory->is_full = true;
+    }
 }
 
 /**
@@ -128,7 +177,7 @@ static uint32_t asm_memory_get_word(memory_t* asm_memory, uint16_t location)
     uint32_t word;
     memory_cell_t cell;
 
-    assert("Invalid memory access" && location < MEMORY_SIZE);
+    ASM_INVARIANT("Invalid memory access" && location < MEMORY_SIZE);
     
     cell = asm_memory->memory[index];
     if ((location & 1) == 0)
@@ -168,12 +217,71 @@ uint32_t asm_memory_get_data(memory_t* asm_memory, uint16_t location)
 void asm_memory_rewrite_code(memory_t* asm_memory, uint16_t code_word, word_ending_e ending, uint16_t location)
 {
     location += START_IC_VALUE;
-    assert("Invalid memory access" && location <  asm_memory->ic);
+    ASM_INVARIANT("Invalid memory access" && location <  asm_memory->ic);
     asm_memory_write_word(asm_memory, code_word, ending, location);
 }
 
+void asm_memory_rewrite_data(memory_t* asm_memory, uint16_t data_word, word_ending_e ending, uint16_t location)
+{
+    location = (MEMORY_SIZE - 1) - location;
+    ASM_INVARIANT("Invalid memory access" && location > asm_memory->dc && location < MEMORY_SIZE);
+    asm_memory_write_word(asm_memory, data_word, ending, location);
+}
+
+void asm_memory_append(memory_t* asm_memory, memory_t* source)
+{
+    asm_memory_append_range(asm_memory, source, 0, asm_memory_get_ic(source), 0, asm_memory_get_dc(source));
+    asm_memory_reserve(asm_memory, source->bss);
+    asm_memory->is_full = asm_memory->is_full || source->is_full;
+}
+
+void asm_memory_append_range(memory_t* asm_memory, memory_t* source, uint16_t ic_start, uint16_t ic_count, uint16_t dc_start, uint16_t dc_count)
+{
+    int location;
+    uint32_t word;
+
+    /* the whole range is checked once, so the words are copied without checks */
+    if (ic_count + dc_count > asm_memory->dc - asm_memory->ic)
+    {
+        asm_memory->is_full = true;
+        return;
+    }
+
+    for (location = START_IC_VALUE + ic_start; location < START_IC_VALUE + ic_start + ic_count; ++location)
+    {
+        word = asm_memory_get_word(source, location);
+        asm_memory_write_word(asm_memory, word & WORD_START, (word & WORD_END) >> WORD_START_BITS, asm_memory->ic);
+        ++(asm_memory->ic);
+    }
+
+    for (location = MEMORY_SIZE - 1 - dc_start; location > MEMORY_SIZE - 1 - dc_start - dc_count; --location)
+    {
+        word = asm_memory_get_word(source, location);
+        asm_memory_write_word(asm_memory, word & WORD_START, (word & WORD_END) >> WORD_START_BITS, asm_memory->dc);
+        --(asm_memory->dc);
+    }
+}
+
+void asm_memory_reset(memory_t* asm_memory)
+{
+    /* only the cells that were pushed to are cleared */
+    memset(asm_memory->memory + (START_IC_VALUE >> 1), 0, 
+           (((asm_memory->ic + 1) >> 1) - (START_IC_VALUE >> 1)) * sizeof(memory_cell_t));
+    memset(asm_memory->memory + ((asm_memory->dc + 1) >> 1), 0,
+           ((MEMORY_SIZE >> 1) - ((asm_memory->dc + 1) >> 1)) * sizeof(memory_cell_t));
+
+    asm_memory->ic = START_IC_VALUE;
+    asm_memory->dc = MEMORY_SIZE - 1;
+    asm_memory->bss = 0;
+    asm_memory->is_full = false;
+}
+
 void asm_memory_destroy(memory_t* asm_memory)
 {
-    free(asm_memory->memory);
-    free(asm_memory);
+    if (asm_memory == memory_instance)
+    {
+        memory_instance = NULL;
+    }
+    asm_alloc_free(asm_memory->memory);
+    asm_alloc_free(asm_memory);
 }
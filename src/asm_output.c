@@ -1,47 +1,180 @@
+#define _GNU_SOURCE
 #include "asm_output.h"
+#include "asm_pipeline.h"
+#include "asm_io.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ASM_OUTPUT_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#define OB_LINE_LENGTH 20   /* "%04d\t" and five "Xx" parts separated by "-" and a newline */
+#define OB_BLOCK_WORDS 256  /* the words that are formatted before they are written */
+#define OB_MAX_LINE 9999    /* the last line that has a 4 digits address */
+#define OB_HEADER_LENGTH 10 /* "%4d\t%4d\n" */
+#define OB_RANGE_MIN_WORDS 1024 /* a range that is smaller isn't worth a thread */
+
+/* a range of the lines of the .ob file that is formatted and written by a thread */
+typedef struct ob_range_t
+{
+    memory_t *memory;
+    int fd;
+    uint16_t start;  /* the first word of the range (the code and then the data) */
+    uint16_t count;
+    bool is_written;
+} ob_range_t;
+
+static const char hexa_digits[] = "0123456789abcdef";
+
+#ifdef ASM_OUTPUT_SSSE3
+/* where the low (first four) and the high (last four) nibbles of the bytes
+ * of each of four words go in the last 16 characters of its line */
+static const int8_t nibble_shuffles[8][16] = {
+    {-1, -1, 2, -1, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1, 0, -1},
+    {-1, -1, 6, -1, -1, -1, -1, -1, 5, -1, -1, -1, -1, -1, 4, -1},
+    {-1, -1, 10, -1, -1, -1, -1, -1, 9, -1, -1, -1, -1, -1, 8, -1},
+    {-1, -1, 14, -1, -1, -1, -1, -1, 13, -1, -1, -1, -1, -1, 12, -1},
+    {-1, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1, 0, -1, -1, -1, -1},
+    {-1, -1, -1, -1, -1, 5, -1, -1, -1, -1, -1, 4, -1, -1, -1, -1},
+    {-1, -1, -1, -1, -1, 9, -1, -1, -1, -1, -1, 8, -1, -1, -1, -1},
+    {-1, -1, -1, -1, -1, 13, -1, -1, -1, -1, -1, 12, -1, -1, -1, -1}};
+#endif
 
 /**
- * @brief writes the binary memory words in the hexa format
+ * @brief formats words as complete .ob lines, one word at a time
  * 
- * @param ob_file object file
- * @param word binary 20-bit word
+ * @param out the formatted lines
+ * @param words binary 20-bit words
+ * @param count the number of words
+ * @param line the address of the first word
  */
-static void asm_output_write_in_hexa_format(FILE *ob_file, uint32_t word)
+static void asm_output_format_lines_scalar(char *out, uint32_t *words, int count, uint16_t line)
 {
-    char hexa[5];
     uint8_t offset;
 
-    hexa[0] = (word & 0xF0000) >> 16;
-    hexa[1] = (word & 0x0F000) >> 12;
-    hexa[2] = (word & 0x00F00) >> 8;
-    hexa[3] = (word & 0x000F0) >> 4;
-    hexa[4] = (word & 0x0000F); 
+    for (; count > 0; --count, ++words, ++line, out += OB_LINE_LENGTH)
+    {
+        out[0] = '0' + line / 1000 % 10;
+        out[1] = '0' + line / 100 % 10;
+        out[2] = '0' + line / 10 % 10;
+        out[3] = '0' + line % 10;
+        out[4] = '\t';
+        for (offset = 0; offset < 5; ++offset)
+        {
+            out[5 + 3 * offset] = 'A' + offset;
+            out[6 + 3 * offset] = hexa_digits[(*words >> (16 - 4 * offset)) & 0xF];
+            out[7 + 3 * offset] = '-';
+        }
+        out[OB_LINE_LENGTH - 1] = '\n';
+    }
+}
 
-    fprintf(ob_file, "%c%x", 'A', hexa[0]);
-    for (offset = 1; offset < 5; ++offset)
+#ifdef ASM_OUTPUT_SSSE3
+/**
+ * @brief formats words as complete .ob lines, four words at a time. The
+ * nibbles of the words are turned to hexa digits with a single shuffle of
+ * the digits table and shuffled into a template of the line, and the
+ * decimal digits of the four addresses are computed at once with a
+ * multiplication by the reciprocal of 10
+ * 
+ * @param out the formatted lines
+ * @param words binary 20-bit words
+ * @param count the number of words
+ * @param line the address of the first word
+ */
+__attribute__((target("ssse3")))
+static void asm_output_format_lines_ssse3(char *out, uint32_t *words, int count, uint16_t line)
+{
+    /* "\tAx-Bx-Cx-Dx-Ex\n" without its digits, the last 16 characters of a line */
+    const __m128i template = _mm_setr_epi8('\t', 'A', 0, '-', 'B', 0, '-', 'C', 0, '-', 'D', 0, '-', 'E', 0, '\n');
+    const __m128i digits = _mm_loadu_si128((const __m128i *)hexa_digits);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i steps = _mm_setr_epi16(0, 1, 2, 3, 0, 0, 0, 0);
+    const __m128i reciprocal = _mm_set1_epi16((short)0xCCCD); /* x / 10 == (x * 0xCCCD) >> 19 for 16 bits */
+    const __m128i ten = _mm_set1_epi16(10);
+    __m128i block;
+    __m128i low;
+    __m128i high;
+    __m128i lines;
+    __m128i quotient;
+    __m128i ones;
+    __m128i tens;
+    __m128i hundreds;
+    __m128i thousands;
+    __m128i address_digits;
+    int32_t address[4];
+    int word;
+
+    for (; count >= 4 && line + 3 <= OB_MAX_LINE; count -= 4, words += 4, line += 4, out += 4 * OB_LINE_LENGTH)
     {
-        fprintf(ob_file, "-%c%x", 'A' + offset, hexa[offset]);
+        block = _mm_loadu_si128((const __m128i *)words);
+        low = _mm_shuffle_epi8(digits, _mm_and_si128(block, nibble_mask));
+        high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(block, 4), nibble_mask));
+
+        lines = _mm_add_epi16(_mm_set1_epi16(line), steps);
+        quotient = _mm_srli_epi16(_mm_mulhi_epu16(lines, reciprocal), 3);
+        ones = _mm_sub_epi16(lines, _mm_mullo_epi16(quotient, ten));
+        lines = quotient;
+        quotient = _mm_srli_epi16(_mm_mulhi_epu16(lines, reciprocal), 3);
+        tens = _mm_sub_epi16(lines, _mm_mullo_epi16(quotient, ten));
+        lines = quotient;
+        quotient = _mm_srli_epi16(_mm_mulhi_epu16(lines, reciprocal), 3);
+        hundreds = _mm_sub_epi16(lines, _mm_mullo_epi16(quotient, ten));
+        thousands = quotient;
+
+        /* the four digits of every address, in order, as the bytes of a 32-bit lane */
+        address_digits = _mm_unpacklo_epi32(_mm_unpacklo_epi16(thousands, hundreds), _mm_unpacklo_epi16(tens, ones));
+        address_digits = _mm_add_epi8(_mm_packus_epi16(address_digits, _mm_unpackhi_epi32(_mm_unpacklo_epi16(thousands, hundreds),
+                                                                                         _mm_unpacklo_epi16(tens, ones))),
+                                      _mm_set1_epi8('0'));
+        _mm_storeu_si128((__m128i *)address, address_digits);
+
+        for (word = 0; word < 4; word++)
+        {
+            memcpy(out + word * OB_LINE_LENGTH, &(address[word]), 4);
+            _mm_storeu_si128((__m128i *)(out + word * OB_LINE_LENGTH + 4),
+                             _mm_or_si128(template, _mm_or_si128(
+                                 _mm_shuffle_epi8(low, _mm_loadu_si128((const __m128i *)nibble_shuffles[word])),
+                                 _mm_shuffle_epi8(high, _mm_loadu_si128((const __m128i *)nibble_shuffles[4 + word])))));
+        }
     }
+
+    asm_output_format_lines_scalar(out, words, count, line);
 }
+#endif
 
-void asm_output_extern_label(FILE *ext_file, label_t *label)
+/**
+ * @brief formats words as complete .ob lines with the fastest formatter
+ * the processor supports (the output is the same)
+ * 
+ * @param out the formatted lines
+ * @param words binary 20-bit words
+ * @param count the number of words
+ * @param line the address of the first word
+ */
+static void asm_output_format_lines(char *out, uint32_t *words, int count, uint16_t line)
+{
+#ifdef ASM_OUTPUT_SSSE3
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        asm_output_format_lines_ssse3(out, words, count, line);
+        return;
+    }
+#endif
+    asm_output_format_lines_scalar(out, words, count, line);
+}
+
+void asm_output_extern_reference(FILE *ext_file, char *symbol, int location)
 {
-    char* symbol;
-    linked_list_node_t *lines;
     int line;
     unsigned int offset;
-    
-    lines = label_get_lines(label);
-    symbol = label_get_symbol(label);
 
-    while (lines)
-    {
-        line = *((int*)linked_list_get_info(lines)) + START_IC_VALUE;
-        offset = line % 16;
-        fprintf(ext_file, "%s BASE %d\n", symbol, line - offset);
-        fprintf(ext_file, "%s OFFSET %d\n\n", symbol, offset);
-        lines = linked_list_get_next_address(lines);
-    }
+    line = location + START_IC_VALUE;
+    offset = line % 16;
+    fprintf(ext_file, "%s BASE %d\n", symbol, line - offset);
+    fprintf(ext_file, "%s OFFSET %d\n\n", symbol, offset);
 }
 
 void asm_output_entry_label(FILE *ent_file, label_t *label)
@@ -49,32 +182,179 @@ void asm_output_entry_label(FILE *ent_file, label_t *label)
     fprintf(ent_file, "%s,%d,%d\n", label_get_symbol(label), label_get_base_address(label), label_get_offset(label));
 }
 
+/**
+ * @brief formats a range of the words of the memory (the code and then the
+ * data) as complete .ob lines
+ * 
+ * @param out the formatted lines
+ * @param memory the memory
+ * @param start the first word of the range
+ * @param count the number of words
+ */
+static void asm_output_format_range(char *out, memory_t *memory, uint16_t start, uint16_t count)
+{
+    uint32_t words[OB_BLOCK_WORDS];
+    uint16_t icf = asm_memory_get_ic(memory);
+    uint16_t location;
+    int block = 0;
+
+    for (location = start; location < start + count; ++location)
+    {
+        words[block++] = (location < icf) ? asm_memory_get_code(memory, location) : asm_memory_get_data(memory, location - icf);
+        if (block == OB_BLOCK_WORDS || location + 1 == start + count)
+        {
+            asm_output_format_lines(out, words, block, START_IC_VALUE + location + 1 - block);
+            out += block * OB_LINE_LENGTH;
+            block = 0;
+        }
+    }
+}
+
 void asm_output_ob_file(FILE *ob_file, memory_t *memory)
 {
-    uint32_t word;
-    uint16_t line = START_IC_VALUE;
+    char lines[OB_BLOCK_WORDS * OB_LINE_LENGTH];
     uint16_t icf;
     uint16_t dcf;
     uint16_t location;
+    uint16_t count;
 
     icf = asm_memory_get_ic(memory);
     dcf = asm_memory_get_dc(memory);
 
     fprintf(ob_file, "%4d\t%4d\n", icf, dcf);
 
-    for (location = 0; location < icf; ++location)
+    /* the code and then the data are formatted in blocks of lines */
+    for (location = 0; location < icf + dcf; location += count)
     {
-        word = asm_memory_get_code(memory, location);
-        fprintf(ob_file, "%04d\t", line++);
-        asm_output_write_in_hexa_format(ob_file, word);
-        fprintf(ob_file, "%c", '\n');
+        count = (icf + dcf - location < OB_BLOCK_WORDS) ? icf + dcf - location : OB_BLOCK_WORDS;
+        asm_output_format_range(lines, memory, location, count);
+        fwrite(lines, OB_LINE_LENGTH, count, ob_file);
     }
+}
+
+void asm_output_ob_words(FILE *ob_file, uint32_t *words, int count, uint16_t line)
+{
+    char lines[OB_BLOCK_WORDS * OB_LINE_LENGTH];
+    int block;
 
-    for (location = 0; location < dcf; ++location)
+    for (; count > 0; count -= block, words += block, line += block)
     {
-        word = asm_memory_get_data(memory, location);
-        fprintf(ob_file, "%04d\t", line++);
-        asm_output_write_in_hexa_format(ob_file, word);
-        fprintf(ob_file, "%c", '\n');
+        block = count < OB_BLOCK_WORDS ? count : OB_BLOCK_WORDS;
+        asm_output_format_lines(lines, words, block, line);
+        fwrite(lines, OB_LINE_LENGTH, block, ob_file);
     }
+}
+
+void asm_output_rel_file(FILE *rel_file, memory_t *memory)
+{
+    uint16_t icf = asm_memory_get_ic(memory);
+    uint16_t location;
+    int count = 0;
+
+    /* a label is a base word and an offset word that are both relocatable */
+    for (location = 0; location + 1 < icf; ++location)
+    {
+        if ((asm_memory_get_code(memory, location) >> 16) == R)
+        {
+            ++count;
+            ++location;
+        }
+    }
+
+    fprintf(rel_file, "%d\n", count);
+    for (location = 0; location + 1 < icf; ++location)
+    {
+        if ((asm_memory_get_code(memory, location) >> 16) == R)
+        {
+            fprintf(rel_file, "%d\n", location);
+            ++location;
+        }
+    }
+}
+
+void asm_output_relocatable_expression(FILE *rel_file, uint16_t location, bool is_data)
+{
+    fprintf(rel_file, "%s %d\n", is_data ? "DATA" : "CODE", location);
+}
+
+/**
+ * @brief formats a range of the .ob file and writes it at its offset
+ * (runs as a pipeline task)
+ * 
+ * @param range the range
+ */
+static void asm_output_write_range(void *range)
+{
+    ob_range_t *current = range;
+    char *lines;
+    size_t length = (size_t)current->count * OB_LINE_LENGTH;
+    size_t written = 0;
+    off_t offset = OB_HEADER_LENGTH + (off_t)current->start * OB_LINE_LENGTH;
+    ssize_t result;
+
+    if (length == 0)
+    {
+        current->is_written = true;
+        return;
+    }
+    lines = asm_alloc_malloc(ALLOC_OUTPUT, length);
+    assert("Memory allocation failed" && lines != NULL);
+    asm_output_format_range(lines, current->memory, current->start, current->count);
+
+    while (written < length && (result = pwrite(current->fd, lines + written, length - written, offset + written)) > 0)
+    {
+        written += result;
+    }
+    current->is_written = written == length;
+    asm_alloc_free(lines);
+}
+
+bool asm_output_ob_file_parallel(char *path, memory_t *memory, int threads)
+{
+    char header[16];
+    ob_range_t *ranges;
+    asm_pipeline_task_t **tasks;
+    uint16_t words;
+    int range;
+    int fd;
+    bool is_written;
+
+    words = asm_memory_get_ic(memory) + asm_memory_get_dc(memory);
+    if (threads > words / OB_RANGE_MIN_WORDS)
+    {
+        threads = words / OB_RANGE_MIN_WORDS;
+    }
+    threads = threads > 0 ? threads : 1;
+
+    /* the ranges are written to a temporary file that replaces the output only if it changed */
+    if ((fd = asm_io_open_descriptor(path)) < 0)
+    {
+        return false;
+    }
+    /* every line has the same width, so the size of the file (and the offset of every word) is known */
+    is_written = fallocate(fd, 0, 0, OB_HEADER_LENGTH + (off_t)words * OB_LINE_LENGTH) == 0
+        || ftruncate(fd, OB_HEADER_LENGTH + (off_t)words * OB_LINE_LENGTH) == 0;
+    sprintf(header, "%4d\t%4d\n", asm_memory_get_ic(memory), asm_memory_get_dc(memory));
+    is_written = pwrite(fd, header, OB_HEADER_LENGTH, 0) == OB_HEADER_LENGTH && is_written;
+
+    ranges = asm_alloc_malloc(ALLOC_OUTPUT, threads * sizeof(ob_range_t));
+    tasks = asm_alloc_malloc(ALLOC_OUTPUT, threads * sizeof(asm_pipeline_task_t*));
+    assert("Memory allocation failed" && ranges != NULL && tasks != NULL);
+    for (range = 0; range < threads; range++)
+    {
+        ranges[range].memory = memory;
+        ranges[range].fd = fd;
+        ranges[range].start = (uint32_t)words * range / threads;
+        ranges[range].count = (uint32_t)words * (range + 1) / threads - ranges[range].start;
+        tasks[range] = asm_pipeline_start_task(asm_output_write_range, &ranges[range]);
+    }
+    for (range = 0; range < threads; range++)
+    {
+        asm_pipeline_join_task(tasks[range]);
+        is_written = is_written && ranges[range].is_written;
+    }
+
+    asm_alloc_free(tasks);
+    asm_alloc_free(ranges);
+    return asm_io_close_descriptor(fd, is_written);
 }
\ No newline at end of file
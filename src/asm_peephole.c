@@ -0,0 +1,230 @@
+#include "asm_peephole.h"
+
+#define WORD_VALUE(word) ((word) & 0xFFFF)
+#define WORD_ENDING(word) ((word) >> 16)
+
+#define ARGS_DEST_ADDRESS(word) ((word) & 0x3)
+#define ARGS_DEST_REGISTER(word) (((word) >> 2) & 0xF)
+#define ARGS_SRC_ADDRESS(word) (((word) >> 6) & 0x3)
+#define ARGS_SRC_REGISTER(word) (((word) >> 8) & 0xF)
+#define ARGS_FUNCT(word) (((word) >> 12) & 0xF)
+
+#define LINE_IC(line_pc, line) ((line_pc)[line][0])
+#define LINE_DC(line_pc, line) ((line_pc)[line][1])
+
+/* an instruction decoded from its words */
+typedef struct peephole_instruction_t
+{
+    asm_word_e name;             /* INVALID_ASM_WORD for a line without code */
+    bool has_src;
+    address_e src_address;
+    uint8_t src_register;
+    uint16_t src_value;          /* the first word of the source operand */
+    bool has_dest;
+    address_e dest_address;
+    uint8_t dest_register;
+    uint32_t dest_words[2];      /* the words of the destination operand */
+    bool is_removed;
+} peephole_instruction_t;
+
+/**
+ * @brief decodes the instruction of a line from its words
+ *
+ * @param instruction the decoded instruction
+ * @param memory the code
+ * @param ic the ic of the instruction
+ * @param words the number of words of the instruction
+ */
+static void asm_peephole_decode(peephole_instruction_t *instruction, memory_t *memory, uint16_t ic, uint16_t words)
+{
+    uint16_t opcode_word;
+    uint16_t args_word = 0;
+    uint8_t opcode = 0;
+    uint16_t location;
+
+    memset(instruction, 0, sizeof(peephole_instruction_t));
+    if (words == 0)
+    {
+        return;
+    }
+
+    opcode_word = WORD_VALUE(asm_memory_get_code(memory, ic));
+    while (opcode < 15 && !(opcode_word & (1 << opcode)))
+    {
+        ++opcode;
+    }
+    if (words > 1)
+    {
+        args_word = WORD_VALUE(asm_memory_get_code(memory, ic + 1));
+    }
+    instruction->name = asm_language_get_instruction(opcode, ARGS_FUNCT(args_word));
+    if (instruction->name == INVALID_ASM_WORD)
+    {
+        return;
+    }
+
+    location = ic + 2;
+    instruction->has_src = asm_language_get_instruction_args_num(instruction->name) == 2;
+    instruction->has_dest = asm_language_get_instruction_args_num(instruction->name) >= 1;
+    if (instruction->has_src)
+    {
+        instruction->src_address = ARGS_SRC_ADDRESS(args_word);
+        instruction->src_register = ARGS_SRC_REGISTER(args_word);
+        instruction->src_value = WORD_VALUE(asm_memory_get_code(memory, location));
+        location += argument_get_words_by_address(instruction->src_address);
+    }
+    if (instruction->has_dest)
+    {
+        instruction->dest_address = ARGS_DEST_ADDRESS(args_word);
+        instruction->dest_register = ARGS_DEST_REGISTER(args_word);
+        instruction->dest_words[0] = asm_memory_get_code(memory, location);
+        instruction->dest_words[1] = asm_memory_get_code(memory, location + 1);
+    }
+}
+
+/**
+ * @brief checks if an instruction reads a register through its source
+ *
+ * @param instruction the instruction
+ * @param reg the register
+ * @return bool true if the source reads the register
+ */
+static bool asm_peephole_reads_register(peephole_instruction_t *instruction, uint8_t reg)
+{
+    return instruction->has_src && instruction->src_register == reg
+        && (instruction->src_address == REGISTER_DIRECT || instruction->src_address == INDEX);
+}
+
+/**
+ * @brief checks if an instruction can be removed
+ *
+ * @param instruction the instruction
+ * @param next the instruction that runs after it (NULL if there isn't one)
+ * @param next_pc the pc of the next instruction
+ * @return bool true if the instruction doesn't change the result
+ */
+static bool asm_peephole_is_redundant(peephole_instruction_t *instruction, peephole_instruction_t *next, uint16_t next_pc)
+{
+    switch (instruction->name)
+    {
+    case MOV:
+        return instruction->src_address == REGISTER_DIRECT && instruction->dest_address == REGISTER_DIRECT
+            && instruction->src_register == instruction->dest_register;
+    case ADD:
+    case SUB:
+        return instruction->src_address == IMMEDIATE && instruction->src_value == 0;
+    case JMP:
+        /* the address of a label is its base and offset words */
+        return next && instruction->dest_address == DIRECT && WORD_ENDING(instruction->dest_words[0]) == R
+            && WORD_VALUE(instruction->dest_words[0]) + WORD_VALUE(instruction->dest_words[1]) == START_IC_VALUE + next_pc;
+    case CLR:
+        return next && instruction->dest_address == REGISTER_DIRECT
+            && (next->name == CLR || next->name == MOV || next->name == LEA)
+            && next->dest_address == REGISTER_DIRECT && next->dest_register == instruction->dest_register
+            && !asm_peephole_reads_register(next, instruction->dest_register);
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief returns the label that is defined in a line
+ *
+ * @param line the line
+ * @param label the label (with its colon)
+ * @return bool true if the line defines a label
+ */
+static bool asm_peephole_get_label(char *line, char *label)
+{
+    char word[LINE_LENGTH];
+
+    word[0] = '\0';
+    sscanf(line, "%s", label);
+    strcpy(word, label);
+    return *word && label_check_if_definition(word);
+}
+
+/**
+ * @brief removes the line of an instruction, moving its label to the line
+ * of the next instruction
+ *
+ * @param lines the lines
+ * @param line the removed line
+ * @param next_line the line of the next instruction (-1 if there isn't one)
+ * @return bool false if the label couldn't be moved (nothing is removed)
+ */
+static bool asm_peephole_remove_line(char (*lines)[LINE_LENGTH], int line, int next_line)
+{
+    char label[LINE_LENGTH];
+    char next_label[LINE_LENGTH];
+    char moved[LINE_LENGTH];
+    char *next_text;
+
+    if (asm_peephole_get_label(lines[line], label))
+    {
+        if (next_line < 0 || asm_peephole_get_label(lines[next_line], next_label))
+        {
+            return false;
+        }
+        for (next_text = lines[next_line]; isspace(*next_text); ++next_text);
+        if (strlen(label) + 1 + strlen(next_text) >= LINE_LENGTH)
+        {
+            return false;
+        }
+        strcpy(moved, label);
+        strcat(moved, " ");
+        strcat(moved, next_text);
+        strcpy(lines[next_line], moved);
+    }
+    strcpy(lines[line], "\n");
+
+    return true;
+}
+
+int asm_peephole_optimize(char (*lines)[LINE_LENGTH], int lines_count, uint16_t (*line_pc)[2], memory_t *memory)
+{
+    peephole_instruction_t *instructions;
+    int line;
+    int next_line;
+    int removed = 0;
+    bool is_changed = true;
+
+    instructions = asm_alloc_malloc(ALLOC_PASSES, (lines_count + 1) * sizeof(peephole_instruction_t));
+    assert("Memory allocation failed" && instructions != NULL);
+    for (line = 0; line < lines_count; line++)
+    {
+        asm_peephole_decode(&(instructions[line]), memory, LINE_IC(line_pc, line),
+                            LINE_IC(line_pc, line + 1) - LINE_IC(line_pc, line));
+    }
+
+    /* a removal can make the instructions around it redundant */
+    while (is_changed)
+    {
+        is_changed = false;
+        for (line = 0; line < lines_count; line++)
+        {
+            if (instructions[line].name == INVALID_ASM_WORD || instructions[line].is_removed)
+            {
+                continue;
+            }
+            for (next_line = line + 1; next_line < lines_count
+                 && (instructions[next_line].name == INVALID_ASM_WORD || instructions[next_line].is_removed); next_line++);
+            if (next_line == lines_count || LINE_DC(line_pc, next_line) != LINE_DC(line_pc, line))
+            {
+                next_line = -1; /* the data right after the instruction isn't an instruction that runs next */
+            }
+
+            if (asm_peephole_is_redundant(&(instructions[line]), next_line < 0 ? NULL : &(instructions[next_line]),
+                                          next_line < 0 ? 0 : LINE_IC(line_pc, next_line) + LINE_DC(line_pc, next_line))
+                && asm_peephole_remove_line(lines, line, next_line))
+            {
+                instructions[line].is_removed = true;
+                is_changed = true;
+                ++removed;
+            }
+        }
+    }
+
+    asm_alloc_free(instructions);
+    return removed;
+}
\ No newline at end of file
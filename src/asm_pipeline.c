@@ -0,0 +1,213 @@
+#define _POSIX_C_SOURCE 200809L
+#include "asm_pipeline.h"
+#include <pthread.h>
+
+typedef struct ring_t
+{
+    char lines[PIPELINE_RING_SIZE][LINE_LENGTH];
+    unsigned int head;  /* next line to pop */
+    unsigned int count; /* lines waiting in the ring */
+    bool is_done;       /* the producer won't push anymore */
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} ring_t;
+
+typedef struct producer_t
+{
+    ring_t *ring;
+    FILE *current_file;
+    FILE *am_file;
+    macro_includes_t *includes; /* the includes of the assembling thread */
+} producer_t;
+
+struct asm_pipeline_task_t
+{
+    pthread_t thread;
+    void (*task)(void*);
+    void *argument;
+};
+
+/**
+ * @brief pushes a line to the ring, waiting while the ring is full
+ *
+ * @param ring the ring
+ * @param line the line
+ */
+static void asm_pipeline_push(ring_t *ring, char *line)
+{
+    unsigned int slot;
+
+    pthread_mutex_lock(&(ring->lock));
+    while (ring->count == PIPELINE_RING_SIZE)
+    {
+        pthread_cond_wait(&(ring->not_full), &(ring->lock));
+    }
+    slot = (ring->head + ring->count) % PIPELINE_RING_SIZE;
+    pthread_mutex_unlock(&(ring->lock));
+
+    /* the slot is owned by the producer until count is increased */
+    strcpy(ring->lines[slot], line);
+
+    pthread_mutex_lock(&(ring->lock));
+    ++(ring->count);
+    pthread_cond_signal(&(ring->not_empty));
+    pthread_mutex_unlock(&(ring->lock));
+}
+
+/**
+ * @brief waits for a line in the ring
+ *
+ * @param ring the ring
+ * @return char* the line (stays valid until asm_pipeline_release is called)
+ * or NULL if the producer is done
+ */
+static char *asm_pipeline_peek(ring_t *ring)
+{
+    char *line = NULL;
+
+    pthread_mutex_lock(&(ring->lock));
+    while (ring->count == 0 && !ring->is_done)
+    {
+        pthread_cond_wait(&(ring->not_empty), &(ring->lock));
+    }
+    if (ring->count)
+    {
+        line = ring->lines[ring->head];
+    }
+    pthread_mutex_unlock(&(ring->lock));
+
+    return line;
+}
+
+/**
+ * @brief frees the slot of the line returned by asm_pipeline_peek
+ *
+ * @param ring the ring
+ */
+static void asm_pipeline_release(ring_t *ring)
+{
+    pthread_mutex_lock(&(ring->lock));
+    ring->head = (ring->head + 1) % PIPELINE_RING_SIZE;
+    --(ring->count);
+    pthread_cond_signal(&(ring->not_full));
+    pthread_mutex_unlock(&(ring->lock));
+}
+
+/**
+ * @brief passes an opened line to the ring (and to the am file)
+ *
+ * @param line the line
+ * @param producer the producer
+ */
+static void asm_pipeline_on_expanded_line(char *line, void *producer)
+{
+    if (((producer_t*)producer)->am_file)
+    {
+        fputs(line, ((producer_t*)producer)->am_file);
+    }
+    asm_pipeline_push(((producer_t*)producer)->ring, line);
+}
+
+/**
+ * @brief the macro stage thread
+ *
+ * @param producer the producer
+ * @return void* NULL
+ */
+static void *asm_pipeline_produce(void *producer)
+{
+    ring_t *ring = ((producer_t*)producer)->ring;
+
+    macro_includes_set_instance(((producer_t*)producer)->includes);
+    macro_expand(((producer_t*)producer)->current_file, asm_pipeline_on_expanded_line, producer);
+
+    pthread_mutex_lock(&(ring->lock));
+    ring->is_done = true;
+    pthread_cond_signal(&(ring->not_empty));
+    pthread_mutex_unlock(&(ring->lock));
+
+    return NULL;
+}
+
+void asm_pipeline_expand(FILE *current_file, FILE *am_file, macro_line_handler_t handler, void *context)
+{
+    ring_t *ring;
+    producer_t producer;
+    pthread_t producer_thread;
+    char *line;
+
+    ring = (ring_t*)asm_alloc_malloc(ALLOC_PASSES, sizeof(ring_t));
+    assert("Couldn't allocate the pipeline ring\n" && ring != NULL);
+    ring->head = 0;
+    ring->count = 0;
+    ring->is_done = false;
+    pthread_mutex_init(&(ring->lock), NULL);
+    pthread_cond_init(&(ring->not_empty), NULL);
+    pthread_cond_init(&(ring->not_full), NULL);
+
+    producer.ring = ring;
+    producer.current_file = current_file;
+    producer.am_file = am_file;
+    producer.includes = macro_includes_get_instance();
+
+    if (pthread_create(&producer_thread, NULL, asm_pipeline_produce, &producer) != 0)
+    {
+        /* no thread to spare, the stages run one after the other */
+        macro_expand(current_file, handler, context);
+    }
+    else
+    {
+        while ((line = asm_pipeline_peek(ring)))
+        {
+            handler(line, context);
+            asm_pipeline_release(ring);
+        }
+        pthread_join(producer_thread, NULL);
+    }
+
+    pthread_cond_destroy(&(ring->not_full));
+    pthread_cond_destroy(&(ring->not_empty));
+    pthread_mutex_destroy(&(ring->lock));
+    asm_alloc_free(ring);
+}
+
+/**
+ * @brief the thread of a task
+ *
+ * @param task the task
+ * @return void* NULL
+ */
+static void *asm_pipeline_run_task(void *task)
+{
+    ((asm_pipeline_task_t*)task)->task(((asm_pipeline_task_t*)task)->argument);
+    return NULL;
+}
+
+asm_pipeline_task_t *asm_pipeline_start_task(void (*task)(void*), void *argument)
+{
+    asm_pipeline_task_t *new_task;
+
+    new_task = (asm_pipeline_task_t*)asm_alloc_malloc(ALLOC_PASSES, sizeof(asm_pipeline_task_t));
+    assert("Couldn't allocate a pipeline task\n" && new_task != NULL);
+    new_task->task = task;
+    new_task->argument = argument;
+
+    if (pthread_create(&(new_task->thread), NULL, asm_pipeline_run_task, new_task) != 0)
+    {
+        /* no thread to spare, the task runs now */
+        task(argument);
+        asm_alloc_free(new_task);
+        new_task = NULL;
+    }
+    return new_task;
+}
+
+void asm_pipeline_join_task(asm_pipeline_task_t *task)
+{
+    if (task)
+    {
+        pthread_join(task->thread, NULL);
+        asm_alloc_free(task);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "asm_rebase.h"
+
+#define REBASE_MAX_LINE 9999 /* the last line that has a 4 digits address */
+#define REBASE_MAX_WORDS 8192
+#define WORD_VALUE(word) ((word) & 0xFFFF)
+#define WORD_ENDING(word) ((word) >> 16)
+
+/* an entry label or a reference to an extern label, with its address */
+typedef struct rebase_label_t
+{
+    char symbol[LABEL_MAX_LENGTH + 1];
+    int address;
+} rebase_label_t;
+
+/* the labels of an .ent or an .ext file */
+typedef struct rebase_labels_t
+{
+    rebase_label_t *labels;
+    int count;
+    bool is_found; /* does the file exist */
+} rebase_labels_t;
+
+/**
+ * @brief reads the words of an object file
+ *
+ * @param ob_file the object file
+ * @param words returns the words
+ * @param count returns the number of words (the code and then the data)
+ * @param icf returns the number of code words
+ * @param dcf returns the number of data words
+ * @param first_line returns the address of the first word
+ * @return bool true if the file is a valid object file
+ */
+static bool asm_rebase_read_ob(FILE *ob_file, uint32_t *words, int *count, int *icf, int *dcf, int *first_line)
+{
+    unsigned int nibbles[5];
+    int line;
+    int expected_line = 0;
+
+    if (fscanf(ob_file, "%d %d", icf, dcf) != 2 || *icf < 0 || *dcf < 0 || *icf + *dcf > REBASE_MAX_WORDS)
+    {
+        return false;
+    }
+
+    *first_line = 0;
+    for (*count = 0; *count < *icf + *dcf; ++(*count))
+    {
+        if (fscanf(ob_file, "%d A%x-B%x-C%x-D%x-E%x", &line, &nibbles[0], &nibbles[1], &nibbles[2], &nibbles[3], &nibbles[4]) != 6
+            || (*count > 0 && line != expected_line))
+        {
+            return false;
+        }
+        *first_line = *count == 0 ? line : *first_line;
+        expected_line = line + 1;
+        words[*count] = nibbles[0] << 16 | nibbles[1] << 12 | nibbles[2] << 8 | nibbles[3] << 4 | nibbles[4];
+    }
+    return true;
+}
+
+/**
+ * @brief computes the base and the offset words of a label again for the
+ * label's new address
+ *
+ * @param words the base word and then the offset word
+ * @param delta the distance between the new and the old address
+ * @return bool true if the words are the relocatable words of a label
+ */
+static bool asm_rebase_relocate(uint32_t *words, int delta)
+{
+    long address;
+
+    if (WORD_ENDING(words[0]) != R || WORD_ENDING(words[1]) != R)
+    {
+        return false;
+    }
+    address = WORD_VALUE(words[0]) + WORD_VALUE(words[1]) + delta;
+    if (address < 0 || address > 0xFFFF)
+    {
+        return false;
+    }
+    words[0] = (uint32_t)R << 16 | (address - address % 16);
+    words[1] = (uint32_t)R << 16 | (address % 16);
+    return true;
+}
+
+/**
+ * @brief computes an expression word that moves with the labels again for
+ * their new address
+ *
+ * @param word the word
+ * @param delta the distance between the new and the old address
+ * @return bool true if the word is an absolute (expression) word
+ */
+static bool asm_rebase_relocate_expression(uint32_t *word, int delta)
+{
+    if (WORD_ENDING(*word) != A)
+    {
+        return false;
+    }
+    *word = (uint32_t)A << 16 | ((WORD_VALUE(*word) + delta) & 0xFFFF);
+    return true;
+}
+
+/**
+ * @brief reads the expression words of the .rel file and moves them. A
+ * file that lists only labels (written before the expressions were
+ * relocated) has none
+ *
+ * @param rel_file the relocation file, after the labels
+ * @param words the words of the object file
+ * @param icf the number of code words
+ * @param dcf the number of data words
+ * @param delta the distance between the new and the old address
+ * @return bool true if the expressions were valid
+ */
+static bool asm_rebase_relocate_expressions(FILE *rel_file, uint32_t *words, int icf, int dcf, int delta)
+{
+    char segment[5];
+    int expressions;
+    int location;
+    bool is_data;
+    bool is_valid = true;
+
+    if (fscanf(rel_file, "%d", &expressions) != 1)
+    {
+        return feof(rel_file);
+    }
+    while (is_valid && expressions-- > 0)
+    {
+        is_valid = fscanf(rel_file, "%4s %d", segment, &location) == 2
+            && (strcmp(segment, "CODE") == 0 || strcmp(segment, "DATA") == 0);
+        is_data = is_valid && segment[0] == 'D';
+        is_valid = is_valid && location >= 0 && location < (is_data ? dcf : icf)
+            && asm_rebase_relocate_expression(&(words[is_data ? icf + location : location]), delta);
+    }
+    return is_valid;
+}
+
+/**
+ * @brief reads the labels of an .ent or an .ext file (a missing file has
+ * no labels)
+ *
+ * @param path the file path
+ * @param is_extern is it an .ext file
+ * @param labels returns the labels
+ * @return bool true if the file is valid
+ */
+static bool asm_rebase_read_labels(char *path, bool is_extern, rebase_labels_t *labels)
+{
+    FILE *file;
+    rebase_label_t label;
+    int base;
+    int offset;
+    int capacity = 0;
+    int scanned;
+
+    labels->labels = NULL;
+    labels->count = 0;
+    labels->is_found = (file = asm_io_open(path, "r")) != NULL;
+    if (!file)
+    {
+        return true;
+    }
+
+    while ((scanned = is_extern ? fscanf(file, "%31s BASE %d %*s OFFSET %d", label.symbol, &base, &offset)
+                                : fscanf(file, " %31[^,\n],%d,%d", label.symbol, &base, &offset)) == 3)
+    {
+        if (labels->count == capacity)
+        {
+            capacity = capacity ? capacity << 1 : 64;
+            labels->labels = asm_alloc_realloc(ALLOC_OUTPUT, labels->labels, capacity * sizeof(rebase_label_t));
+            assert("Memory allocation failed" && labels->labels != NULL);
+        }
+        label.address = base + offset;
+        labels->labels[labels->count++] = label;
+    }
+    asm_io_close(file);
+    return scanned == EOF;
+}
+
+/**
+ * @brief writes the labels of an .ent or an .ext file at their new
+ * addresses (a file that didn't exist isn't written)
+ *
+ * @param path the file path
+ * @param is_extern is it an .ext file
+ * @param labels the labels
+ * @param delta the distance between the new and the old address
+ */
+static void asm_rebase_write_labels(char *path, bool is_extern, rebase_labels_t *labels, int delta)
+{
+    FILE *file;
+    int address;
+    int i;
+
+    if (!labels->is_found)
+    {
+        return;
+    }
+    file = asm_io_open(path, "w");
+    for (i = 0; i < labels->count; i++)
+    {
+        address = labels->labels[i].address + delta;
+        if (is_extern)
+        {
+            fprintf(file, "%s BASE %d\n", labels->labels[i].symbol, address - address % 16);
+            fprintf(file, "%s OFFSET %d\n\n", labels->labels[i].symbol, address % 16);
+        }
+        else
+        {
+            fprintf(file, "%s,%d,%d\n", labels->labels[i].symbol, address - address % 16, address % 16);
+        }
+    }
+    asm_io_close(file);
+}
+
+bool asm_rebase_file(char *file, int start, char **error)
+{
+    uint32_t *words;
+    char *path;
+    FILE *ob_file;
+    FILE *rel_file;
+    int count;
+    int icf;
+    int dcf;
+    int first_line;
+    int relocations;
+    int location;
+    rebase_labels_t entries;
+    rebase_labels_t externs;
+    bool is_valid;
+    bool is_valid_labels;
+
+    path = asm_alloc_malloc(ALLOC_OUTPUT, strlen(file) + 5);
+    words = asm_alloc_malloc(ALLOC_OUTPUT, REBASE_MAX_WORDS * sizeof(uint32_t));
+    assert("Memory allocation failed" && path != NULL && words != NULL);
+
+    sprintf(path, "%s.ob", file);
+    if (!(ob_file = asm_io_open(path, "r")))
+    {
+        *error = "Couldn't open the .ob file";
+        asm_alloc_free(words);
+        asm_alloc_free(path);
+        return false;
+    }
+    is_valid = asm_rebase_read_ob(ob_file, words, &count, &icf, &dcf, &first_line);
+    asm_io_close(ob_file);
+
+    sprintf(path, "%s.rel", file);
+    if (!is_valid || start < 0 || start + count - 1 > REBASE_MAX_LINE)
+    {
+        *error = is_valid ? "The program doesn't fit at the address" : "Invalid .ob file";
+        asm_alloc_free(words);
+        asm_alloc_free(path);
+        return false;
+    }
+    if (!(rel_file = asm_io_open(path, "r")))
+    {
+        *error = "Couldn't open the .rel file";
+        asm_alloc_free(words);
+        asm_alloc_free(path);
+        return false;
+    }
+
+    /* every label and then every expression that moves with the labels is patched in place while the .rel file is read */
+    is_valid = fscanf(rel_file, "%d", &relocations) == 1;
+    while (is_valid && relocations-- > 0)
+    {
+        is_valid = fscanf(rel_file, "%d", &location) == 1 && location >= 0 && location + 1 < icf
+            && asm_rebase_relocate(&(words[location]), start - first_line);
+    }
+    is_valid = is_valid && asm_rebase_relocate_expressions(rel_file, words, icf, dcf, start - first_line);
+    asm_io_close(rel_file);
+
+    /* the .ent and .ext files hold addresses too, so they are read before anything is written */
+    sprintf(path, "%s.ent", file);
+    is_valid_labels = asm_rebase_read_labels(path, false, &entries);
+    sprintf(path, "%s.ext", file);
+    is_valid_labels = asm_rebase_read_labels(path, true, &externs) && is_valid_labels;
+
+    if (is_valid && is_valid_labels)
+    {
+        sprintf(path, "%s.ob", file);
+        ob_file = asm_io_open(path, "w");
+        fprintf(ob_file, "%4d\t%4d\n", icf, dcf);
+        asm_output_ob_words(ob_file, words, count, start);
+        asm_io_close(ob_file);
+        sprintf(path, "%s.ent", file);
+        asm_rebase_write_labels(path, false, &entries, start - first_line);
+        sprintf(path, "%s.ext", file);
+        asm_rebase_write_labels(path, true, &externs, start - first_line);
+    }
+    else
+    {
+        *error = is_valid ? "Invalid .ent or .ext file" : "Invalid .rel file";
+    }
+
+    asm_alloc_free(entries.labels);
+    asm_alloc_free(externs.labels);
+    asm_alloc_free(words);
+    asm_alloc_free(path);
+    return is_valid;
+}
\ No newline at end of file
@@ -0,0 +1,417 @@
+#define _POSIX_C_SOURCE 200809L
+#include "asm_symbols.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SYMBOLS_MAGIC "ASYM"
+#define SYMBOLS_VERSION 1
+#define SYMBOLS_HEADER_WORDS 6   /* the magic, the version, the count, the buckets, the seed and the names size */
+#define SYMBOLS_ENTRY_WORDS 4    /* the name, the value, the attributes and the references */
+#define SYMBOLS_BUCKET_SIZE 4    /* the average number of symbols per bucket */
+#define SYMBOLS_MAX_DISPLACEMENT (1 << 20)
+#define SYMBOLS_DISPLACEMENT_STEP 0x9E3779B9u
+
+/* a symbol that is going to be written */
+typedef struct symbol_entry_t
+{
+    char *name;
+    long value;
+    int attributes;
+    unsigned int references;
+    uint32_t bucket;
+} symbol_entry_t;
+
+struct asm_symbols_t
+{
+    symbol_entry_t *entries;
+    int count;
+    int capacity;
+};
+
+struct asm_symbol_index_t
+{
+    unsigned char *data;  /* the mapped file */
+    size_t size;
+    bool is_mapped;       /* the index unmaps the file (a view doesn't own its memory) */
+    uint32_t count;
+    uint32_t buckets;
+    uint32_t seed;
+    unsigned char *displacements;
+    unsigned char *entries;
+    char *names;
+    uint32_t names_size;
+};
+
+/**
+ * @brief hashes a name with a seed (FNV-1a, then the murmur3 finalizer so
+ * every bit of the seed changes the result)
+ *
+ * @param name the name
+ * @param seed the seed
+ * @return uint32_t the hash
+ */
+static uint32_t asm_symbols_hash(char *name, uint32_t seed)
+{
+    uint32_t value = 2166136261u ^ seed;
+
+    while (*name)
+    {
+        value ^= (unsigned char)*(name++);
+        value *= 16777619u;
+    }
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+
+    return value;
+}
+
+/**
+ * @brief returns the entry of a name
+ *
+ * @param name the name
+ * @param seed the seed of the buckets
+ * @param displacement the displacement of the name's bucket
+ * @param count the number of entries
+ * @return uint32_t the entry
+ */
+static uint32_t asm_symbols_get_slot(char *name, uint32_t seed, uint32_t displacement, uint32_t count)
+{
+    return asm_symbols_hash(name, seed + (displacement + 1) * SYMBOLS_DISPLACEMENT_STEP) % count;
+}
+
+/**
+ * @brief writes a little-endian 32-bit word
+ *
+ * @param sym_file the .sym file
+ * @param word the word
+ */
+static void asm_symbols_write_word(FILE *sym_file, uint32_t word)
+{
+    fputc(word & 0xFF, sym_file);
+    fputc((word >> 8) & 0xFF, sym_file);
+    fputc((word >> 16) & 0xFF, sym_file);
+    fputc((word >> 24) & 0xFF, sym_file);
+}
+
+/**
+ * @brief reads a little-endian 32-bit word
+ *
+ * @param data the word
+ * @return uint32_t the word
+ */
+static uint32_t asm_symbols_read_word(unsigned char *data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+/**
+ * @brief finds a displacement for every bucket, so the symbols of all of
+ * the buckets get different entries. The largest buckets are placed first,
+ * while most of the entries are free
+ *
+ * @param symbols the symbols
+ * @param seed the seed of the buckets
+ * @param buckets the number of buckets
+ * @param displacements returns the displacement of every bucket
+ * @param slots returns the entry of every symbol
+ * @return bool false if a bucket couldn't be placed (another seed is needed)
+ */
+static bool asm_symbols_place(asm_symbols_t *symbols, uint32_t seed, uint32_t buckets, uint32_t *displacements, uint32_t *slots)
+{
+    int *order;          /* the symbols sorted by their bucket */
+    int *starts;         /* the first symbol of every bucket in the order */
+    int *sizes;          /* the buckets sorted by their size */
+    int *positions;
+    bool *is_taken;
+    uint32_t bucket;
+    uint32_t displacement;
+    int symbol;
+    int member;
+    int size;
+    bool is_placed = true;
+
+    order = asm_alloc_malloc(ALLOC_OUTPUT, symbols->count * sizeof(int));
+    starts = asm_alloc_calloc(ALLOC_OUTPUT, buckets + 1, sizeof(int));
+    sizes = asm_alloc_malloc(ALLOC_OUTPUT, buckets * sizeof(int));
+    positions = asm_alloc_calloc(ALLOC_OUTPUT, symbols->count + 2, sizeof(int));
+    is_taken = asm_alloc_calloc(ALLOC_OUTPUT, symbols->count, sizeof(bool));
+    assert("Memory allocation failed" && order != NULL && starts != NULL && sizes != NULL && positions != NULL && is_taken != NULL);
+
+    for (symbol = 0; symbol < symbols->count; symbol++)
+    {
+        symbols->entries[symbol].bucket = asm_symbols_hash(symbols->entries[symbol].name, seed) % buckets;
+        ++starts[symbols->entries[symbol].bucket + 1];
+    }
+    for (bucket = 0; bucket < buckets; bucket++)
+    {
+        starts[bucket + 1] += starts[bucket];
+        sizes[bucket] = starts[bucket];
+    }
+    for (symbol = 0; symbol < symbols->count; symbol++)
+    {
+        order[sizes[symbols->entries[symbol].bucket]++] = symbol;
+    }
+
+    /* the buckets by their size, the largest first (a counting sort over the sizes) */
+    for (bucket = 0; bucket < buckets; bucket++)
+    {
+        ++positions[symbols->count - (starts[bucket + 1] - starts[bucket]) + 1];
+    }
+    for (size = 0; size < symbols->count; size++)
+    {
+        positions[size + 1] += positions[size];
+    }
+    for (bucket = 0; bucket < buckets; bucket++)
+    {
+        sizes[positions[symbols->count - (starts[bucket + 1] - starts[bucket])]++] = bucket;
+    }
+
+    for (member = 0; (uint32_t)member < buckets && is_placed; member++)
+    {
+        bucket = sizes[member];
+        for (displacement = 0; displacement < SYMBOLS_MAX_DISPLACEMENT; displacement++)
+        {
+            for (symbol = starts[bucket]; symbol < starts[bucket + 1]; symbol++)
+            {
+                slots[order[symbol]] = asm_symbols_get_slot(symbols->entries[order[symbol]].name, seed, displacement, symbols->count);
+                if (is_taken[slots[order[symbol]]])
+                {
+                    break;
+                }
+                is_taken[slots[order[symbol]]] = true;
+            }
+            if (symbol == starts[bucket + 1])
+            {
+                break;
+            }
+            /* the symbols of the bucket that were placed are taken back */
+            while (--symbol >= starts[bucket])
+            {
+                is_taken[slots[order[symbol]]] = false;
+            }
+        }
+        displacements[bucket] = displacement;
+        is_placed = displacement < SYMBOLS_MAX_DISPLACEMENT;
+    }
+
+    asm_alloc_free(order);
+    asm_alloc_free(starts);
+    asm_alloc_free(sizes);
+    asm_alloc_free(positions);
+    asm_alloc_free(is_taken);
+    return is_placed;
+}
+
+asm_symbols_t *asm_symbols_create()
+{
+    asm_symbols_t *symbols;
+
+    symbols = asm_alloc_calloc(ALLOC_OUTPUT, 1, sizeof(asm_symbols_t));
+    assert("Memory allocation failed" && symbols != NULL);
+
+    return symbols;
+}
+
+void asm_symbols_add(asm_symbols_t *symbols, char *name, long value, int attributes, unsigned int references)
+{
+    symbol_entry_t *entry;
+
+    if (symbols->count == symbols->capacity)
+    {
+        symbols->capacity = symbols->capacity ? symbols->capacity << 1 : 64;
+        symbols->entries = asm_alloc_realloc(ALLOC_OUTPUT, symbols->entries, symbols->capacity * sizeof(symbol_entry_t));
+        assert("Memory allocation failed" && symbols->entries != NULL);
+    }
+    entry = &(symbols->entries[symbols->count++]);
+    entry->name = asm_alloc_malloc(ALLOC_OUTPUT, strlen(name) + 1);
+    assert("Memory allocation failed" && entry->name != NULL);
+    strcpy(entry->name, name);
+    entry->value = value;
+    entry->attributes = attributes;
+    entry->references = references;
+}
+
+void asm_symbols_write(FILE *sym_file, asm_symbols_t *symbols)
+{
+    uint32_t *displacements;
+    uint32_t *slots;
+    int *entries;         /* the symbol of every entry */
+    uint32_t buckets;
+    uint32_t seed = 0;
+    uint32_t names_size = 0;
+    uint32_t name_offset;
+    int symbol;
+    int entry;
+
+    buckets = (symbols->count + SYMBOLS_BUCKET_SIZE - 1) / SYMBOLS_BUCKET_SIZE;
+    displacements = asm_alloc_malloc(ALLOC_OUTPUT, (buckets + 1) * sizeof(uint32_t));
+    slots = asm_alloc_malloc(ALLOC_OUTPUT, (symbols->count + 1) * sizeof(uint32_t));
+    entries = asm_alloc_malloc(ALLOC_OUTPUT, (symbols->count + 1) * sizeof(int));
+    assert("Memory allocation failed" && displacements != NULL && slots != NULL && entries != NULL);
+
+    while (symbols->count > 0 && !asm_symbols_place(symbols, seed, buckets, displacements, slots))
+    {
+        ++seed;
+    }
+    for (symbol = 0; symbol < symbols->count; symbol++)
+    {
+        entries[slots[symbol]] = symbol;
+        names_size += strlen(symbols->entries[symbol].name) + 1;
+    }
+
+    fputs(SYMBOLS_MAGIC, sym_file);
+    asm_symbols_write_word(sym_file, SYMBOLS_VERSION);
+    asm_symbols_write_word(sym_file, symbols->count);
+    asm_symbols_write_word(sym_file, buckets);
+    asm_symbols_write_word(sym_file, seed);
+    asm_symbols_write_word(sym_file, names_size);
+    for (symbol = 0; (uint32_t)symbol < buckets; symbol++)
+    {
+        asm_symbols_write_word(sym_file, displacements[symbol]);
+    }
+
+    /* the names are written in the order of the entries */
+    name_offset = 0;
+    for (entry = 0; entry < symbols->count; entry++)
+    {
+        symbol = entries[entry];
+        asm_symbols_write_word(sym_file, name_offset);
+        asm_symbols_write_word(sym_file, (uint32_t)symbols->entries[symbol].value);
+        asm_symbols_write_word(sym_file, symbols->entries[symbol].attributes);
+        asm_symbols_write_word(sym_file, symbols->entries[symbol].references);
+        name_offset += strlen(symbols->entries[symbol].name) + 1;
+    }
+    for (entry = 0; entry < symbols->count; entry++)
+    {
+        fputs(symbols->entries[entries[entry]].name, sym_file);
+        fputc('\0', sym_file);
+    }
+
+    asm_alloc_free(displacements);
+    asm_alloc_free(slots);
+    asm_alloc_free(entries);
+}
+
+void asm_symbols_destroy(asm_symbols_t *symbols)
+{
+    int symbol;
+
+    for (symbol = 0; symbol < symbols->count; symbol++)
+    {
+        asm_alloc_free(symbols->entries[symbol].name);
+    }
+    asm_alloc_free(symbols->entries);
+    asm_alloc_free(symbols);
+}
+
+asm_symbol_index_t *asm_symbol_index_open(char *path)
+{
+    asm_symbol_index_t *index;
+    struct stat status;
+    unsigned char *data;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &status) != 0 || status.st_size < SYMBOLS_HEADER_WORDS * 4
+        || (data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+
+    if ((index = asm_symbol_index_view(data, status.st_size)))
+    {
+        index->is_mapped = true;
+    }
+    else
+    {
+        munmap(data, status.st_size);
+    }
+    return index;
+}
+
+asm_symbol_index_t *asm_symbol_index_view(unsigned char *data, size_t size)
+{
+    asm_symbol_index_t *index;
+    size_t expected_size;
+
+    if (size < SYMBOLS_HEADER_WORDS * 4)
+    {
+        return NULL;
+    }
+    index = asm_alloc_calloc(ALLOC_OUTPUT, 1, sizeof(asm_symbol_index_t));
+    assert("Memory allocation failed" && index != NULL);
+    index->data = data;
+    index->size = size;
+
+    index->count = asm_symbols_read_word(index->data + 8);
+    index->buckets = asm_symbols_read_word(index->data + 12);
+    index->seed = asm_symbols_read_word(index->data + 16);
+    index->names_size = asm_symbols_read_word(index->data + 20);
+    index->displacements = index->data + SYMBOLS_HEADER_WORDS * 4;
+    index->entries = index->displacements + (size_t)index->buckets * 4;
+    index->names = (char *)index->entries + (size_t)index->count * SYMBOLS_ENTRY_WORDS * 4;
+
+    /* the sizes are checked before anything is read through them */
+    expected_size = SYMBOLS_HEADER_WORDS * 4 + ((size_t)index->buckets + (size_t)index->count * SYMBOLS_ENTRY_WORDS) * 4 + index->names_size;
+    if (memcmp(index->data, SYMBOLS_MAGIC, strlen(SYMBOLS_MAGIC)) != 0 || asm_symbols_read_word(index->data + 4) != SYMBOLS_VERSION
+        || index->buckets > index->count || (index->count > 0 && index->buckets == 0)
+        || index->count > index->size || index->names_size > index->size || expected_size != index->size
+        || (index->names_size > 0 && index->names[index->names_size - 1] != '\0'))
+    {
+        asm_symbol_index_close(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+int asm_symbol_index_get_count(asm_symbol_index_t *index)
+{
+    return index->count;
+}
+
+void asm_symbol_index_get(asm_symbol_index_t *index, int position, asm_symbol_t *symbol)
+{
+    unsigned char *entry = index->entries + (size_t)position * SYMBOLS_ENTRY_WORDS * 4;
+    uint32_t name = asm_symbols_read_word(entry);
+
+    /* the entries are checked only when they are read, so opening a file doesn't read all of it */
+    symbol->name = name < index->names_size ? index->names + name : "";
+    symbol->value = (int32_t)asm_symbols_read_word(entry + 4);
+    symbol->attributes = asm_symbols_read_word(entry + 8);
+    symbol->references = asm_symbols_read_word(entry + 12);
+}
+
+bool asm_symbol_index_find(asm_symbol_index_t *index, char *name, asm_symbol_t *symbol)
+{
+    uint32_t displacement;
+
+    if (index->count == 0)
+    {
+        return false;
+    }
+    /* a name that isn't in the file still gets an entry, so the names are compared */
+    displacement = asm_symbols_read_word(index->displacements + (asm_symbols_hash(name, index->seed) % index->buckets) * 4);
+    asm_symbol_index_get(index, asm_symbols_get_slot(name, index->seed, displacement, index->count), symbol);
+
+    return strcmp(symbol->name, name) == 0;
+}
+
+void asm_symbol_index_close(asm_symbol_index_t *index)
+{
+    if (index->is_mapped)
+    {
+        munmap(index->data, index->size);
+    }
+    asm_alloc_free(index);
+}
\ No newline at end of file
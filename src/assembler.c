@@ -15,14 +15,46 @@
         ;                      \
     --line;
 
-#define SKIP_EMPTY_AND_COMMENT(line)   \
-    SKIP_SPACES(line)                  \
-    if (*line == '\0' || *line == ';') \
-    {                                  \
-        errors_increase_lines();       \
-        continue;                      \
+#define STREAM_SECTION(output, name) \
+    fputs("=== " name " ===\n", output);
+
+#define CHUNK_MIN_LINES 256
+
+typedef struct chunk_t
+{
+    char (*lines)[LINE_LENGTH];   /* the lines of the chunk */
+    int lines_count;
+    memory_t *memory;             /* the chunk's own code and data */
+    labels_table_t *labels_table; /* journals the chunk's labels */
+    unsigned int errors_count;
+    bool is_position_dependent;   /* the chunk has a line that depends on its pc */
+} chunk_t;
+
+typedef struct output_names_t
+{
+    char *file_name;              /* the file name with any suffix */
+    int len;                      /* the length of the name including the extention */
+    labels_table_t *labels_table; /* the tables are per thread, so the task is given the file's */
+} output_names_t;
+
+void assembler_analyze_line(char *line, labels_table_t *labels_table)
+{
+    memory_t *memory = asm_memory_get_instance();
+    bool was_full = asm_memory_is_full(memory);
+
+    SKIP_SPACES(line)
+    if (*line != '\0' && *line != ';')
+    {
+        labels_table_add_if_definition(&line, labels_table); /* adds the label and advances the line pointer to after the label */
+        asm_line_analyze(line);
     }
-        
+    /* the words are checked once per line instead of once per word, the line that filled the memory is reported */
+    if (!was_full && asm_memory_is_full(memory))
+    {
+        errors_print_line(OVERFLOW);
+    }
+    errors_increase_lines();
+}
 
 /**
  * @brief writes the entire known machine code and data to the memory
@@ -34,47 +66,330 @@
 static void assembler_am_iteration(FILE *am_file, labels_table_t *labels_table)
 {
     char line[LINE_LENGTH];
-    char *line_ptr;
 
     while (fgets(line, LINE_LENGTH, am_file))
     {
-        line_ptr = line;
-        SKIP_EMPTY_AND_COMMENT(line_ptr)
+        assembler_analyze_line(line, labels_table);
+    }
+    labels_table_check_labels_validity_proxy(labels_table);
+}
+
+/**
+ * @brief reads all of the lines of the am file
+ * 
+ * @param am_file an assembly file with its macros opened
+ * @param lines returns the allocated lines
+ * @return int the number of lines
+ */
+static int assembler_read_lines(FILE *am_file, char (**lines)[LINE_LENGTH])
+{
+    int lines_count = 0;
+    int capacity = CHUNK_MIN_LINES;
+
+    *lines = asm_alloc_malloc(ALLOC_PASSES, capacity * sizeof(**lines));
+    assert("Memory allocation failed" && *lines != NULL);
+    while (fgets((*lines)[lines_count], LINE_LENGTH, am_file))
+    {
+        if (++lines_count == capacity)
+        {
+            capacity <<= 1;
+            *lines = asm_alloc_realloc(ALLOC_PASSES, *lines, capacity * sizeof(**lines));
+            assert("Memory allocation failed" && *lines != NULL);
+        }
+    }
+    return lines_count;
+}
+
+/**
+ * @brief analyzes the lines of a chunk into a memory and a journaling
+ * labels table of its own, as if the chunk was the start of the file.
+ * Runs as a pipeline task
+ * 
+ * @param chunk the chunk
+ */
+static void assembler_analyze_chunk(void *chunk)
+{
+    chunk_t *current = chunk;
+    memory_t *previous_memory;
+    labels_table_t *previous_table;
+    int line;
+
+    previous_memory = asm_memory_set_instance(NULL);
+    previous_table = labels_table_set_instance(NULL);
+    current->memory = asm_memory_get_instance();
+    current->labels_table = labels_table_get_instance();
+    labels_table_start_journal(current->labels_table);
+    errors_reset();
+    errors_set_muted(true);
+
+    for (line = 0; line < current->lines_count; line++)
+    {
+        assembler_analyze_line(current->lines[line], current->labels_table);
+    }
+
+    current->errors_count = errors_get_count();
+    current->is_position_dependent = labels_table_is_position_dependent(current->labels_table);
+    errors_set_muted(false);
+    errors_reset();
+    asm_memory_set_instance(previous_memory);
+    labels_table_set_instance(previous_table);
+}
+
+/**
+ * @brief the same as assembler_am_iteration, but the lines are split into
+ * chunks that are analyzed in parallel. The chunks' words are then appended
+ * in order and their labels journals are replayed with the ic/pc at which
+ * each chunk starts (a prefix sum), so the result is identical to the
+ * sequential iteration. When any chunk has errors (or a line that depends
+ * on its pc), the file is analyzed again sequentially so the errors are
+ * reported exactly the same way
+ * 
+ * @param am_file an assembly file with its macros opened
+ * @param labels_table labels_table
+ * @param chunks_count the maximal number of chunks
+ */
+static void assembler_chunked_am_iteration(FILE *am_file, labels_table_t *labels_table, int chunks_count)
+{
+    char (*lines)[LINE_LENGTH];
+    int lines_count;
+    int lines_per_chunk;
+    int chunk;
+    chunk_t *chunks;
+    asm_pipeline_task_t **tasks;
+    memory_t *memory;
+    bool is_valid = true;
+
+    lines_count = assembler_read_lines(am_file, &lines);
+    if (chunks_count > lines_count / CHUNK_MIN_LINES)
+    {
+        chunks_count = lines_count / CHUNK_MIN_LINES;
+    }
+    if (chunks_count < 2)
+    {
+        asm_alloc_free(lines);
+        fseek(am_file, 0, SEEK_SET);
+        assembler_am_iteration(am_file, labels_table);
+        return;
+    }
+
+    chunks = asm_alloc_malloc(ALLOC_PASSES, chunks_count * sizeof(chunk_t));
+    tasks = asm_alloc_malloc(ALLOC_PASSES, chunks_count * sizeof(asm_pipeline_task_t*));
+    assert("Memory allocation failed" && chunks != NULL && tasks != NULL);
+
+    lines_per_chunk = (lines_count + chunks_count - 1) / chunks_count;
+    for (chunk = 0; chunk < chunks_count; chunk++)
+    {
+        chunks[chunk].lines = lines + chunk * lines_per_chunk;
+        chunks[chunk].lines_count = (chunk == chunks_count - 1) ? lines_count - chunk * lines_per_chunk : lines_per_chunk;
+        tasks[chunk] = asm_pipeline_start_task(assembler_analyze_chunk, &chunks[chunk]);
+    }
+
+    for (chunk = 0; chunk < chunks_count; chunk++)
+    {
+        asm_pipeline_join_task(tasks[chunk]);
+        is_valid = is_valid && chunks[chunk].errors_count == 0 && !chunks[chunk].is_position_dependent;
+    }
+
+    memory = asm_memory_get_instance();
+    if (is_valid)
+    {
+        /* errors that only show up when the labels are merged are reported by the sequential iteration */
+        errors_set_muted(true);
+        for (chunk = 0; chunk < chunks_count; chunk++)
+        {
+            labels_table_replay_journal(labels_table, chunks[chunk].labels_table, asm_memory_get_ic(memory), asm_memory_get_pc(memory));
+            asm_memory_append(memory, chunks[chunk].memory);
+        }
+        is_valid = errors_get_count() == 0 && !asm_memory_is_full(memory);
+        errors_set_muted(false);
+    }
+
+    for (chunk = 0; chunk < chunks_count; chunk++)
+    {
+        asm_memory_destroy(chunks[chunk].memory);
+        labels_table_destroy(chunks[chunk].labels_table);
+    }
+    asm_alloc_free(tasks);
+    asm_alloc_free(chunks);
+    asm_alloc_free(lines);
+
+    if (is_valid)
+    {
+        while (lines_count--)
+        {
+            errors_increase_lines();
+        }
+        labels_table_check_labels_validity_proxy(labels_table);
+    }
+    else
+    {
+        asm_memory_reset(memory);
+        labels_table_reset(labels_table);
+        errors_reset();
+        fseek(am_file, 0, SEEK_SET);
+        assembler_am_iteration(am_file, labels_table);
+    }
+}
 
-        labels_table_add_if_definition(&line_ptr, labels_table); /* adds the label and advances the line pointer to after the label */
-        asm_line_analyze(line_ptr);
-        errors_increase_lines();
+/**
+ * @brief analyzes the lines and records the ic/dc before every line
+ * 
+ * @param lines the lines of the am file
+ * @param lines_count the number of lines
+ * @param line_pc returns the ic and the dc before every line (and after the last line)
+ * @param labels_table labels_table
+ */
+static void assembler_analyze_lines(char (*lines)[LINE_LENGTH], int lines_count, uint16_t (*line_pc)[2], labels_table_t *labels_table)
+{
+    char line[LINE_LENGTH];
+    memory_t *memory = asm_memory_get_instance();
+    int current;
+
+    for (current = 0; current < lines_count; current++)
+    {
+        line_pc[current][0] = asm_memory_get_ic(memory);
+        line_pc[current][1] = asm_memory_get_dc(memory);
+        strcpy(line, lines[current]); /* the line is modified while it is analyzed */
+        assembler_analyze_line(line, labels_table);
     }
+    line_pc[lines_count][0] = asm_memory_get_ic(memory);
+    line_pc[lines_count][1] = asm_memory_get_dc(memory);
     labels_table_check_labels_validity_proxy(labels_table);
 }
 
+/**
+ * @brief removes the redundant instructions (see asm_peephole.h) of lines
+ * that were analyzed. Their labels are inserted so the instructions can be
+ * decoded, and then the lines are analyzed again from scratch, so the
+ * labels, the expressions and the externs get their addresses without the
+ * removed words
+ * 
+ * @param lines the lines of the am file
+ * @param lines_count the number of lines
+ * @param line_pc the ic and the dc before every line (updated)
+ * @param labels_table labels_table
+ */
+static void assembler_optimize_lines(char (*lines)[LINE_LENGTH], int lines_count, uint16_t (*line_pc)[2], labels_table_t *labels_table)
+{
+    memory_t *memory = asm_memory_get_instance();
+
+    if (errors_get_count() == 0)
+    {
+        labels_table_insert_labels_to_memory_proxy(labels_table, memory);
+        asm_peephole_optimize(lines, lines_count, line_pc, memory);
+
+        /* the labels are inserted (and the externs are referenced) again when the .ob file is written */
+        asm_memory_reset(memory);
+        labels_table_reset(labels_table);
+        errors_reset();
+        directive_restart_string_pool();
+        assembler_analyze_lines(lines, lines_count, line_pc, labels_table);
+    }
+}
+
+/**
+ * @brief writes the .map file, the source line of every range of words of
+ * the .ob file (see asm_map.h). The am lines get their source lines from
+ * the macro stage
+ * 
+ * @param file_name the file name with any suffix
+ * @param len the length of the name including the extention
+ * @param line_pc the ic and the dc before every line of the am file
+ * @param lines_count the number of lines
+ * @param memory the memory of the file
+ */
+static void assembler_write_map(char *file_name, int len, uint16_t (*line_pc)[2], int lines_count, memory_t *memory)
+{
+    FILE *map_file;
+    asm_map_t *map;
+    char *source;
+    unsigned int source_line;
+    line_origin_e origin;
+    char *origin_file;
+    unsigned int origin_line;
+    int line;
+    int icf = asm_memory_get_ic(memory);
+
+    source = asm_alloc_malloc(ALLOC_PASSES, (len + 1) * sizeof(char));
+    assert("Memory allocation failed" && source != NULL);
+    memcpy(source, file_name, len + 1);
+    CHANGE_SUFFIX(source, len, "as")
+    map = asm_map_create(source);
+    asm_alloc_free(source);
+
+    /* the code words come first in the .ob file and then the data words */
+    for (line = 0; line < lines_count; line++)
+    {
+        if (line_pc[line + 1][0] > line_pc[line][0]
+            && macro_includes_get_origin(macro_includes_get_instance(), line, &source_line, &origin, &origin_file, &origin_line))
+        {
+            asm_map_add(map, START_IC_VALUE + line_pc[line][0], source_line, origin, origin_file, origin_line);
+        }
+    }
+    for (line = 0; line < lines_count; line++)
+    {
+        if (line_pc[line + 1][1] > line_pc[line][1]
+            && macro_includes_get_origin(macro_includes_get_instance(), line, &source_line, &origin, &origin_file, &origin_line))
+        {
+            asm_map_add(map, START_IC_VALUE + icf + line_pc[line][1], source_line, origin, origin_file, origin_line);
+        }
+    }
+
+    CHANGE_SUFFIX(file_name, len, "map")
+    map_file = asm_io_open(file_name, "w");
+    asm_map_write(map_file, map, START_IC_VALUE + icf + asm_memory_get_dc(memory));
+    asm_io_close(map_file);
+    asm_map_destroy(map);
+}
+
+/**
+ * @brief analyzes a line as soon as the macro stage opened it (used when
+ * there is no am file to iterate over)
+ * 
+ * @param line the line with its macros opened
+ * @param labels_table labels_table
+ */
+static void assembler_on_expanded_line(char *line, void *labels_table)
+{
+    char line_copy[LINE_LENGTH];
+
+    strcpy(line_copy, line); /* macro lines are kept in the macros table */
+    assembler_analyze_line(line_copy, labels_table);
+}
+
 /**
  * @brief handles the opening of the .ent and .ext files and writes
  * the labels in the proper format according to the file type
  * 
  * @param file_name the file name
  * @param len the length of the name including the extention
+ * @param table labels_table
  */
-static void assembler_write_entry_and_extern_files(char *file_name, int len)
+static void assembler_write_entry_and_extern_files(char *file_name, int len, labels_table_t *table)
 {
-    labels_table_t *table = labels_table_get_instance();
-    FILE *entry_file;
-    FILE *extern_file;
+    FILE *entry_file = NULL;
+    FILE *extern_file = NULL;
 
     /* Entries file */
     CHANGE_SUFFIX(file_name, len, "ent")
-    remove(file_name);
     if (labels_table_get_entry_count(table))
     {
-        entry_file = fopen(file_name, "w");
+        entry_file = asm_io_open(file_name, "w");
+    }
+    else
+    {
+        asm_io_remove(file_name);
     }
 
     /* Externals file */
     CHANGE_SUFFIX(file_name, len, "ext")
-    remove(file_name);
     if (labels_table_get_extern_count(table))
     {
-        extern_file = fopen(file_name, "w");
+        extern_file = asm_io_open(file_name, "w");
+    }
+    else
+    {
+        asm_io_remove(file_name);
     }
 
     if (entry_file || extern_file)
@@ -82,72 +397,421 @@ static void assembler_write_entry_and_extern_files(char *file_name, int len)
         labels_table_write_ext_and_ent_proxy(table, extern_file, entry_file);
         if (entry_file)
         {
-            fclose(entry_file);
+            asm_io_close(entry_file);
         }
         if (extern_file)
         {
-            fclose(extern_file);
+            asm_io_close(extern_file);
         }
     }
 }
 
+/**
+ * @brief writes the .ent and .ext files on a pipeline task
+ * 
+ * @param output_names the output names (a private copy of the file name)
+ */
+static void assembler_write_entry_and_extern_task(void *output_names)
+{
+    output_names_t *names = output_names;
+
+    assembler_write_entry_and_extern_files(names->file_name, names->len, names->labels_table);
+}
+
+/**
+ * @brief checks if the macro stage and the first pass of a file run on
+ * separate threads (-p). -O, --pool-strings and --map need all of the lines
+ * before the first pass, so with them -p is reported once and ignored
+ * (the .ent and .ext files are still written while the .ob is formatted)
+ *
+ * @return bool true if the macro stage runs on its own thread
+ */
+static bool assembler_is_pipelined()
+{
+    static bool is_reported;
+    options_t *options = options_get_instance();
+
+    if (options->pipeline && (options->optimize || options->pool_strings || options->map))
+    {
+        if (!is_reported)
+        {
+            fprintf(stderr, "-p is ignored with -O, --pool-strings and --map\n");
+            is_reported = true;
+        }
+        return false;
+    }
+    return options->pipeline;
+}
+
+/**
+ * @brief gives the macros of the prelude (if there is one) to the sources
+ * the thread expands
+ */
+static void assembler_load_prelude()
+{
+    char *prelude = options_get_instance()->prelude;
+
+    if (!macro_includes_set_prelude(macro_includes_get_instance(), prelude))
+    {
+        fprintf(stderr, "Couldn't read the prelude %s\n", prelude);
+    }
+}
+
+/**
+ * @brief writes the .d file, a make rule that makes the .ob file depend on
+ * the source and on the files it included
+ * 
+ * @param file_name the file name with any suffix
+ * @param len the length of the name including the extention
+ */
+static void assembler_write_dependencies(char *file_name, int len)
+{
+    FILE *d_file;
+    char *target;
+    char *source;
+
+    target = asm_alloc_malloc(ALLOC_PASSES, 2 * (len + 1) * sizeof(char));
+    assert("Memory allocation failed" && target != NULL);
+    source = target + len + 1;
+    memcpy(target, file_name, len + 1);
+    memcpy(source, file_name, len + 1);
+    CHANGE_SUFFIX(target, len, "ob")
+    CHANGE_SUFFIX(source, len, "as")
+
+    CHANGE_SUFFIX(file_name, len, "d\0")
+    d_file = asm_io_open(file_name, "w");
+    macro_includes_write_dependencies(macro_includes_get_instance(), d_file, target, source);
+    asm_io_close(d_file);
+
+    asm_alloc_free(target);
+}
+
 void assembler_on_file(char *file)
+{
+    assembler_on_file_incremental(file, NULL);
+}
+
+void assembler_on_file_incremental(char *file, asm_incremental_t *incremental)
 {
     FILE *as_file;
     FILE *am_file;
-    FILE *ob_file;
+    FILE *ob_file = NULL;
+    FILE *rel_file;
+    FILE *sym_file;
     FILE *err_file;
     char *file_name;
+    char (*lines)[LINE_LENGTH];
+    uint16_t (*line_pc)[2] = NULL;
+    int lines_count = 0;
     int len;
     memory_t *memory;
     labels_table_t *labels_table;
+    output_names_t output_names;
+    asm_pipeline_task_t *entry_and_extern_task = NULL;
+    asm_symbols_t *symbols;
+    bool is_analyzed;
+    bool is_valid;
 
+    errors_reset();
     len = strlen(file) + 4;
-    file_name = malloc(len * sizeof(char));
+    file_name = asm_alloc_malloc(ALLOC_PASSES, (len + 1) * sizeof(char)); /* the longest suffix (ent/ext/err) ends at len */
     assert("Memory allocation failed" && file_name != NULL);
+    file_name[len] = '\0';
 
     /* Assembly file */
     SET_ASSEMBLY_FILE(file_name, file, len)
-    as_file = fopen(file_name, "r");
-    assert("File doesn't exist" && as_file);
-
-    /* After macro file */
-    CHANGE_SUFFIX(file_name, len, "am")
-    am_file = fopen(file_name, "w+");
-    macro_write_am_file(as_file, am_file);
-    fclose(as_file);
-
-    /* Error file */
-    CHANGE_SUFFIX(file_name, len, "err")
-    err_file = fopen(file_name, "w");
-    /* errors_set_output(err_file); */
-    /* fprintf(err_file, "%s", "hello"); */
+    as_file = asm_io_open(file_name, "r");
+    if (as_file)
+    {
+        /* After macro file */
+        CHANGE_SUFFIX(file_name, len, "am")
+        if (!(am_file = fopen(file_name, "w+")))
+        {
+            asm_io_close(as_file);
+            as_file = NULL;
+        }
+    }
+    if (!as_file)
+    {
+        /* the file is skipped and the next files are assembled as usual */
+        errors_print_symbol(INVALID_FILE_PATH, file_name);
+        asm_alloc_free(file_name);
+        return;
+    }
+    macro_includes_set_source(macro_includes_get_instance(), file_name);
+    assembler_load_prelude();
 
     memory = asm_memory_get_instance();
     labels_table = labels_table_get_instance();
-    fseek(am_file, SEEK_SET, 0);
-    assembler_am_iteration(am_file, labels_table);
-    fclose(am_file);
+
+    if (incremental)
+    {
+        /* the am file is written while the lines are compared with the previous run */
+        is_analyzed = asm_incremental_first_pass(incremental, as_file, am_file, labels_table, memory);
+        asm_io_close(as_file);
+
+        /* Error file */
+        CHANGE_SUFFIX(file_name, len, "err")
+        err_file = asm_io_open(file_name, "w");
+
+        if (!is_analyzed)
+        {
+            /* the errors are reported the same way as in a full run */
+            fseek(am_file, 0, SEEK_SET);
+            assembler_am_iteration(am_file, labels_table);
+        }
+        fclose(am_file);
+    }
+    else if (assembler_is_pipelined())
+    {
+        /* Error file */
+        CHANGE_SUFFIX(file_name, len, "err")
+        err_file = asm_io_open(file_name, "w");
+
+        /* the am file is written by the macro stage thread */
+        asm_pipeline_expand(as_file, am_file, assembler_on_expanded_line, labels_table);
+        labels_table_check_labels_validity_proxy(labels_table);
+        asm_io_close(as_file);
+        fclose(am_file);
+    }
+    else
+    {
+        macro_write_am_file(as_file, am_file);
+        asm_io_close(as_file);
+
+        /* Error file */
+        CHANGE_SUFFIX(file_name, len, "err")
+        err_file = asm_io_open(file_name, "w");
+
+        fseek(am_file, SEEK_SET, 0);
+        if (options_get_instance()->pool_strings)
+        {
+            directive_start_string_pool(am_file);
+        }
+        if (options_get_instance()->optimize || options_get_instance()->map)
+        {
+            /* the lines are kept with their ic and dc to be optimized or mapped */
+            lines_count = assembler_read_lines(am_file, &lines);
+            line_pc = asm_alloc_malloc(ALLOC_PASSES, (lines_count + 1) * sizeof(*line_pc));
+            assert("Memory allocation failed" && line_pc != NULL);
+            assembler_analyze_lines(lines, lines_count, line_pc, labels_table);
+            if (options_get_instance()->optimize)
+            {
+                assembler_optimize_lines(lines, lines_count, line_pc, labels_table);
+            }
+            asm_alloc_free(lines);
+        }
+        else if (options_get_instance()->chunks > 1 && !options_get_instance()->pool_strings)
+        {
+            assembler_chunked_am_iteration(am_file, labels_table, options_get_instance()->chunks);
+        }
+        else
+        {
+            assembler_am_iteration(am_file, labels_table);
+        }
+        directive_end_string_pool();
+        fclose(am_file);
+    }
+
+    if (!err_file)
+    {
+        errors_print_symbol(INVALID_FILE_PATH, file_name);
+    }
 
     /* Object file */
     CHANGE_SUFFIX(file_name, len, "ob")
-    remove(file_name);
 
-    if (ftell(err_file) == 0)
+    /* the words that didn't fit were dropped, so a full memory is never written */
+    is_valid = errors_get_count() == 0 && !asm_memory_is_full(memory);
+    if (is_valid)
     {
-        ob_file = fopen(file_name, "w");
+        /* the labels are inserted before anything is written, since an undefined label is an error too */
         labels_table_insert_labels_to_memory_proxy(labels_table, memory);
-        assembler_write_entry_and_extern_files(file_name, len);
+        if (options_get_instance()->relocations)
+        {
+            labels_table_check_relocations(labels_table);
+        }
+        is_valid = errors_get_count() == 0;
+    }
+    if (is_valid)
+    {
+        ob_file = (incremental || options_get_instance()->ob_threads > 1) ? NULL : asm_io_open(file_name, "w");
+        if (options_get_instance()->pipeline && !incremental)
+        {
+            /* the .ent and .ext files are written while the .ob file is formatted. The
+               .ob itself can't be formatted during the first pass: its header holds the
+               final counts and the words of the labels are only known after the pass */
+            output_names.len = len;
+            output_names.labels_table = labels_table;
+            output_names.file_name = asm_alloc_malloc(ALLOC_PASSES, (len + 1) * sizeof(char));
+            assert("Memory allocation failed" && output_names.file_name != NULL);
+            memcpy(output_names.file_name, file_name, len + 1);
+            entry_and_extern_task = asm_pipeline_start_task(assembler_write_entry_and_extern_task, &output_names);
+        }
+        else
+        {
+            assembler_write_entry_and_extern_files(file_name, len, labels_table);
+        }
+
+        if (incremental)
+        {
+            CHANGE_SUFFIX(file_name, len, "ob")
+            asm_incremental_write_ob(incremental, file_name, memory);
+        }
+        else if (options_get_instance()->ob_threads > 1)
+        {
+            CHANGE_SUFFIX(file_name, len, "ob")
+            if (!asm_output_ob_file_parallel(file_name, memory, options_get_instance()->ob_threads))
+            {
+                errors_print_symbol(INVALID_OUTPUT, file_name);
+            }
+        }
+        else
+        {
+            asm_output_ob_file(ob_file, memory);
+        }
+
+        if (options_get_instance()->pipeline && !incremental)
+        {
+            asm_pipeline_join_task(entry_and_extern_task);
+            asm_alloc_free(output_names.file_name);
+        }
+        if (ob_file)
+        {
+            asm_io_close(ob_file);
+        }
+
+        /* Relocation file */
+        if (options_get_instance()->relocations)
+        {
+            CHANGE_SUFFIX(file_name, len, "rel")
+            rel_file = asm_io_open(file_name, "w");
+            asm_output_rel_file(rel_file, memory);
+            labels_table_write_relocations(labels_table, rel_file);
+            asm_io_close(rel_file);
+        }
+
+        /* Map file */
+        if (line_pc && options_get_instance()->map)
+        {
+            assembler_write_map(file_name, len, line_pc, lines_count, memory);
+        }
+
+        /* Symbol file */
+        if (options_get_instance()->symbols)
+        {
+            CHANGE_SUFFIX(file_name, len, "sym")
+            sym_file = asm_io_open(file_name, "w");
+            symbols = asm_symbols_create();
+            labels_table_export_symbols(labels_table, symbols);
+            asm_symbols_write(sym_file, symbols);
+            asm_symbols_destroy(symbols);
+            asm_io_close(sym_file);
+        }
 
         CHANGE_SUFFIX(file_name, len, "err")
-        remove(file_name);
+        asm_io_discard(err_file, file_name);
+    }
+    else
+    {
+        asm_io_remove(file_name);
+        CHANGE_SUFFIX(file_name, len, "ent")
+        asm_io_remove(file_name);
+        CHANGE_SUFFIX(file_name, len, "ext")
+        asm_io_remove(file_name);
+        if (options_get_instance()->relocations)
+        {
+            CHANGE_SUFFIX(file_name, len, "rel")
+            asm_io_remove(file_name);
+        }
+        if (options_get_instance()->map)
+        {
+            CHANGE_SUFFIX(file_name, len, "map")
+            asm_io_remove(file_name);
+        }
+        if (options_get_instance()->symbols)
+        {
+            CHANGE_SUFFIX(file_name, len, "sym")
+            asm_io_remove(file_name);
+        }
+        if (options_get_instance()->dependencies)
+        {
+            CHANGE_SUFFIX(file_name, len, "d\0")
+            asm_io_remove(file_name);
+        }
+        if (err_file)
+        {
+            asm_io_close(err_file);
+        }
+    }
 
-        asm_output_ob_file(ob_file, memory);
+    /* Dependency file */
+    if (is_valid && options_get_instance()->dependencies)
+    {
+        assembler_write_dependencies(file_name, len);
     }
+    macro_includes_set_source(macro_includes_get_instance(), NULL);
 
-    free(file_name);
-    fclose(ob_file);
-    fclose(err_file);
-    asm_memory_destroy(memory);
-    labels_table_destroy(labels_table);
+    asm_alloc_free(line_pc);
+    asm_alloc_free(file_name);
+    asm_memory_reset(memory);
+    labels_table_reset(labels_table);
+}
+
+void assembler_prefetch(char *file)
+{
+    char *file_name;
+    int len;
+
+    len = strlen(file) + 4;
+    file_name = asm_alloc_malloc(ALLOC_PASSES, (len + 1) * sizeof(char));
+    assert("Memory allocation failed" && file_name != NULL);
+    file_name[len] = '\0';
+
+    SET_ASSEMBLY_FILE(file_name, file, len)
+    asm_io_prefetch(file_name);
+    asm_alloc_free(file_name);
+}
+
+void assembler_on_stream(FILE *input, FILE *output)
+{
+    memory_t *memory;
+    labels_table_t *labels_table;
+
+    memory = asm_memory_get_instance();
+    labels_table = labels_table_get_instance();
+    errors_reset();
+    errors_set_output(output);
+
+    /* diagnostics come first so they can be streamed while the input arrives */
+    STREAM_SECTION(output, "err")
+    assembler_load_prelude();
+    macro_expand(input, assembler_on_expanded_line, labels_table);
+    labels_table_check_labels_validity_proxy(labels_table);
+
+    if (errors_get_count() == 0)
+    {
+        labels_table_insert_labels_to_memory_proxy(labels_table, memory);
+
+        STREAM_SECTION(output, "ob")
+        asm_output_ob_file(output, memory);
+        STREAM_SECTION(output, "ent")
+        labels_table_write_ext_and_ent_proxy(labels_table, NULL, output);
+        STREAM_SECTION(output, "ext")
+        labels_table_write_ext_and_ent_proxy(labels_table, output, NULL);
+    }
+
+    fflush(output);
+    errors_set_output(NULL);
+    asm_memory_reset(memory);
+    labels_table_reset(labels_table);
+}
+
+void assembler_destroy()
+{
+    asm_memory_destroy(asm_memory_get_instance());
+    labels_table_destroy(labels_table_get_instance());
+    macro_includes_destroy(macro_includes_get_instance());
+    macro_destroy_include_cache();
+    macro_undefine_all();
 }
\ No newline at end of file
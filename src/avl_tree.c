@@ -114,7 +114,7 @@ static int avl_tree_get_balance_factor(avl_node_t *node)
 avl_node_t *avl_tree_create_node(unsigned long key)
 {
     avl_node_t *node;
-    node = (avl_node_t *)malloc(sizeof(avl_node_t));
+    node = (avl_node_t *)asm_alloc_malloc(ALLOC_TREE, sizeof(avl_node_t));
     assert("Couldn't allocate new node for the tree\n" && node != NULL);
 
     node->key = key;
@@ -244,7 +244,7 @@ void avl_tree_destroy(avl_node_t *root)
 
     avl_tree_destroy(root->left);
     avl_tree_destroy(root->right);
-    free(root);
+    asm_alloc_free(root);
 }
 
 /**
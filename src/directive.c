@@ -1,10 +1,30 @@
 #include "directive.h"
 
+#define DIRECTIVE_MAX_SIZE 8192 /* the most words a space or an align directive can add */
+
 #define SKIP_SPACES(line)       \
     while (isspace(*(line++))); \
     --line;
 
-static const char *directives[] = {".extern", ".string", ".entry", ".data", ""};
+static const char *directives[] = {".extern", ".string", ".entry", ".data", ".equ", ".section", ".space", ".align", ".bss", ""};
+
+/* a distinct string literal of the file */
+typedef struct pooled_string_t
+{
+    char *text;         /* the literal without its quotes */
+    int length;
+    int representative; /* the longest literal that ends with this one */
+    int pc;             /* the pc at which the representative was pushed (-1 if it wasn't) */
+} pooled_string_t;
+
+typedef struct string_pool_t
+{
+    pooled_string_t *strings; /* sorted by their reversed text */
+    int count;
+    int capacity;
+} string_pool_t;
+
+static __thread string_pool_t *string_pool; /* NULL when the strings aren't pooled */
 
 /**
  * @brief creates a hash value for the directives
@@ -15,61 +35,193 @@ static const char *directives[] = {".extern", ".string", ".entry", ".data", ""};
 static uint8_t directive_hash(char *word)
 {
     static const uint8_t values[] = {
-        3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2, 4, 4, 4, 4, 4, 1, 4, 4, 4, 0, 4, 4};
+        3, 9, 9, 9, 5, 9, 9, 9, 9, 9, 9, 7, 9, 2, 9, 6, 4, 9, 8, 1, 9, 9, 9, 0, 9, 9};
     return values[((uint8_t)(word[2] - 'a')) % 26];
 }
 
 /**
- * @brief seperates the numbers from the data directive
+ * @brief reports an invalid value of the data directive. A number followed
+ * by more text is reported as a missing comma (and the number is kept)
+ *
+ * @param value the value
+ */
+static void directive_report_invalid_data(char *value)
+{
+    long number;
+    int length;
+
+    if (sscanf(value, "%ld%n", &number, &length) == 1 && isspace(value[length]))
+    {
+        asm_memory_push_data(asm_memory_get_instance(), number);
+        errors_print_line(MISSING_COMMA);
+    }
+    errors_print_line(INVALID_DATA);
+}
+
+/**
+ * @brief seperates the values from the data directive. A value is a number
+ * or an expression that is computed once the labels are known
  *
  * @param data the entire data in the data directive
  */
 static void directive_analyze_data(char *data)
 {
-    int num;
+    char value[LINE_LENGTH];
     char *current;
-    char scanned;
+    char *end;
     bool is_valid;
+    long number;
     memory_t *memory;
 
     current = data;
     is_valid = true;
     memory = asm_memory_get_instance();
-    
+
     SKIP_SPACES(current)
-    while (is_valid && sscanf(current, "%d", &num) == 1)
+    while (is_valid && *current)
     {
-        asm_memory_push_data(memory, num);
+        for (end = current; *end && *end != ','; ++end);
+        memcpy(value, current, end - current);
+        value[end - current] = '\0';
 
-        while (*(++current) && (!isspace(*current) && *current != ','));
+        if (expression_is_number(value, &number))
+        {
+            asm_memory_push_data(memory, number);
+        }
+        else if (expression_evaluate(value, NULL, NULL, NULL))
+        {
+            labels_table_add_fixup(labels_table_get_instance(), value, asm_memory_get_dc(memory), true);
+            asm_memory_push_data(memory, 0);
+        }
+        else
+        {
+            is_valid = false;
+            directive_report_invalid_data(value);
+        }
+
+        current = *end ? end + 1 : end;
         SKIP_SPACES(current)
+    }
+}
+
+/**
+ * @brief finds the literal of a string directive
+ *
+ * @param line the line after its label
+ * @param literal returns the first character of the literal
+ * @param length returns the length of the literal
+ * @return bool true if the line is a string directive with a closed literal
+ */
+static bool directive_get_literal(char *line, char **literal, int *length)
+{
+    char *end;
+
+    SKIP_SPACES(line)
+    if (strncmp(line, directives[STRING], 7) != 0 || !isspace(line[7]))
+    {
+        return false;
+    }
+    line += 7;
+    SKIP_SPACES(line)
+    if (*line != '"' || !(end = strchr(line + 1, '"')))
+    {
+        return false;
+    }
+
+    *literal = line + 1;
+    *length = end - *literal;
+    return true;
+}
+
+/**
+ * @brief compares two pooled strings by their reversed text, so a string
+ * comes right before the strings that end with it (qsort and bsearch
+ * comparator)
+ *
+ * @param first a pooled string
+ * @param second a pooled string
+ * @return int the order of the strings
+ */
+static int directive_compare_reversed(const void *first, const void *second)
+{
+    const pooled_string_t *a = first;
+    const pooled_string_t *b = second;
+    int offset;
 
-        if (*current)
+    for (offset = 1; offset <= a->length && offset <= b->length; offset++)
+    {
+        if (a->text[a->length - offset] != b->text[b->length - offset])
         {
-            if (*current != ',')
-            {
-                is_valid = false;
-                errors_print_line(MISSING_COMMA);
-            }
-            else
-            {
-                ++current;
-                SKIP_SPACES(current)
-            }
+            return (unsigned char)a->text[a->length - offset] - (unsigned char)b->text[b->length - offset];
         }
     }
-    if (sscanf(current, "%1s", &scanned) > 0)
+    return a->length - b->length;
+}
+
+/**
+ * @brief finds the literal of a string directive in the pool
+ *
+ * @param line the line after its label
+ * @return pooled_string_t* the literal (NULL if the strings aren't pooled
+ * or the line has no literal)
+ */
+static pooled_string_t *directive_find_pooled_string(char *line)
+{
+    pooled_string_t key;
+
+    if (!string_pool || !directive_get_literal(line, &(key.text), &(key.length)))
+    {
+        return NULL;
+    }
+    return bsearch(&key, string_pool->strings, string_pool->count, sizeof(pooled_string_t), directive_compare_reversed);
+}
+
+/**
+ * @brief adds the literal of a line to the pool (if the line has one)
+ *
+ * @param line a line of the am file
+ */
+static void directive_add_pooled_string(char *line)
+{
+    char label[LINE_LENGTH];
+    char *literal;
+    int label_length;
+    pooled_string_t *added;
+
+    if (sscanf(line, "%s%n", label, &label_length) == 1 && label[strlen(label) - 1] == ':')
+    {
+        line += label_length;
+    }
+    if (string_pool->count == string_pool->capacity)
+    {
+        string_pool->capacity = string_pool->capacity ? string_pool->capacity << 1 : 64;
+        string_pool->strings = asm_alloc_realloc(ALLOC_PASSES, string_pool->strings, string_pool->capacity * sizeof(pooled_string_t));
+        assert("Memory allocation failed" && string_pool->strings != NULL);
+    }
+
+    added = &(string_pool->strings[string_pool->count]);
+    if (directive_get_literal(line, &(added->text), &(added->length)))
     {
-        errors_print_line(INVALID_DATA);
+        literal = added->text;
+        added->text = asm_alloc_malloc(ALLOC_PASSES, added->length + 1);
+        assert("Memory allocation failed" && added->text != NULL);
+        memcpy(added->text, literal, added->length);
+        added->text[added->length] = '\0';
+        added->pc = -1;
+        string_pool->count++;
     }
 }
 
 /**
- * @brief seperate the characters from the string directive
+ * @brief seperate the characters from the string directive. A pooled
+ * literal pushes its representative only once, the other literals that
+ * end the representative are left to the labels (see
+ * directive_get_string_pc)
  *
  * @param data the entire string in the string directive
+ * @param pooled the pooled literal (NULL if the strings aren't pooled)
  */
-static void directive_analyze_string(char *data)
+static void directive_analyze_string(char *data, pooled_string_t *pooled)
 {
     char *current;
     memory_t *memory;
@@ -79,6 +231,20 @@ static void directive_analyze_string(char *data)
     {
         errors_print_line(MISSING_OPENING_QUOTES);
     }
+    else if (pooled)
+    {
+        pooled = &(string_pool->strings[pooled->representative]);
+        if (pooled->pc == -1)
+        {
+            memory = asm_memory_get_instance();
+            pooled->pc = asm_memory_get_pc(memory);
+            for (current = pooled->text; *current; current++)
+            {
+                asm_memory_push_data(memory, *current);
+            }
+            asm_memory_push_data(memory, '\0');
+        }
+    }
     else
     {
         memory = asm_memory_get_instance();
@@ -96,10 +262,95 @@ static void directive_analyze_string(char *data)
     
 }
 
+/**
+ * @brief reads the size of a space or an align directive
+ *
+ * @param operand the operand of the directive
+ * @param size returns the size
+ * @return bool true if the operand is a single number in the size range
+ * (it is also reported otherwise)
+ */
+static bool directive_get_size(char *operand, long *size)
+{
+    int length = 0;
+
+    if (sscanf(operand, "%ld %n", size, &length) != 1 || operand[length] != '\0' || *size < 0 || *size > DIRECTIVE_MAX_SIZE)
+    {
+        errors_print_line(INVALID_SIZE);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief handles the space and the align directives: words are added until
+ * the given number of words were added or until the pc is aligned to the
+ * given number of words. The words are zero data words, or reserved words
+ * for the .bss section (see asm_memory_reserve)
+ *
+ * @param operand the operand of the directive
+ * @param is_align is it an align directive
+ * @param is_reserved are the words reserved rather than stored
+ */
+static void directive_analyze_space(char *operand, bool is_align, bool is_reserved)
+{
+    memory_t *memory = asm_memory_get_instance();
+    long size;
+
+    if (!directive_get_size(operand, &size))
+    {
+        return;
+    }
+    if (is_align)
+    {
+        if (size == 0)
+        {
+            errors_print_line(INVALID_SIZE);
+            return;
+        }
+        size = (size - (START_IC_VALUE + asm_memory_get_pc(memory)) % size) % size;
+        labels_table_mark_position_dependent(labels_table_get_instance());
+    }
+
+    if (is_reserved)
+    {
+        asm_memory_reserve(memory, size);
+    }
+    else
+    {
+        while (size-- > 0)
+        {
+            asm_memory_push_data(memory, 0);
+        }
+    }
+}
+
+/**
+ * @brief handles a bss directive, the form the macro stage gives to the
+ * space and the align directives of the .bss section: ".bss space N" or
+ * ".bss align N"
+ *
+ * @param operand the operand of the directive
+ */
+static void directive_analyze_bss(char *operand)
+{
+    char kind[10];
+    int length;
+
+    if (sscanf(operand, "%9s%n", kind, &length) == 1 && (strcmp(kind, "space") == 0 || strcmp(kind, "align") == 0))
+    {
+        directive_analyze_space(operand + length, strcmp(kind, "align") == 0, true);
+    }
+    else
+    {
+        errors_print_line(INVALID_SIZE);
+    }
+}
+
 void directive_handle(char *line)
 {
     uint8_t d_hash;
-    char directive[9];
+    char directive[10];
 
     SKIP_SPACES(line);
     sscanf(line, "%9s", directive);
@@ -111,12 +362,42 @@ void directive_handle(char *line)
     }
     else if (d_hash == STRING && strcmp(directive, directives[d_hash]) == 0)
     {
-        directive_analyze_string(line + 7);
+        directive_analyze_string(line + 7, directive_find_pooled_string(line));
     }
     else if ((d_hash == ENTRY || d_hash == EXTERN) && strcmp(directive, directives[d_hash]) == 0)
     {
         labels_table_add_entry_or_extern_labels(labels_table_get_instance(), line + 7, d_hash == ENTRY);
     }
+    else if (d_hash == EQU && strcmp(directive, directives[d_hash]) == 0)
+    {
+        labels_table_add_constant(labels_table_get_instance(), line + 4);
+    }
+    else if (d_hash == SECTION && strcmp(directive, directives[d_hash]) == 0)
+    {
+        /* the macro stage already grouped the lines of the sections, the directive only names the group */
+        if (sscanf(line + 8, "%9s", directive) != 1)
+        {
+            errors_print_line(INVALID_SECTION);
+        }
+    }
+    else if ((d_hash == SPACE || d_hash == ALIGN) && strcmp(directive, directives[d_hash]) == 0)
+    {
+        directive_analyze_space(line + strlen(directives[d_hash]), d_hash == ALIGN, false);
+    }
+    else if (d_hash == BSS && strcmp(directive, directives[d_hash]) == 0)
+    {
+        directive_analyze_bss(line + 4);
+    }
+    else if (strcmp(directive, ".include") == 0)
+    {
+        /* the macro stage leaves only the includes it couldn't open */
+        errors_print_line(INVALID_INCLUDE);
+    }
+    else if (strcmp(directive, ".if") == 0 || strcmp(directive, ".else") == 0 || strcmp(directive, ".endif") == 0)
+    {
+        /* the macro stage leaves only the conditionals that don't match */
+        errors_print_line(UNMATCHED_CONDITIONAL);
+    }
     else
     {
         errors_print_line(UNDEFINED_DIRECTIVE);
@@ -129,3 +410,89 @@ directive_e directive_get(char *directive)
     d_hash = directive_hash(directive);
     return (strcmp(directive, directives[d_hash]) == 0) ? d_hash : INVALID_DIRECTIVE;
 }
+
+
+void directive_start_string_pool(FILE *am_file)
+{
+    char line[LINE_LENGTH];
+    long start;
+    int current;
+    int unique;
+
+    directive_end_string_pool();
+    string_pool = asm_alloc_calloc(ALLOC_PASSES, 1, sizeof(string_pool_t));
+    assert("Memory allocation failed" && string_pool != NULL);
+
+    start = ftell(am_file);
+    while (fgets(line, LINE_LENGTH, am_file))
+    {
+        directive_add_pooled_string(line);
+    }
+    fseek(am_file, start, SEEK_SET);
+
+    qsort(string_pool->strings, string_pool->count, sizeof(pooled_string_t), directive_compare_reversed);
+    for (unique = 0, current = 0; current < string_pool->count; current++)
+    {
+        if (unique > 0 && directive_compare_reversed(&(string_pool->strings[unique - 1]), &(string_pool->strings[current])) == 0)
+        {
+            asm_alloc_free(string_pool->strings[current].text);
+        }
+        else
+        {
+            string_pool->strings[unique++] = string_pool->strings[current];
+        }
+    }
+    string_pool->count = unique;
+
+    /* the strings that end with a string come right after it */
+    for (current = string_pool->count - 1; current >= 0; current--)
+    {
+        string_pool->strings[current].representative = current;
+        if (current + 1 < string_pool->count && string_pool->strings[current].length < string_pool->strings[current + 1].length
+            && memcmp(string_pool->strings[current].text,
+                      string_pool->strings[current + 1].text + string_pool->strings[current + 1].length - string_pool->strings[current].length,
+                      string_pool->strings[current].length) == 0)
+        {
+            string_pool->strings[current].representative = string_pool->strings[current + 1].representative;
+        }
+    }
+}
+
+void directive_restart_string_pool()
+{
+    int current;
+
+    for (current = 0; string_pool && current < string_pool->count; current++)
+    {
+        string_pool->strings[current].pc = -1;
+    }
+}
+
+void directive_end_string_pool()
+{
+    int current;
+
+    if (string_pool)
+    {
+        for (current = 0; current < string_pool->count; current++)
+        {
+            asm_alloc_free(string_pool->strings[current].text);
+        }
+        asm_alloc_free(string_pool->strings);
+        asm_alloc_free(string_pool);
+        string_pool = NULL;
+    }
+}
+
+int directive_get_string_pc(char *line, int pc)
+{
+    pooled_string_t *pooled;
+    pooled_string_t *representative;
+
+    if (!(pooled = directive_find_pooled_string(line)))
+    {
+        return pc;
+    }
+    representative = &(string_pool->strings[pooled->representative]);
+    return (representative->pc == -1 ? pc : representative->pc) + representative->length - pooled->length;
+}
\ No newline at end of file
@@ -25,6 +25,13 @@ static const char *error_messages[NUMBER_OF_ERRORS] = {
     "Multiple label definitions",   /* MULTIPLE LABEL DEFINITIONS */
     "Invalid label name",           /* INVALID_LABEL_NAME */
     "Contrary label attributes",    /* CONTRARY_LABEL_ATTRIBUTES */
+    "Couldn't include the file",    /* INVALID_INCLUDE */
+    "Unmatched conditional",        /* UNMATCHED_CONDITIONAL */
+    "Invalid expression",           /* INVALID_EXPRESSION */
+    "Invalid size",                 /* INVALID_SIZE */
+    "Invalid section",              /* INVALID_SECTION */
+    "Couldn't write the file",      /* INVALID_OUTPUT */
+    "Can't be relocated",           /* INVALID_RELOCATION */
 };
 
 #define CHECK_ERROR(error)                      \
@@ -33,13 +40,59 @@ static const char *error_messages[NUMBER_OF_ERRORS] = {
         error = UNKNOWN;                        \
     }
 
-static FILE* output;
-static uint16_t lines = 1;
+#define ERRORS_OUTPUT (output ? output : stdout)
+
+/* every thread reports the errors of the lines it analyzes */
+static __thread FILE* output;
+static __thread uint16_t lines = 1;
+static __thread unsigned int count;
+static __thread bool is_muted;
+static __thread errors_hook_t hook;
+static __thread void *hook_context;
 
 void errors_print_line(error_e error)
 {
     CHECK_ERROR(error)
-    printf("%04d\t%s\n", lines, error_messages[error]);
+    if (hook)
+    {
+        hook(error, NULL, hook_context);
+    }
+    else if (!is_muted)
+    {
+        fprintf(ERRORS_OUTPUT, "%04d\t%s\n", lines, error_messages[error]);
+    }
+    ++count;
+}
+
+void errors_print_symbol(error_e error, char *symbol)
+{
+    CHECK_ERROR(error)
+    if (hook)
+    {
+        hook(error, symbol, hook_context);
+    }
+    else if (!is_muted)
+    {
+        fprintf(ERRORS_OUTPUT, "%s \"%s\"\n", error_messages[error], symbol);
+    }
+    ++count;
+}
+
+void errors_set_hook(errors_hook_t new_hook, void *context)
+{
+    hook = new_hook;
+    hook_context = context;
+}
+
+const char *errors_get_message(error_e error)
+{
+    CHECK_ERROR(error)
+    return error_messages[error];
+}
+
+void errors_set_muted(bool muted)
+{
+    is_muted = muted;
 }
 
 void errors_set_output(FILE *out)
@@ -50,4 +103,15 @@ void errors_set_output(FILE *out)
 void errors_increase_lines()
 {
     ++lines;
+}
+
+unsigned int errors_get_count()
+{
+    return count;
+}
+
+void errors_reset()
+{
+    lines = 1;
+    count = 0;
 }
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include "expression.h"
+
+#define SYMBOL_MAX_LENGTH 31
+#define EXPRESSION_SHIFT_LIMIT 32 /* a shift is by 0 to 31 bits, which any long has */
+
+typedef struct expression_t
+{
+    char *cursor;
+    expression_resolver_t resolver;
+    void *context;
+    bool is_evaluated; /* false while only the syntax is checked */
+    bool is_valid;
+} expression_t;
+
+static long expression_parse_or(expression_t *expression);
+
+/**
+ * @brief skips the spaces before the next token
+ *
+ * @param expression the expression
+ */
+static void expression_skip_spaces(expression_t *expression)
+{
+    while (isspace(*(expression->cursor)))
+    {
+        ++(expression->cursor);
+    }
+}
+
+/**
+ * @brief checks if the next token is the given operator and consumes it
+ *
+ * @param expression the expression
+ * @param operator the operator
+ * @return bool true if the operator was consumed
+ */
+static bool expression_accept(expression_t *expression, char *operator)
+{
+    size_t length = strlen(operator);
+
+    expression_skip_spaces(expression);
+    if (strncmp(expression->cursor, operator, length) == 0)
+    {
+        expression->cursor += length;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief makes the expression invalid because a value is out of range. A
+ * value that depends on symbols is only known when the expression is
+ * evaluated, so the overflow is ignored while only the syntax is checked
+ *
+ * @param expression the expression
+ * @return long 0, the value the expression goes on with
+ */
+static long expression_overflow(expression_t *expression)
+{
+    if (expression->is_evaluated)
+    {
+        expression->is_valid = false;
+    }
+    return 0;
+}
+
+/**
+ * @brief checks that a value is in the range of the expressions. The range
+ * is symmetric (-LONG_MAX to LONG_MAX), so a value of the range can be
+ * negated and divided without an overflow
+ *
+ * @param expression the expression
+ * @param value the value
+ * @return long the value (0 if it is out of range)
+ */
+static long expression_check(expression_t *expression, long value)
+{
+    return (value < -LONG_MAX) ? expression_overflow(expression) : value;
+}
+
+/**
+ * @brief returns the absolute value of a value of the range
+ *
+ * @param value the value
+ * @return unsigned long the absolute value
+ */
+static unsigned long expression_magnitude(long value)
+{
+    return (value < 0) ? (unsigned long)-value : (unsigned long)value;
+}
+
+/**
+ * @brief gives a sign to an absolute value, if it is in the range
+ *
+ * @param expression the expression
+ * @param magnitude the absolute value
+ * @param is_negative is the value negative
+ * @return long the value (0 if it is out of range)
+ */
+static long expression_signed(expression_t *expression, unsigned long magnitude, bool is_negative)
+{
+    if (magnitude > (unsigned long)LONG_MAX)
+    {
+        return expression_overflow(expression);
+    }
+    return is_negative ? -(long)magnitude : (long)magnitude;
+}
+
+/**
+ * @brief adds two values of the range
+ *
+ * @param expression the expression
+ * @param first the first value
+ * @param second the second value
+ * @return long the sum (0 if it is out of range)
+ */
+static long expression_add(expression_t *expression, long first, long second)
+{
+    unsigned long first_magnitude = expression_magnitude(first);
+    unsigned long second_magnitude = expression_magnitude(second);
+
+    /* the magnitudes are at most LONG_MAX, so their sum fits an unsigned long */
+    if ((first < 0) == (second < 0))
+    {
+        return expression_signed(expression, first_magnitude + second_magnitude, first < 0);
+    }
+    if (first_magnitude >= second_magnitude)
+    {
+        return expression_signed(expression, first_magnitude - second_magnitude, first < 0);
+    }
+    return expression_signed(expression, second_magnitude - first_magnitude, second < 0);
+}
+
+/**
+ * @brief parses a symbol and returns its value
+ *
+ * @param expression the expression
+ * @return long the value of the symbol
+ */
+static long expression_parse_symbol(expression_t *expression)
+{
+    char symbol[SYMBOL_MAX_LENGTH + 1];
+    int length = 0;
+    long value = 0;
+
+    while (isalnum(*(expression->cursor)))
+    {
+        if (length < SYMBOL_MAX_LENGTH)
+        {
+            symbol[length++] = *(expression->cursor);
+        }
+        else
+        {
+            expression->is_valid = false;
+        }
+        ++(expression->cursor);
+    }
+    symbol[length] = '\0';
+
+    if (expression->resolver && !expression->resolver(symbol, &value, expression->context) && expression->is_evaluated)
+    {
+        expression->is_valid = false;
+    }
+
+    return expression_check(expression, value);
+}
+
+/**
+ * @brief parses a number, a symbol, a parenthesized expression or a unary
+ * operator
+ *
+ * @param expression the expression
+ * @return long the value
+ */
+static long expression_parse_unary(expression_t *expression)
+{
+    long value = 0;
+
+    if (expression_accept(expression, "-"))
+    {
+        return -expression_parse_unary(expression);
+    }
+    if (expression_accept(expression, "+"))
+    {
+        return expression_parse_unary(expression);
+    }
+    if (expression_accept(expression, "("))
+    {
+        value = expression_parse_or(expression);
+        if (!expression_accept(expression, ")"))
+        {
+            expression->is_valid = false;
+        }
+    }
+    else if (isdigit(*(expression->cursor)))
+    {
+        errno = 0;
+        value = strtol(expression->cursor, &(expression->cursor), 10);
+        if (errno == ERANGE)
+        {
+            expression->is_valid = false; /* a number that doesn't fit is wrong with any symbols */
+        }
+    }
+    else if (isalpha(*(expression->cursor)))
+    {
+        value = expression_parse_symbol(expression);
+    }
+    else
+    {
+        expression->is_valid = false;
+    }
+
+    return value;
+}
+
+/**
+ * @brief parses the * and / operators
+ *
+ * @param expression the expression
+ * @return long the value
+ */
+static long expression_parse_product(expression_t *expression)
+{
+    long value;
+    long factor;
+    long divisor;
+
+    value = expression_parse_unary(expression);
+    while (expression->is_valid)
+    {
+        if (expression_accept(expression, "*"))
+        {
+            factor = expression_parse_unary(expression);
+            if (factor != 0 && expression_magnitude(value) > (unsigned long)LONG_MAX / expression_magnitude(factor))
+            {
+                value = expression_overflow(expression);
+            }
+            else
+            {
+                value = expression_signed(expression, expression_magnitude(value) * expression_magnitude(factor), (value < 0) != (factor < 0));
+            }
+        }
+        else if (expression_accept(expression, "/"))
+        {
+            divisor = expression_parse_unary(expression);
+            if (divisor != 0)
+            {
+                value /= divisor;
+            }
+            else if (expression->is_evaluated)
+            {
+                expression->is_valid = false;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief parses the binary + and - operators
+ *
+ * @param expression the expression
+ * @return long the value
+ */
+static long expression_parse_sum(expression_t *expression)
+{
+    long value;
+
+    value = expression_parse_product(expression);
+    while (expression->is_valid)
+    {
+        if (expression_accept(expression, "+"))
+        {
+            value = expression_add(expression, value, expression_parse_product(expression));
+        }
+        else if (expression_accept(expression, "-"))
+        {
+            value = expression_add(expression, value, -expression_parse_product(expression));
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief parses the << and >> operators
+ *
+ * @param expression the expression
+ * @return long the value
+ */
+static long expression_parse_shift(expression_t *expression)
+{
+    long value;
+    long count;
+
+    value = expression_parse_sum(expression);
+    while (expression->is_valid)
+    {
+        if (expression_accept(expression, "<<"))
+        {
+            count = expression_parse_sum(expression);
+            if (count < 0 || count >= EXPRESSION_SHIFT_LIMIT || expression_magnitude(value) > ((unsigned long)LONG_MAX >> count))
+            {
+                value = expression_overflow(expression);
+            }
+            else
+            {
+                value = expression_signed(expression, expression_magnitude(value) << count, value < 0);
+            }
+        }
+        else if (expression_accept(expression, ">>"))
+        {
+            count = expression_parse_sum(expression);
+            if (count < 0 || count >= EXPRESSION_SHIFT_LIMIT)
+            {
+                value = expression_overflow(expression);
+            }
+            else
+            {
+                value >>= count;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief parses the & operator
+ *
+ * @param expression the expression
+ * @return long the value
+ */
+static long expression_parse_and(expression_t *expression)
+{
+    long value;
+
+    value = expression_parse_shift(expression);
+    while (expression->is_valid && expression_accept(expression, "&"))
+    {
+        value = expression_check(expression, value & expression_parse_shift(expression));
+    }
+
+    return value;
+}
+
+/**
+ * @brief parses the | operator
+ *
+ * @param expression the expression
+ * @return long the value
+ */
+static long expression_parse_or(expression_t *expression)
+{
+    long value;
+
+    value = expression_parse_and(expression);
+    while (expression->is_valid && expression_accept(expression, "|"))
+    {
+        value = expression_check(expression, value | expression_parse_and(expression));
+    }
+
+    return value;
+}
+
+bool expression_evaluate(char *text, expression_resolver_t resolver, void *context, long *value)
+{
+    expression_t expression;
+    long result;
+
+    expression.cursor = text;
+    expression.resolver = resolver;
+    expression.context = context;
+    expression.is_evaluated = value != NULL;
+    expression.is_valid = true;
+
+    result = expression_parse_or(&expression);
+    expression_skip_spaces(&expression);
+    if (*(expression.cursor) != '\0')
+    {
+        expression.is_valid = false;
+    }
+    if (expression.is_valid && value)
+    {
+        *value = result;
+    }
+
+    return expression.is_valid;
+}
+
+bool expression_is_number(char *text, long *value)
+{
+    char *end;
+
+    if (!isdigit(*text) && !((*text == '-' || *text == '+') && isdigit(text[1])))
+    {
+        return false;
+    }
+    errno = 0;
+    *value = strtol(text, &end, 10);
+    while (isspace(*end))
+    {
+        ++end;
+    }
+
+    /* a number out of the range of the expressions is evaluated (and rejected) as one */
+    return *end == '\0' && errno != ERANGE && *value >= -LONG_MAX;
+}
\ No newline at end of file
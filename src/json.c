@@ -0,0 +1,285 @@
+#include "json.h"
+
+#define SKIP_WHITESPACE(json)  \
+    while (isspace(*(json)))   \
+        ++(json);
+
+/**
+ * @brief returns the end of a JSON string
+ *
+ * @param value the string (starting at its opening quotes)
+ * @return char* the character after the closing quotes
+ */
+static char *json_skip_string(char *value)
+{
+    for (++value; *value && *value != '"'; ++value)
+    {
+        if (*value == '\\' && value[1])
+        {
+            ++value;
+        }
+    }
+    return *value ? value + 1 : value;
+}
+
+/**
+ * @brief returns the value of a hexadecimal digit
+ *
+ * @param digit the digit
+ * @return int the value (-1 if it isn't a hexadecimal digit)
+ */
+static int json_hex_value(char digit)
+{
+    if (isdigit((unsigned char)digit))
+    {
+        return digit - '0';
+    }
+    digit = tolower((unsigned char)digit);
+    return (digit >= 'a' && digit <= 'f') ? digit - 'a' + 10 : -1;
+}
+
+char *json_skip(char *value)
+{
+    int depth = 0;
+
+    SKIP_WHITESPACE(value)
+    do
+    {
+        if (*value == '"')
+        {
+            value = json_skip_string(value);
+        }
+        else if (*value == '{' || *value == '[')
+        {
+            ++depth;
+            ++value;
+        }
+        else if (*value == '}' || *value == ']')
+        {
+            --depth;
+            ++value;
+        }
+        else if (*value == '\0')
+        {
+            return value;
+        }
+        else if (depth > 0 && strchr(",: \t\r\n", *value))
+        {
+            ++value;
+        }
+        else
+        {
+            /* a number or a literal */
+            while (*value && !strchr(",:{}[]\" \t\r\n", *value))
+            {
+                ++value;
+            }
+        }
+    } while (depth > 0);
+
+    return value;
+}
+
+char *json_find(char *object, char *key)
+{
+    char *name;
+    size_t key_length = strlen(key);
+
+    if (!object)
+    {
+        return NULL;
+    }
+    SKIP_WHITESPACE(object)
+    if (*object != '{')
+    {
+        return NULL;
+    }
+
+    for (++object;;)
+    {
+        SKIP_WHITESPACE(object)
+        if (*object != '"')
+        {
+            return NULL;
+        }
+        name = object + 1;
+        object = json_skip_string(object);
+        SKIP_WHITESPACE(object)
+        if (*object != ':')
+        {
+            return NULL;
+        }
+        ++object;
+        SKIP_WHITESPACE(object)
+
+        if ((size_t)(object - name) >= key_length + 2 && strncmp(name, key, key_length) == 0 && name[key_length] == '"')
+        {
+            return object;
+        }
+
+        object = json_skip(object);
+        SKIP_WHITESPACE(object)
+        if (*object != ',')
+        {
+            return NULL;
+        }
+        ++object;
+    }
+}
+
+char *json_array_first(char *array)
+{
+    if (!array)
+    {
+        return NULL;
+    }
+    SKIP_WHITESPACE(array)
+    if (*array != '[')
+    {
+        return NULL;
+    }
+    ++array;
+    SKIP_WHITESPACE(array)
+    return (*array && *array != ']') ? array : NULL;
+}
+
+char *json_array_next(char *element)
+{
+    element = json_skip(element);
+    SKIP_WHITESPACE(element)
+    if (*element != ',')
+    {
+        return NULL;
+    }
+    ++element;
+    SKIP_WHITESPACE(element)
+    return *element ? element : NULL;
+}
+
+char *json_get_string(char *value, size_t *length)
+{
+    char *string;
+    char *end;
+    size_t size = 0;
+    unsigned int code;
+    int digit;
+    int i;
+
+    if (!value || *value != '"')
+    {
+        return NULL;
+    }
+    end = json_skip_string(value);
+    string = asm_alloc_malloc(ALLOC_SERVICE, end - value);
+    assert("Memory allocation failed" && string != NULL);
+
+    for (++value; value < end - 1; ++value)
+    {
+        if (*value != '\\')
+        {
+            string[size++] = *value;
+            continue;
+        }
+        switch (*(++value))
+        {
+        case 'n':
+            string[size++] = '\n';
+            break;
+        case 't':
+            string[size++] = '\t';
+            break;
+        case 'r':
+            string[size++] = '\r';
+            break;
+        case 'b':
+            string[size++] = '\b';
+            break;
+        case 'f':
+            string[size++] = '\f';
+            break;
+        case 'u':
+            for (code = 0, i = 1; i <= 4 && (digit = json_hex_value(value[i])) >= 0; i++)
+            {
+                code = (code << 4) | digit;
+            }
+            value += i - 1;
+            /* UTF-8 (surrogate pairs are kept as two code points) */
+            if (code < 0x80)
+            {
+                string[size++] = code;
+            }
+            else if (code < 0x800)
+            {
+                string[size++] = 0xc0 | (code >> 6);
+                string[size++] = 0x80 | (code & 0x3f);
+            }
+            else
+            {
+                string[size++] = 0xe0 | (code >> 12);
+                string[size++] = 0x80 | ((code >> 6) & 0x3f);
+                string[size++] = 0x80 | (code & 0x3f);
+            }
+            break;
+        default:
+            string[size++] = *value;
+            break;
+        }
+    }
+    string[size] = '\0';
+
+    if (length)
+    {
+        *length = size;
+    }
+    return string;
+}
+
+long json_get_int(char *value, long default_value)
+{
+    char *end;
+    long number;
+
+    if (!value)
+    {
+        return default_value;
+    }
+    number = strtol(value, &end, 10);
+    return end == value ? default_value : number;
+}
+
+void json_write_string(FILE *output, char *string)
+{
+    fputc('"', output);
+    for (; *string; ++string)
+    {
+        switch (*string)
+        {
+        case '"':
+            fputs("\\\"", output);
+            break;
+        case '\\':
+            fputs("\\\\", output);
+            break;
+        case '\n':
+            fputs("\\n", output);
+            break;
+        case '\t':
+            fputs("\\t", output);
+            break;
+        case '\r':
+            fputs("\\r", output);
+            break;
+        default:
+            if ((unsigned char)*string < 0x20)
+            {
+                fprintf(output, "\\u%04x", *string);
+            }
+            else
+            {
+                fputc(*string, output);
+            }
+            break;
+        }
+    }
+    fputc('"', output);
+}
\ No newline at end of file
@@ -6,7 +6,7 @@ struct label_t
     linked_list_node_t *lines;
     int base_address;
     unsigned int offset : 4;
-    int attributes : 4;
+    int attributes : 8;
 };
 
 #define IS_VALID_LABEL(label_name) \
@@ -26,7 +26,7 @@ void label_insert_line(label_t *label, int line_num)
 {
     int *line_num_ptr;
 
-    line_num_ptr = (int*)malloc(sizeof(int));
+    line_num_ptr = (int*)asm_alloc_malloc(ALLOC_LABELS, sizeof(int));
     assert("Memory allocation failed" && line_num_ptr != NULL);
     *line_num_ptr = line_num;
 
@@ -43,7 +43,7 @@ void label_destroy_lines(label_t *label)
     {
         temp = linked_list_get_info(*lines);
         linked_list_pop(lines);
-        free(temp);
+        asm_alloc_free(temp);
     }
 }
 
@@ -87,7 +87,7 @@ label_t *label_create(char *symbol)
 {
     label_t *new_label;
 
-    new_label = (label_t *)malloc(sizeof(label_t));
+    new_label = (label_t *)asm_alloc_malloc(ALLOC_LABELS, sizeof(label_t));
     assert("Couldn't allocate new node for the labels table\n" && new_label != NULL);
     strcpy(new_label->symbol, symbol);
     new_label->lines = NULL;
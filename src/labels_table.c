@@ -3,14 +3,98 @@
 #define IS_VALID_LABEL(label_name) \
 !asm_language_is_saved_word(label_name) && isalpha(*label_name)
 
+#define RELOCATION_DELTA 0x1000 /* the second distance the labels are moved by to find the relocatable expressions */
+
+typedef enum
+{
+    JOURNAL_DEFINITION,
+    JOURNAL_ENTRY,
+    JOURNAL_EXTERN,
+    JOURNAL_REFERENCE,
+    JOURNAL_CONSTANT,
+    JOURNAL_FIXUP
+} journal_e;
+
+typedef enum
+{
+    CONSTANT_UNEVALUATED,
+    CONSTANT_EVALUATING,
+    CONSTANT_EVALUATED,
+    CONSTANT_FAILED
+} constant_state_e;
+
+/* a label change that was recorded instead of being applied */
+typedef struct journal_entry_t
+{
+    journal_e kind;
+    int address;          /* the pc of a definition or the ic (dc) of a reference or a fixup */
+    uint8_t segment_flag; /* the segment of a definition or a fixup */
+    char symbol[LABEL_MAX_LENGTH + 1];
+    char *text;           /* the expression of a constant or a fixup (NULL for the rest) */
+} journal_entry_t;
+
+/* a .equ constant, evaluated when it is first needed */
+typedef struct constant_t
+{
+    label_t *label;
+    char *expression;
+    long value;
+    constant_state_e state;
+} constant_t;
+
+/* a word whose expression is computed once all of the labels are known */
+typedef struct fixup_t
+{
+    char *expression;
+    uint16_t location; /* the ic or the dc of the word */
+    bool is_data;
+    bool is_relocatable; /* the value moves with the labels (--rel) */
+    long value;
+} fixup_t;
+
+/* the state of the evaluation of an expression */
+typedef struct resolution_t
+{
+    labels_table_t *table;
+    long delta;       /* added to the address of every label */
+    bool is_reported; /* the expression failed because of an error that was already reported */
+} resolution_t;
+
+/* an entry label or an extern reference, keyed by its address */
+typedef struct exported_label_t
+{
+    uint16_t address;
+    label_t *label;
+} exported_label_t;
+
+/* the entry or extern labels in the order they were declared */
+typedef struct exported_labels_t
+{
+    label_t **labels;
+    int count;
+    int capacity;
+} exported_labels_t;
+
 struct labels_table_t
 {
     avl_node_t *root;
     int extern_count;
     int entry_count;
+    bool is_journaling;
+    bool is_position_dependent;   /* a line depends on the pc it is analyzed at (an .align) */
+    linked_list_node_t *journal;
+    linked_list_node_t *journal_tail;
+    exported_labels_t entries;
+    exported_labels_t externs;
+    constant_t *constants;
+    int constants_count;
+    int constants_capacity;
+    fixup_t *fixups;
+    int fixups_count;
+    int fixups_capacity;
 };
 
-static labels_table_t *label_table_instance;
+static __thread labels_table_t *label_table_instance; /* every thread analyzes its own lines */
 
 /**
  * @brief allocated and initializes a labels table
@@ -21,10 +105,23 @@ static labels_table_t *labels_table_init()
 {
     labels_table_t *new_table;
 
-    new_table = (labels_table_t *)malloc(sizeof(labels_table_t));
+    new_table = (labels_table_t *)asm_alloc_malloc(ALLOC_LABELS, sizeof(labels_table_t));
+    assert("Couldn't allocate the labels table\n" && new_table != NULL);
     new_table->root = NULL;
     new_table->extern_count = 0;
     new_table->entry_count = 0;
+    new_table->is_journaling = false;
+    new_table->is_position_dependent = false;
+    new_table->journal = NULL;
+    new_table->journal_tail = NULL;
+    memset(&(new_table->entries), 0, sizeof(exported_labels_t));
+    memset(&(new_table->externs), 0, sizeof(exported_labels_t));
+    new_table->constants = NULL;
+    new_table->constants_count = 0;
+    new_table->constants_capacity = 0;
+    new_table->fixups = NULL;
+    new_table->fixups_count = 0;
+    new_table->fixups_capacity = 0;
 
     return new_table;
 }
@@ -38,6 +135,91 @@ labels_table_t *labels_table_get_instance()
     return label_table_instance;
 }
 
+labels_table_t *labels_table_set_instance(labels_table_t *table)
+{
+    labels_table_t *previous_instance = label_table_instance;
+    label_table_instance = table;
+    return previous_instance;
+}
+
+void labels_table_start_journal(labels_table_t *table)
+{
+    table->is_journaling = true;
+}
+
+void labels_table_mark_position_dependent(labels_table_t *table)
+{
+    table->is_position_dependent = true;
+}
+
+bool labels_table_is_position_dependent(labels_table_t *table)
+{
+    return table->is_position_dependent;
+}
+
+/**
+ * @brief records a label change at the end of the table's journal
+ *
+ * @param table the labels table
+ * @param kind the kind of the change
+ * @param symbol the label symbol
+ * @param address the pc of a definition or the ic (dc) of a reference or a fixup
+ * @param segment_flag the segment of a definition or a fixup
+ * @param text the expression of a constant or a fixup (NULL for the rest)
+ */
+static void labels_table_journal(labels_table_t *table, journal_e kind, char *symbol, int address, uint8_t segment_flag, char *text)
+{
+    journal_entry_t *entry;
+
+    entry = (journal_entry_t *)asm_alloc_malloc(ALLOC_LABELS, sizeof(journal_entry_t));
+    assert("Couldn't allocate a journal entry\n" && entry != NULL);
+    entry->kind = kind;
+    entry->address = address;
+    entry->segment_flag = segment_flag;
+    strncpy(entry->symbol, symbol, LABEL_MAX_LENGTH);
+    entry->symbol[LABEL_MAX_LENGTH] = '\0';
+    entry->text = NULL;
+    if (text)
+    {
+        entry->text = asm_alloc_malloc(ALLOC_LABELS, strlen(text) + 1);
+        assert("Couldn't allocate a journal entry\n" && entry->text != NULL);
+        strcpy(entry->text, text);
+    }
+
+    if (table->journal_tail)
+    {
+        linked_list_insert_after_node(table->journal_tail);
+        table->journal_tail = linked_list_get_next_address(table->journal_tail);
+    }
+    else
+    {
+        linked_list_push(&(table->journal));
+        table->journal_tail = table->journal;
+    }
+    linked_list_set_info(table->journal_tail, entry);
+}
+
+/**
+ * @brief frees the journal of the table
+ *
+ * @param table the labels table
+ */
+static void labels_table_destroy_journal(labels_table_t *table)
+{
+    while (table->journal)
+    {
+        asm_alloc_free(((journal_entry_t *)linked_list_get_info(table->journal))->text);
+        asm_alloc_free(linked_list_get_info(table->journal));
+        linked_list_pop(&(table->journal));
+    }
+    table->journal_tail = NULL;
+}
+
+bool labels_table_has_journal(labels_table_t *table)
+{
+    return table->journal != NULL;
+}
+
 int labels_table_get_extern_count(labels_table_t *table)
 {
     return table->extern_count;
@@ -87,6 +269,18 @@ label_t *labels_table_get_forced_label(labels_table_t *table, char* symbol)
     return label;
 }
 
+void labels_table_add_reference(labels_table_t *table, char *symbol, int location)
+{
+    if (table->is_journaling)
+    {
+        labels_table_journal(table, JOURNAL_REFERENCE, symbol, location, 0, NULL);
+    }
+    else
+    {
+        label_insert_line(labels_table_get_forced_label(table, symbol), location);
+    }
+}
+
 /**
  * @brief adds a label to the table (or modifies the label in case
  * it is already apparent in the avl tree)
@@ -130,8 +324,9 @@ static void labels_table_add_definition_labels(char *label_name, int address, la
 void labels_table_add_if_definition(char **line, labels_table_t *table)
 {
     char label_name[LABEL_MAX_LENGTH + 1];
-    char word[9];
+    char word[10];
     int label_length;
+    int address;
     directive_e dir;
     memory_t *memory;
     uint8_t segment_flag;
@@ -142,113 +337,416 @@ void labels_table_add_if_definition(char **line, labels_table_t *table)
     {
         memory = asm_memory_get_instance();
         dir = directive_get(word);
-        segment_flag = (dir == DATA || dir == STRING) ? DATA_FLAG : CODE_FLAG;
-        labels_table_add_definition_labels(label_name, asm_memory_get_pc(memory), table, segment_flag);
+        if (dir == SECTION)
+        {
+            /* a section has no address of its own until the file is laid out */
+            errors_print_line(INVALID_SECTION);
+            *line = *line + label_length;
+            return;
+        }
+        segment_flag = (dir == DATA || dir == STRING || dir == SPACE || dir == ALIGN || dir == BSS) ? DATA_FLAG : CODE_FLAG;
+        address = (dir == STRING) ? directive_get_string_pc(*line + label_length, asm_memory_get_pc(memory)) : asm_memory_get_pc(memory);
+        if (table->is_journaling)
+        {
+            labels_table_journal(table, JOURNAL_DEFINITION, label_name, address, segment_flag, NULL);
+        }
+        else
+        {
+            labels_table_add_definition_labels(label_name, address, table, segment_flag);
+        }
 
         *line = *line + label_length;
     }
 }
 
-void labels_table_add_entry_or_extern_labels(labels_table_t *table, char *line, bool is_entry)
+/**
+ * @brief appends a label to the entry or extern labels
+ *
+ * @param exported the entry or extern labels
+ * @param label the label
+ */
+static void labels_table_export(exported_labels_t *exported, label_t *label)
+{
+    if (exported->count == exported->capacity)
+    {
+        exported->capacity = exported->capacity ? exported->capacity << 1 : 16;
+        exported->labels = asm_alloc_realloc(ALLOC_LABELS, exported->labels, exported->capacity * sizeof(label_t *));
+        assert("Memory allocation failed" && exported->labels != NULL);
+    }
+    exported->labels[exported->count++] = label;
+}
+
+/**
+ * @brief marks a label as entry or extern (creating it if needed)
+ *
+ * @param table the labels table
+ * @param label_name the label name
+ * @param is_entry is the lable of type entry
+ */
+static void labels_table_set_entry_or_extern(labels_table_t *table, char *label_name, bool is_entry)
 {
     avl_node_t *added_label_node;
     label_t *added_label;
     unsigned long label_hash;
+    uint8_t attributes;
+
+    label_hash = hash(label_name);
+    if ((added_label_node = avl_tree_search_node(table->root, label_hash)))
+    {
+        added_label = avl_tree_get_data(added_label_node);
+    }
+    else
+    {
+        added_label_node = labels_table_insert_node(&(table->root), label_hash);
+        added_label = label_create(label_name);
+
+        label_set_base_address(added_label, is_entry ? -1 : 0);
+        avl_tree_set_data(added_label_node, added_label);
+    }
+
+    attributes = label_get_attributes(added_label);
+    if (is_entry && !(attributes & EXTERN_FLAG))
+    {
+        ++(table->entry_count);
+        if (!(attributes & ENTRY_FLAG))
+        {
+            labels_table_export(&(table->entries), added_label);
+        }
+        label_add_attribute(added_label, ENTRY_FLAG);
+    }
+    else if (!is_entry && !(attributes & EXTERN_FLAG))
+    {
+        ++(table->extern_count);
+        labels_table_export(&(table->externs), added_label);
+        label_set_attributes(added_label, EXTERN_FLAG);
+        label_set_base_address(added_label, 0);
+    }
+    else 
+    {
+        errors_print_line(CONTRARY_LABEL_ATTRIBUTES);
+    }
+}
+
+void labels_table_add_entry_or_extern_labels(labels_table_t *table, char *line, bool is_entry)
+{
     char label_name[LABEL_MAX_LENGTH];
     char scanned;
-    uint8_t attributes;
 
     scanned = sscanf(line, "%s", label_name);
     if (scanned && IS_VALID_LABEL(label_name))
     {
-        label_hash = hash(label_name);
-        if ((added_label_node = avl_tree_search_node(table->root, label_hash)))
+        if (table->is_journaling)
         {
-            added_label = avl_tree_get_data(added_label_node);
+            labels_table_journal(table, is_entry ? JOURNAL_ENTRY : JOURNAL_EXTERN, label_name, 0, 0, NULL);
         }
         else
         {
-            added_label_node = labels_table_insert_node(&(table->root), label_hash);
-            added_label = label_create(label_name);
-
-            label_set_base_address(added_label, is_entry ? -1 : 0);
-            avl_tree_set_data(added_label_node, added_label);
+            labels_table_set_entry_or_extern(table, label_name, is_entry);
         }
-
-        attributes = label_get_attributes(added_label);
-        if (is_entry && !(attributes & EXTERN_FLAG))
+    }
+    else
+    {
+        if (!scanned)
         {
-            ++(table->entry_count);
-            label_add_attribute(added_label, ENTRY_FLAG);
+            errors_print_line(MISSING_ARGUMENTS);
         }
-        else if (!is_entry && !(attributes & EXTERN_FLAG))
+        else
         {
-            ++(table->extern_count);
-            label_set_attributes(added_label, EXTERN_FLAG);
-            label_set_base_address(added_label, 0);
+            errors_print_line(INVALID_LABEL_NAME);
         }
-        else 
+    }
+}
+
+/**
+ * @brief copies an expression without the spaces (and the new line) that
+ * end it, so it is reported as it was written
+ *
+ * @param expression the expression
+ * @return char* the allocated copy
+ */
+static char *labels_table_copy_expression(char *expression)
+{
+    char *copy;
+    size_t length = strlen(expression);
+
+    while (length > 0 && isspace(expression[length - 1]))
+    {
+        --length;
+    }
+    copy = asm_alloc_malloc(ALLOC_LABELS, length + 1);
+    assert("Memory allocation failed" && copy != NULL);
+    memcpy(copy, expression, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+/**
+ * @brief creates the labels of the symbols of an expression (expression
+ * resolver), so the undefined ones are reported like any other label
+ *
+ * @param symbol the symbol
+ * @param value set to 0 (only the syntax of the expression is checked)
+ * @param table the labels table
+ * @return bool true
+ */
+static bool labels_table_force_symbol(char *symbol, long *value, void *table)
+{
+    labels_table_get_forced_label(table, symbol);
+    *value = 0;
+    return true;
+}
+
+/**
+ * @brief defines a constant (creating its label if needed)
+ *
+ * @param table the labels table
+ * @param name the name of the constant
+ * @param expression the value of the constant
+ */
+static void labels_table_define_constant(labels_table_t *table, char *name, char *expression)
+{
+    label_t *label;
+    constant_t *constant;
+
+    label = labels_table_get_forced_label(table, name);
+    if (label_get_base_address(label) != -1)
+    {
+        errors_print_line(MULTIPLE_LABEL_DEFINITIONS);
+        return;
+    }
+
+    if (table->constants_count == table->constants_capacity)
+    {
+        table->constants_capacity = table->constants_capacity ? table->constants_capacity << 1 : 16;
+        table->constants = asm_alloc_realloc(ALLOC_LABELS, table->constants, table->constants_capacity * sizeof(constant_t));
+        assert("Memory allocation failed" && table->constants != NULL);
+    }
+    constant = &(table->constants[table->constants_count]);
+    constant->label = label;
+    constant->expression = labels_table_copy_expression(expression);
+    constant->state = CONSTANT_UNEVALUATED;
+
+    label_set_base_address(label, table->constants_count++);
+    label_add_attribute(label, CONSTANT_FLAG);
+    expression_evaluate(expression, labels_table_force_symbol, table, NULL);
+}
+
+void labels_table_add_constant(labels_table_t *table, char *line)
+{
+    char name[LINE_LENGTH];
+    int name_length = 0;
+
+    name[0] = '\0';
+    sscanf(line, "%s%n", name, &name_length);
+    if (!name[0])
+    {
+        errors_print_line(MISSING_ARGUMENTS);
+    }
+    else if (strlen(name) > LABEL_MAX_LENGTH || !(IS_VALID_LABEL(name)))
+    {
+        errors_print_line(INVALID_LABEL_NAME);
+    }
+    else if (!expression_evaluate(line + name_length, NULL, NULL, NULL))
+    {
+        errors_print_line(INVALID_EXPRESSION);
+    }
+    else if (table->is_journaling)
+    {
+        labels_table_journal(table, JOURNAL_CONSTANT, name, 0, 0, line + name_length);
+    }
+    else
+    {
+        labels_table_define_constant(table, name, line + name_length);
+    }
+}
+
+void labels_table_add_fixup(labels_table_t *table, char *expression, int location, bool is_data)
+{
+    fixup_t *fixup;
+
+    if (table->is_journaling)
+    {
+        labels_table_journal(table, JOURNAL_FIXUP, "", location, is_data ? DATA_FLAG : CODE_FLAG, expression);
+        return;
+    }
+
+    if (table->fixups_count == table->fixups_capacity)
+    {
+        table->fixups_capacity = table->fixups_capacity ? table->fixups_capacity << 1 : 64;
+        table->fixups = asm_alloc_realloc(ALLOC_LABELS, table->fixups, table->fixups_capacity * sizeof(fixup_t));
+        assert("Memory allocation failed" && table->fixups != NULL);
+    }
+    fixup = &(table->fixups[table->fixups_count++]);
+    fixup->expression = labels_table_copy_expression(expression);
+    fixup->location = location;
+    fixup->is_data = is_data;
+    fixup->is_relocatable = false;
+    fixup->value = 0;
+
+    expression_evaluate(expression, labels_table_force_symbol, table, NULL);
+}
+
+void labels_table_replay_journal(labels_table_t *table, labels_table_t *journal_table, int ic_base, int pc_base)
+{
+    linked_list_node_t *node;
+    journal_entry_t *entry;
+
+    for (node = journal_table->journal; node; node = linked_list_get_next_address(node))
+    {
+        entry = linked_list_get_info(node);
+        switch (entry->kind)
         {
-            errors_print_line(CONTRARY_LABEL_ATTRIBUTES);
+        case JOURNAL_DEFINITION:
+            labels_table_add_definition_labels(entry->symbol, pc_base + entry->address, table, entry->segment_flag);
+            break;
+        case JOURNAL_ENTRY:
+        case JOURNAL_EXTERN:
+            labels_table_set_entry_or_extern(table, entry->symbol, entry->kind == JOURNAL_ENTRY);
+            break;
+        case JOURNAL_REFERENCE:
+            labels_table_add_reference(table, entry->symbol, ic_base + entry->address);
+            break;
+        case JOURNAL_CONSTANT:
+            labels_table_define_constant(table, entry->symbol, entry->text);
+            break;
+        case JOURNAL_FIXUP:
+            labels_table_add_fixup(table, entry->text, entry->address
+                                   + (entry->segment_flag == DATA_FLAG ? pc_base - ic_base : ic_base),
+                                   entry->segment_flag == DATA_FLAG);
+            break;
         }
     }
-    else
+}
+
+/**
+ * @brief sorts labels by their address, keeping the declaration order of
+ * labels with the same address (a two pass radix sort)
+ *
+ * @param labels the labels
+ * @param count the number of labels
+ */
+static void labels_table_sort_by_address(exported_label_t *labels, int count)
+{
+    exported_label_t *sorted;
+    int buckets[256];
+    int shift;
+    int bucket;
+    int position;
+    int i;
+
+    if (count == 0)
     {
-        if (!scanned)
+        return;
+    }
+    sorted = asm_alloc_malloc(ALLOC_LABELS, count * sizeof(exported_label_t));
+    assert("Memory allocation failed" && sorted != NULL);
+
+    for (shift = 0; shift < 16; shift += 8)
+    {
+        memset(buckets, 0, sizeof(buckets));
+        for (i = 0; i < count; i++)
         {
-            errors_print_line(MISSING_ARGUMENTS);
+            ++buckets[(labels[i].address >> shift) & 0xFF];
         }
-        else
+        for (bucket = 0, position = 0; bucket < 256; bucket++)
         {
-            errors_print_line(INVALID_LABEL_NAME);
+            i = buckets[bucket];
+            buckets[bucket] = position;
+            position += i;
         }
+        for (i = 0; i < count; i++)
+        {
+            sorted[buckets[(labels[i].address >> shift) & 0xFF]++] = labels[i];
+        }
+        memcpy(labels, sorted, count * sizeof(exported_label_t));
     }
+
+    asm_alloc_free(sorted);
 }
 
 /**
- * @brief writes the labels information in the proper file and format based
- * on the label type
- * @file labels_table.h
- * 
- * @param root the root of the labels table (avl tree)
- * @param ext_file the file containing the external labels
+ * @brief writes the entry labels sorted by their address
+ *
+ * @param table the labels table
  * @param ent_file the file containing the entry labels
  */
-static void labels_table_write_ext_and_ent(avl_node_t *root, FILE *ext_file, FILE *ent_file)
+static void labels_table_write_entries(labels_table_t *table, FILE *ent_file)
 {
+    exported_label_t *labels;
     label_t *label;
-    int attribute;
+    int count = 0;
+    int i;
 
-    if (!root)
-        return;
+    labels = asm_alloc_malloc(ALLOC_LABELS, (table->entries.count + 1) * sizeof(exported_label_t));
+    assert("Memory allocation failed" && labels != NULL);
 
-    label = avl_tree_get_data(root);
-    attribute = label_get_attributes(label);
+    for (i = 0; i < table->entries.count; i++)
+    {
+        label = table->entries.labels[i];
+        /* a label that was declared extern afterwards is written only as extern */
+        if (!(label_get_attributes(label) & EXTERN_FLAG))
+        {
+            labels[count].address = label_get_base_address(label) + label_get_offset(label);
+            labels[count++].label = label;
+        }
+    }
+    labels_table_sort_by_address(labels, count);
 
-    if (attribute & EXTERN_FLAG)
+    for (i = 0; i < count; i++)
     {
-        asm_output_extern_label(ext_file, label);
+        asm_output_entry_label(ent_file, labels[i].label);
     }
-    else if (attribute & ENTRY_FLAG)
+    asm_alloc_free(labels);
+}
+
+/**
+ * @brief writes the references to the extern labels sorted by their address
+ *
+ * @param table the labels table
+ * @param ext_file the file containing the external labels
+ */
+static void labels_table_write_externs(labels_table_t *table, FILE *ext_file)
+{
+    exported_label_t *references = NULL;
+    linked_list_node_t *lines;
+    int capacity = 0;
+    int count = 0;
+    int i;
+
+    for (i = 0; i < table->externs.count; i++)
     {
-        asm_output_entry_label(ent_file, label);
+        for (lines = label_get_lines(table->externs.labels[i]); lines; lines = linked_list_get_next_address(lines))
+        {
+            if (count == capacity)
+            {
+                capacity = capacity ? capacity << 1 : 64;
+                references = asm_alloc_realloc(ALLOC_LABELS, references, capacity * sizeof(exported_label_t));
+                assert("Memory allocation failed" && references != NULL);
+            }
+            references[count].address = *((int *)linked_list_get_info(lines));
+            references[count++].label = table->externs.labels[i];
+        }
     }
+    labels_table_sort_by_address(references, count);
 
-    labels_table_write_ext_and_ent(avl_tree_get_left_child(root), ext_file, ent_file);
-    labels_table_write_ext_and_ent(avl_tree_get_right_child(root), ext_file, ent_file);
+    for (i = 0; i < count; i++)
+    {
+        asm_output_extern_reference(ext_file, label_get_symbol(references[i].label), references[i].address);
+    }
+    asm_alloc_free(references);
 }
 
 void labels_table_write_ext_and_ent_proxy(labels_table_t *table, FILE *ext_file, FILE *ent_file)
 {
-    if (table->entry_count)
+    if (ext_file)
     {
-        assert("Entry file isn't open" && ent_file);
+        labels_table_write_externs(table, ext_file);
     }
-    else if (table->extern_count)
+    if (ent_file)
     {
-        assert("Extern file isn't open" && ext_file);
+        labels_table_write_entries(table, ent_file);
     }
-    labels_table_write_ext_and_ent(table->root, ext_file, ent_file);
 }
 
 /**
@@ -286,9 +784,60 @@ static void labels_table_insert_labels_to_memory(avl_node_t *root, memory_t *mem
 
 void labels_table_insert_labels_to_memory_proxy(labels_table_t *table, memory_t *memory)
 {
+    int fixup;
+
+    for (fixup = 0; fixup < table->fixups_count; fixup++)
+    {
+        if (table->fixups[fixup].is_data)
+        {
+            asm_memory_rewrite_data(memory, table->fixups[fixup].value, A, table->fixups[fixup].location);
+        }
+        else
+        {
+            asm_memory_rewrite_code(memory, table->fixups[fixup].value, A, table->fixups[fixup].location);
+        }
+    }
     labels_table_insert_labels_to_memory(table->root, memory);
 }
 
+/**
+ * @brief adds the labels of a subtree to the symbols
+ * 
+ * @param table the labels table
+ * @param root the root of the subtree
+ * @param symbols the symbols
+ */
+static void labels_table_export_subtree(labels_table_t *table, avl_node_t *root, asm_symbols_t *symbols)
+{
+    label_t *label;
+    linked_list_node_t *lines;
+    unsigned int references = 0;
+    long value;
+
+    if (!root)
+        return;
+
+    label = avl_tree_get_data(root);
+    if (label_get_base_address(label) != -1)
+    {
+        for (lines = label_get_lines(label); lines; lines = linked_list_get_next_address(lines))
+        {
+            ++references;
+        }
+        value = (label_get_attributes(label) & CONSTANT_FLAG)
+                ? table->constants[label_get_base_address(label)].value
+                : label_get_base_address(label) + (long)label_get_offset(label);
+        asm_symbols_add(symbols, label_get_symbol(label), value, label_get_attributes(label), references);
+    }
+
+    labels_table_export_subtree(table, avl_tree_get_left_child(root), symbols);
+    labels_table_export_subtree(table, avl_tree_get_right_child(root), symbols);
+}
+
+void labels_table_export_symbols(labels_table_t *table, asm_symbols_t *symbols)
+{
+    labels_table_export_subtree(table, table->root, symbols);
+}
 
 /**
  * @brief prints a level of the avl tree
@@ -343,16 +892,187 @@ static void labels_table_check_labels_validity(avl_node_t *root)
     label = avl_tree_get_data(root);
     if (label_get_base_address(label) == -1)
     {
-        printf("Undefined label \"%s\"\n", label_get_symbol(label));
+        errors_print_symbol(UNDEFINED_LABEL, label_get_symbol(label));
+    }
+    else if ((label_get_attributes(label) & CONSTANT_FLAG) && label_get_lines(label))
+    {
+        /* a constant has no address, it is used as an immediate */
+        errors_print_symbol(INVALID_ARGUMENT, label_get_symbol(label));
     }
 
     labels_table_check_labels_validity(avl_tree_get_left_child(root));
     labels_table_check_labels_validity(avl_tree_get_right_child(root));
 }
 
+/**
+ * @brief evaluates a constant (once) with the values of the labels
+ *
+ * @param constant the constant
+ * @param resolution the evaluation it is a part of
+ */
+static void labels_table_evaluate_constant(constant_t *constant, resolution_t *resolution);
+
+/**
+ * @brief returns the value of a symbol of an expression, the address of a
+ * label or the value of a constant (expression resolver)
+ *
+ * @param symbol the symbol
+ * @param value set to the value of the symbol
+ * @param resolution the evaluation the symbol is a part of
+ * @return bool false if the symbol has no value
+ */
+static bool labels_table_resolve_symbol(char *symbol, long *value, void *resolution)
+{
+    resolution_t *current = resolution;
+    label_t *label;
+    constant_t *constant;
+
+    label = labels_table_does_label_exist(current->table, symbol);
+    if (!label || label_get_base_address(label) == -1)
+    {
+        current->is_reported = true; /* an undefined label */
+        return false;
+    }
+    if (label_get_attributes(label) & EXTERN_FLAG)
+    {
+        return false; /* its address is known only when linking */
+    }
+    if (!(label_get_attributes(label) & CONSTANT_FLAG))
+    {
+        *value = label_get_base_address(label) + label_get_offset(label) + current->delta;
+        return true;
+    }
+
+    constant = &(current->table->constants[label_get_base_address(label)]);
+    if (constant->state == CONSTANT_UNEVALUATED)
+    {
+        labels_table_evaluate_constant(constant, current);
+    }
+    else if (constant->state == CONSTANT_FAILED)
+    {
+        current->is_reported = true;
+    }
+    else if (constant->state == CONSTANT_EVALUATED && current->delta != 0)
+    {
+        /* the cached value is the one of the labels where they are (and the constant has no cycle) */
+        return expression_evaluate(constant->expression, labels_table_resolve_symbol, current, value);
+    }
+    *value = constant->value;
+
+    return constant->state == CONSTANT_EVALUATED;
+}
+
+static void labels_table_evaluate_constant(constant_t *constant, resolution_t *resolution)
+{
+    constant->state = CONSTANT_EVALUATING; /* a constant that depends on itself fails */
+    constant->state = expression_evaluate(constant->expression, labels_table_resolve_symbol, resolution, &(constant->value))
+                    ? CONSTANT_EVALUATED : CONSTANT_FAILED;
+}
+
 void labels_table_check_labels_validity_proxy(labels_table_t *table)
 {
+    resolution_t resolution;
+    int index;
+
     labels_table_check_labels_validity(table->root);
+
+    resolution.table = table;
+    resolution.delta = 0;
+    for (index = 0; index < table->constants_count; index++)
+    {
+        resolution.is_reported = false;
+        if (table->constants[index].state == CONSTANT_UNEVALUATED)
+        {
+            labels_table_evaluate_constant(&(table->constants[index]), &resolution);
+            if (table->constants[index].state == CONSTANT_FAILED && !resolution.is_reported)
+            {
+                errors_print_symbol(INVALID_EXPRESSION, label_get_symbol(table->constants[index].label));
+            }
+        }
+    }
+    for (index = 0; index < table->fixups_count; index++)
+    {
+        resolution.is_reported = false;
+        if (!expression_evaluate(table->fixups[index].expression, labels_table_resolve_symbol, &resolution,
+                                 &(table->fixups[index].value)) && !resolution.is_reported)
+        {
+            errors_print_symbol(INVALID_EXPRESSION, table->fixups[index].expression);
+        }
+    }
+}
+
+/**
+ * @brief evaluates a fixup again with the labels moved by a distance
+ *
+ * @param table the labels table
+ * @param fixup the fixup
+ * @param delta the distance
+ * @param value set to the value of the fixup
+ * @return bool false if the fixup has no value there
+ */
+static bool labels_table_evaluate_moved_fixup(labels_table_t *table, fixup_t *fixup, long delta, long *value)
+{
+    resolution_t resolution;
+
+    resolution.table = table;
+    resolution.delta = delta;
+    resolution.is_reported = false;
+    return expression_evaluate(fixup->expression, labels_table_resolve_symbol, &resolution, value);
+}
+
+void labels_table_check_relocations(labels_table_t *table)
+{
+    fixup_t *fixup;
+    label_t *label;
+    long moved;
+    long far_moved;
+    int index;
+
+    for (index = 0; index < table->fixups_count; index++)
+    {
+        fixup = &(table->fixups[index]);
+        if (!labels_table_evaluate_moved_fixup(table, fixup, 1, &moved)
+            || !labels_table_evaluate_moved_fixup(table, fixup, RELOCATION_DELTA, &far_moved))
+        {
+            errors_print_symbol(INVALID_RELOCATION, fixup->expression);
+            continue;
+        }
+        /* an absolute value doesn't move, a relocatable one moves exactly as far as the labels */
+        fixup->is_relocatable = moved - fixup->value == 1 && far_moved - fixup->value == RELOCATION_DELTA;
+        if (!fixup->is_relocatable && (moved != fixup->value || far_moved != fixup->value))
+        {
+            errors_print_symbol(INVALID_RELOCATION, fixup->expression);
+        }
+    }
+
+    /* the .ent file is moved with the program, so its labels must be addresses */
+    for (index = 0; index < table->entries.count; index++)
+    {
+        label = table->entries.labels[index];
+        if ((label_get_attributes(label) & CONSTANT_FLAG) && !(label_get_attributes(label) & EXTERN_FLAG))
+        {
+            errors_print_symbol(INVALID_RELOCATION, label_get_symbol(label));
+        }
+    }
+}
+
+void labels_table_write_relocations(labels_table_t *table, FILE *rel_file)
+{
+    int count = 0;
+    int index;
+
+    for (index = 0; index < table->fixups_count; index++)
+    {
+        count += table->fixups[index].is_relocatable;
+    }
+    fprintf(rel_file, "%d\n", count);
+    for (index = 0; index < table->fixups_count; index++)
+    {
+        if (table->fixups[index].is_relocatable)
+        {
+            asm_output_relocatable_expression(rel_file, table->fixups[index].location, table->fixups[index].is_data);
+        }
+    }
 }
 
 /**
@@ -369,12 +1089,57 @@ static void labels_table_destroy_avl_tree(avl_node_t *root)
     labels_table_destroy_avl_tree(avl_tree_get_right_child(root));
 
     label_destroy_lines(avl_tree_get_data(root));
-    free(avl_tree_get_data(root));
-    free(root);
+    asm_alloc_free(avl_tree_get_data(root));
+    asm_alloc_free(root);
+}
+
+/**
+ * @brief frees the constants and the fixups of the table
+ *
+ * @param table the labels table
+ */
+static void labels_table_destroy_expressions(labels_table_t *table)
+{
+    int index;
+
+    for (index = 0; index < table->constants_count; index++)
+    {
+        asm_alloc_free(table->constants[index].expression);
+    }
+    for (index = 0; index < table->fixups_count; index++)
+    {
+        asm_alloc_free(table->fixups[index].expression);
+    }
+    table->constants_count = 0;
+    table->fixups_count = 0;
+}
+
+void labels_table_reset(labels_table_t *table)
+{
+    labels_table_destroy_expressions(table);
+    labels_table_destroy_journal(table);
+    table->is_journaling = false;
+    table->is_position_dependent = false;
+    labels_table_destroy_avl_tree(table->root);
+    table->root = NULL;
+    table->extern_count = 0;
+    table->entry_count = 0;
+    table->entries.count = 0;
+    table->externs.count = 0;
 }
 
 void labels_table_destroy(labels_table_t *table)
 {
+    if (table == label_table_instance)
+    {
+        label_table_instance = NULL;
+    }
+    labels_table_destroy_journal(table);
+    labels_table_destroy_expressions(table);
     labels_table_destroy_avl_tree(table->root);
-    free(table);
+    asm_alloc_free(table->constants);
+    asm_alloc_free(table->fixups);
+    asm_alloc_free(table->entries.labels);
+    asm_alloc_free(table->externs.labels);
+    asm_alloc_free(table);
 }
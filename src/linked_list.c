@@ -30,7 +30,7 @@ void linked_list_push(linked_list_node_t **manager)
 {
 	linked_list_node_t *new_node;
 
-	new_node = (linked_list_node_t *)malloc(sizeof(linked_list_node_t));
+	new_node = (linked_list_node_t *)asm_alloc_malloc(ALLOC_LIST, sizeof(linked_list_node_t));
 	assert("Couldn't allocate new node for the linked list\n" && new_node != NULL);
 	new_node->next_address = *manager;
 	*manager = new_node;
@@ -40,7 +40,7 @@ void linked_list_insert_after_node(linked_list_node_t *node)
 {
 	linked_list_node_t *new_node;
 
-	new_node = (linked_list_node_t *)malloc(sizeof(linked_list_node_t));
+	new_node = (linked_list_node_t *)asm_alloc_malloc(ALLOC_LIST, sizeof(linked_list_node_t));
 	assert("Couldn't allocate new node for the linked list\n" && new_node != NULL);
 	new_node->next_address = node->next_address;
 	node->next_address = new_node;
@@ -51,7 +51,7 @@ void linked_list_pop(linked_list_node_t **manager)
 	linked_list_node_t *temp_node;
 	temp_node = *manager;
 	*manager = (*manager)->next_address;
-	free(temp_node);
+	asm_alloc_free(temp_node);
 }
 
 void linked_list_delete_after_node(linked_list_node_t *node)
@@ -59,7 +59,7 @@ void linked_list_delete_after_node(linked_list_node_t *node)
 	linked_list_node_t *temp_node;
 	temp_node = node->next_address;
 	node->next_address = temp_node->next_address;
-	free(temp_node);
+	asm_alloc_free(temp_node);
 }
 
 void linked_list_destroy(linked_list_node_t **manager)
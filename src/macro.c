@@ -1,4 +1,148 @@
+#define _POSIX_C_SOURCE 200809L
 #include "macro.h"
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define INCLUDE_DIRECTIVE ".include"
+#define SECTION_DIRECTIVE ".section"
+#define BSS_SECTION ".bss"
+#define IS_END_OF_WORD(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r' || (c) == '\0')
+
+typedef enum
+{
+    CONDITIONAL_NONE,
+    CONDITIONAL_IF,
+    CONDITIONAL_IFDEF,
+    CONDITIONAL_IFNDEF,
+    CONDITIONAL_ELSE,
+    CONDITIONAL_ENDIF
+} conditional_e;
+
+/* the conditionals of a file that is being expanded */
+typedef struct conditional_t
+{
+    int depth;           /* the conditionals that are open */
+    int skipped_depth;   /* the conditionals that were opened inside the skipped region */
+    bool is_skipping;
+    bool is_else_active; /* an .else of the skipped conditional ends the region */
+} conditional_t;
+
+/* a name given with -D */
+typedef struct definition_t
+{
+    char *name;
+    long value;
+    struct definition_t *next;
+} definition_t;
+
+typedef enum
+{
+    LAYOUT_CODE,
+    LAYOUT_DATA,
+    LAYOUT_BSS
+} layout_e;
+
+/* where a line that was passed on came from */
+typedef struct line_source_t
+{
+    unsigned int source_line;
+    line_origin_e origin;
+    char *file;             /* the file its text was read from (NULL for the source) */
+    unsigned int file_line; /* the line in that file */
+} line_source_t;
+
+/* a line of a macro or of an included file, with the place its text was read from */
+typedef struct macro_line_t
+{
+    char text[LINE_LENGTH];
+    char *file;        /* NULL for the source */
+    unsigned int line;
+} macro_line_t;
+
+/* a line that is written once the sections are laid out */
+typedef struct layout_line_t
+{
+    char text[LINE_LENGTH];
+    line_source_t source;
+    int section;
+    layout_e group;
+} layout_line_t;
+
+/* the lines of a file, grouped by their sections */
+typedef struct layout_t
+{
+    macro_line_handler_t handler;
+    void *context;
+    macro_includes_t *includes;    /* records where the passed lines came from */
+    layout_line_t *lines;
+    int count;
+    int capacity;
+    char (*sections)[LINE_LENGTH]; /* the names of the sections (the first is the unnamed section) */
+    int sections_count;
+    int sections_capacity;
+    int section;                   /* the section of the lines that are read */
+    bool is_buffering;             /* the lines are kept until the end of the file */
+    bool is_grouped;               /* the file has sections or reserved words */
+} layout_t;
+
+typedef struct include_t include_t;
+
+/* the macros a file can call */
+typedef struct macro_scope_t
+{
+    macro_t macros;               /* the macros the file defines */
+    linked_list_node_t *includes; /* the files it included (the last one first) */
+    macro_includes_t *dependencies; /* collects the included files (NULL inside an include) */
+    char *directory;              /* the includes are relative to it (NULL for the working directory) */
+    char *path;                   /* the file (NULL for the source), owned by its include */
+} macro_scope_t;
+
+/* a file that was included, parsed once and then only read */
+struct include_t
+{
+    char *path;
+    struct stat status;           /* the file when it was parsed */
+    macro_scope_t scope;
+    linked_list_node_t *lines;    /* the lines it adds, with its macros opened */
+    linked_list_node_t *lines_tail;
+    int references;               /* the cache, the files that include it and the sources that read it */
+    unsigned long generation;     /* the defined names it was parsed with */
+    bool is_parsing;
+    include_t *next;
+};
+
+struct macro_includes_t
+{
+    char *directory;
+    include_t *prelude;           /* the macros every source can call (NULL if there are none) */
+    include_t **files;            /* every file the source included, directly or not */
+    int count;
+    int capacity;
+    line_source_t *origins;       /* the origin of every line the source was expanded to */
+    int origins_count;
+    int origins_capacity;
+};
+
+/* the source line of the line that is being opened, per expanding thread */
+static __thread unsigned int source_line;
+static __thread line_origin_e line_origin;
+/* the file and the line the text of the line that is being opened was read from */
+static __thread char *origin_file;
+static __thread unsigned int origin_line;
+static __thread macro_includes_t *includes_instance;
+
+/* the current version of every included file, shared by every thread. A
+ * version that was replaced is freed once the last thread that reads it is done */
+static include_t *include_cache;
+static pthread_mutex_t include_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the names are defined between files, so the expanding threads only read them.
+ * Every change starts a new generation, and the includes of an older one are parsed again */
+static definition_t *definitions;
+static unsigned long definitions_generation;
+
+static const char *conditional_directives[] = {"", ".if", ".ifdef", ".ifndef", ".else", ".endif"};
+static const int conditional_lengths[] = {0, 3, 6, 7, 5, 6};
 
 /**
  * @brief checks if a macro is defined in the given line and
@@ -14,6 +158,7 @@ static bool macro_is_definition(char **line)
     char word[LINE_LENGTH];
     int word_length;
     
+    word[0] = '\0';
     sscanf(*line, "%s%n", word, &word_length);
     definition = strcmp(word, "macro") == 0;
     if (definition)
@@ -34,6 +179,7 @@ static bool macro_is_definition(char **line)
 static bool macro_is_end_of_macro(char *line)
 {
     char word[LINE_LENGTH];
+    word[0] = '\0';
     sscanf(line, "%s", word);
     return strcmp(word, "endm") == 0;
 }
@@ -58,50 +204,37 @@ static macro_t macro_insert_node(macro_t *root, unsigned long macro_hash)
  * @brief allocates a line to be used in the linked list that contains
  * the lines of the macro
  * 
- * @return char* the allocated line
+ * @return macro_line_t* the allocated line
  */
-static char* macro_create_content_line()
+static macro_line_t* macro_create_content_line()
 {
-    char* macro_content;
-    macro_content = (char*)malloc(sizeof(char) * LINE_LENGTH);
+    macro_line_t* macro_content;
+    macro_content = (macro_line_t*)asm_alloc_malloc(ALLOC_MACRO, sizeof(macro_line_t));
 	assert("Couldn't allocate new line for the macro\n" && macro_content);
 
     return macro_content;
 }
 
 /**
- * @brief adds a macro to the macros table (avl tree)
- * 
- * @param fp the file that contains the macro's content
- * @param line the line in which the macro is defined
- * @param root the root of the macros table
+ * @brief searches a macro in the file's own macros and then in the files
+ * it included, so that a later definition hides an earlier one
+ *
+ * @param scope the macros the file can call
+ * @param macro_hash the hash of the macro name
+ * @return macro_t the macro node (NULL if there isn't one)
  */
-static void macro_add_to_table(FILE *fp, char *line, macro_t *root)
+static macro_t macro_find(macro_scope_t *scope, unsigned long macro_hash)
 {
-    char macro_name[LINE_LENGTH];
-    macro_t added_macro;
-    linked_list_node_t *macro_linked_list_manager;
-    char* macro_content;
-
-    macro_linked_list_manager = NULL;
-    sscanf(line, "%s", macro_name);
-    added_macro = macro_insert_node(root, hash(macro_name));
-
-    macro_content = macro_create_content_line();
-    fgets(macro_content, LINE_LENGTH, fp);
-
-    linked_list_push(&macro_linked_list_manager);
-    linked_list_set_info(macro_linked_list_manager, macro_content);
-    avl_tree_set_data(added_macro, macro_linked_list_manager);
+    macro_t found;
+    linked_list_node_t *include;
 
-    macro_content = macro_create_content_line();
-    while (fgets(macro_content, LINE_LENGTH, fp) && !macro_is_end_of_macro(macro_content))
+    found = avl_tree_search_node(scope->macros, macro_hash);
+    for (include = scope->includes; include && !found; include = linked_list_get_next_address(include))
     {
-        linked_list_insert_after_node(macro_linked_list_manager);
-        macro_linked_list_manager = linked_list_get_next_address(macro_linked_list_manager);
-        linked_list_set_info(macro_linked_list_manager, macro_content);
-        macro_content = macro_create_content_line();
+        found = macro_find(&(((include_t*)linked_list_get_info(include))->scope), macro_hash);
     }
+
+    return found;
 }
 
 /**
@@ -109,30 +242,37 @@ static void macro_add_to_table(FILE *fp, char *line, macro_t *root)
  * (searches the macros table). if so, it returns the macro node
  * 
  * @param line the line that is suspected to contain a macro call
- * @param root the root of the macros table
+ * @param scope the macros the file can call
  * @return macro_t the macro node
  */
-static macro_t macro_is_called(char* line, macro_t root)
+static macro_t macro_is_called(char* line, macro_scope_t *scope)
 {
     char word[LINE_LENGTH];
+    word[0] = '\0';
     sscanf(line, "%s", word);
-    return avl_tree_search_node(root, hash(word));
+    return macro_find(scope, hash(word));
 }
 
 /**
- * @brief opens the given macro's content into the given file
+ * @brief opens the given macro's content by passing each of its lines
+ * to the line handler
  * 
- * @param output the file in which the macro is opened
- * @param relevant_macro the macro that its content is being copied to the file
+ * @param handler the handler that receives the macro lines
+ * @param context the context given to the handler
+ * @param relevant_macro the macro that its content is being opened
  */
-static void macro_open_content(FILE *output, macro_t relevant_macro)
+static void macro_open_content(macro_line_handler_t handler, void *context, macro_t relevant_macro)
 {
     linked_list_node_t *macro_linked_list_node;
+    macro_line_t *content;
 
     macro_linked_list_node = avl_tree_get_data(relevant_macro);
     while (macro_linked_list_node)
     {
-        fputs(linked_list_get_info(macro_linked_list_node), output);
+        content = linked_list_get_info(macro_linked_list_node);
+        origin_file = content->file;
+        origin_line = content->line;
+        handler(content->text, context);
         macro_linked_list_node = linked_list_get_next_address(macro_linked_list_node);
     }
 }
@@ -150,7 +290,7 @@ static void macro_destroy_linked_list(linked_list_node_t **manager)
 
 	while (*start)
 	{
-        free(linked_list_get_info(*start));
+        asm_alloc_free(linked_list_get_info(*start));
 		linked_list_pop(start);
 	}
 }
@@ -173,33 +313,1066 @@ static void macro_destroy_avl_tree(macro_t root)
     list = avl_tree_get_data(root);
 
     macro_destroy_linked_list(&list);
-    free(root);
+    asm_alloc_free(root);
 }
 
-void macro_write_am_file(FILE* current_file, FILE *am_file)
+/**
+ * @brief writes a line with its macros opened to the am file
+ * 
+ * @param line the line
+ * @param am_file the am file
+ */
+static void macro_write_line(char *line, void *am_file)
+{
+    fputs(line, (FILE*)am_file);
+}
+
+/**
+ * @brief reads the name of the included file from an include line
+ *
+ * @param line the line
+ * @param name the name of the included file
+ * @return bool true if the line is an include with a quoted name
+ */
+static bool macro_is_include(char *line, char *name)
+{
+    char word[LINE_LENGTH];
+    int word_length;
+
+    word[0] = '\0';
+    sscanf(line, "%s%n", word, &word_length);
+    return strcmp(word, INCLUDE_DIRECTIVE) == 0
+        && sscanf(line + word_length, " \"%[^\"]\"", name) == 1;
+}
+
+/**
+ * @brief adds a line to the lines of an included file (macro line handler)
+ *
+ * @param line the line
+ * @param include the included file
+ */
+static void macro_add_include_line(char *line, void *include)
+{
+    include_t *current = include;
+    macro_line_t *copy;
+
+    copy = macro_create_content_line();
+    strcpy(copy->text, line);
+    copy->file = origin_file;
+    copy->line = origin_line;
+    if (current->lines_tail)
+    {
+        linked_list_insert_after_node(current->lines_tail);
+        current->lines_tail = linked_list_get_next_address(current->lines_tail);
+    }
+    else
+    {
+        linked_list_push(&(current->lines));
+        current->lines_tail = current->lines;
+    }
+    linked_list_set_info(current->lines_tail, copy);
+}
+
+/**
+ * @brief returns the directory of a path
+ *
+ * @param path the path
+ * @return char* the allocated directory (NULL if the path has none)
+ */
+static char *macro_get_directory(char *path)
+{
+    char *separator;
+    char *directory;
+
+    if (!path || !(separator = strrchr(path, '/')))
+    {
+        return NULL;
+    }
+    directory = asm_alloc_malloc(ALLOC_MACRO, separator - path + 1);
+    assert("Memory allocation failed" && directory != NULL);
+    memcpy(directory, path, separator - path);
+    directory[separator - path] = '\0';
+
+    return directory;
+}
+
+static void macro_expand_scope(FILE *current_file, macro_scope_t *scope, macro_line_handler_t handler, void *context);
+
+/**
+ * @brief adds a reference to an included file
+ *
+ * @param include the included file
+ * @return include_t* the included file
+ */
+static include_t *macro_retain_include(include_t *include)
+{
+    __atomic_add_fetch(&(include->references), 1, __ATOMIC_RELAXED);
+    return include;
+}
+
+/**
+ * @brief removes a reference to an included file, and frees it (and
+ * releases the files it included) if it was the last one
+ *
+ * @param include the included file
+ */
+static void macro_release_include(include_t *include)
+{
+    linked_list_node_t *nested;
+
+    if (__atomic_sub_fetch(&(include->references), 1, __ATOMIC_ACQ_REL) > 0)
+    {
+        return;
+    }
+    for (nested = include->scope.includes; nested; nested = linked_list_get_next_address(nested))
+    {
+        macro_release_include(linked_list_get_info(nested));
+    }
+    macro_destroy_avl_tree(include->scope.macros);
+    linked_list_destroy(&(include->scope.includes));
+    macro_destroy_linked_list(&(include->lines));
+    asm_alloc_free(include->scope.directory);
+    asm_alloc_free(include->path);
+    asm_alloc_free(include);
+}
+
+/**
+ * @brief checks that an included file and every file it included are
+ * the same as when they were parsed, with the same defined names
+ *
+ * @param include the included file
+ * @return bool true if none of them changed
+ */
+static bool macro_is_include_current(include_t *include)
+{
+    struct stat status;
+    linked_list_node_t *nested;
+
+    if (include->generation != definitions_generation || stat(include->path, &status) != 0 || include->status.st_size != status.st_size
+        || include->status.st_mtim.tv_sec != status.st_mtim.tv_sec
+        || include->status.st_mtim.tv_nsec != status.st_mtim.tv_nsec)
+    {
+        return false;
+    }
+    for (nested = include->scope.includes; nested; nested = linked_list_get_next_address(nested))
+    {
+        if (!macro_is_include_current(linked_list_get_info(nested)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief returns the parsed included file, parsing it if it isn't cached or
+ * if it (or a file it included) changed since it was parsed (the include
+ * lock must be held)
+ *
+ * @param path the path of the included file
+ * @return include_t* the included file with a reference for the caller
+ * (NULL if it can't be included)
+ */
+static include_t *macro_get_include(char *path)
+{
+    include_t *include;
+    include_t **link;
+    struct stat status;
+    unsigned int including_line;
+    FILE *file;
+
+    for (link = &include_cache; *link && strcmp((*link)->path, path) != 0; link = &((*link)->next))
+        ;
+    if ((include = *link))
+    {
+        /* a file that includes itself isn't opened again */
+        if (include->is_parsing)
+        {
+            return NULL;
+        }
+        if (macro_is_include_current(include))
+        {
+            return macro_retain_include(include);
+        }
+        /* the threads that still read the old version keep it until they are done */
+        *link = include->next;
+        macro_release_include(include);
+    }
+    if (stat(path, &status) != 0 || !(file = fopen(path, "r")))
+    {
+        return NULL;
+    }
+
+    include = asm_alloc_calloc(ALLOC_MACRO, 1, sizeof(include_t));
+    assert("Memory allocation failed" && include != NULL);
+    include->path = asm_alloc_malloc(ALLOC_MACRO, strlen(path) + 1);
+    assert("Memory allocation failed" && include->path != NULL);
+    strcpy(include->path, path);
+    include->status = status;
+    include->scope.directory = macro_get_directory(path);
+    include->scope.path = include->path;
+    include->references = 2; /* the cache and the caller */
+    include->generation = definitions_generation;
+    include->next = include_cache;
+    include_cache = include;
+
+    include->is_parsing = true;
+    including_line = source_line;
+    source_line = 0; /* the lines of the included file are counted in it */
+    macro_expand_scope(file, &(include->scope), macro_add_include_line, include);
+    source_line = including_line;
+    include->is_parsing = false;
+    fclose(file);
+
+    return include;
+}
+
+/**
+ * @brief adds an included file and the files it included to the
+ * dependencies of the source
+ *
+ * @param includes the dependencies of the source
+ * @param include the included file
+ */
+static void macro_add_dependency(macro_includes_t *includes, include_t *include)
+{
+    linked_list_node_t *nested;
+    int file;
+
+    for (file = 0; file < includes->count; file++)
+    {
+        if (strcmp(includes->files[file]->path, include->path) == 0)
+        {
+            return;
+        }
+    }
+    if (includes->count == includes->capacity)
+    {
+        includes->capacity = includes->capacity ? includes->capacity << 1 : 8;
+        includes->files = asm_alloc_realloc(ALLOC_MACRO, includes->files, includes->capacity * sizeof(include_t*));
+        assert("Memory allocation failed" && includes->files != NULL);
+    }
+    includes->files[includes->count++] = macro_retain_include(include);
+
+    for (nested = include->scope.includes; nested; nested = linked_list_get_next_address(nested))
+    {
+        macro_add_dependency(includes, linked_list_get_info(nested));
+    }
+}
+
+/**
+ * @brief releases the included files of a source
+ *
+ * @param includes the dependencies of the source
+ */
+static void macro_clear_dependencies(macro_includes_t *includes)
+{
+    while (includes->count > 0)
+    {
+        macro_release_include(includes->files[--(includes->count)]);
+    }
+}
+
+/**
+ * @brief includes a file in the scope of the including file
+ *
+ * @param scope the macros of the including file
+ * @param name the name of the included file as written
+ * @return include_t* the included file (NULL if it can't be included)
+ */
+static include_t *macro_include(macro_scope_t *scope, char *name)
+{
+    include_t *include;
+    char *path;
+
+    path = asm_alloc_malloc(ALLOC_MACRO, (scope->directory ? strlen(scope->directory) : 0) + strlen(name) + 2);
+    assert("Memory allocation failed" && path != NULL);
+    if (scope->directory && name[0] != '/')
+    {
+        sprintf(path, "%s/%s", scope->directory, name);
+    }
+    else
+    {
+        strcpy(path, name);
+    }
+
+    /* only the outermost file takes the lock, nested includes are parsed under it */
+    if (scope->dependencies)
+    {
+        pthread_mutex_lock(&include_lock);
+    }
+    include = macro_get_include(path);
+    if (scope->dependencies)
+    {
+        pthread_mutex_unlock(&include_lock);
+    }
+    asm_alloc_free(path);
+
+    if (include)
+    {
+        /* the scope keeps the reference it got */
+        linked_list_push(&(scope->includes));
+        linked_list_set_info(scope->includes, include);
+        if (scope->dependencies)
+        {
+            macro_add_dependency(scope->dependencies, include);
+        }
+    }
+
+    return include;
+}
+
+/**
+ * @brief passes the lines of an included file to the line handler
+ *
+ * @param handler the handler that receives the lines
+ * @param context the context given to the handler
+ * @param include the included file
+ */
+static void macro_open_include(macro_line_handler_t handler, void *context, include_t *include)
+{
+    linked_list_node_t *line;
+    macro_line_t *content;
+
+    for (line = include->lines; line; line = linked_list_get_next_address(line))
+    {
+        content = linked_list_get_info(line);
+        origin_file = content->file;
+        origin_line = content->line;
+        handler(content->text, context);
+    }
+}
+
+/**
+ * @brief returns the conditional directive a line starts with. Only the
+ * first characters are compared, so it is cheap enough for every skipped
+ * line
+ *
+ * @param line the line
+ * @param operand set to the text after the directive
+ * @return conditional_e the directive (CONDITIONAL_NONE if there isn't one)
+ */
+static conditional_e macro_get_conditional(char *line, char **operand)
+{
+    int kind;
+
+    while (*line == ' ' || *line == '\t')
+    {
+        ++line;
+    }
+    if (*line != '.')
+    {
+        return CONDITIONAL_NONE;
+    }
+
+    for (kind = CONDITIONAL_IF; kind <= CONDITIONAL_ENDIF; kind++)
+    {
+        if (strncmp(line, conditional_directives[kind], conditional_lengths[kind]) == 0
+            && IS_END_OF_WORD(line[conditional_lengths[kind]]))
+        {
+            *operand = line + conditional_lengths[kind];
+            return kind;
+        }
+    }
+
+    return CONDITIONAL_NONE;
+}
+
+/**
+ * @brief searches a name that was given with -D
+ *
+ * @param name the name
+ * @return definition_t* the definition (NULL if the name isn't defined)
+ */
+static definition_t *macro_find_definition(char *name)
+{
+    definition_t *definition;
+
+    for (definition = definitions; definition; definition = definition->next)
+    {
+        if (strcmp(definition->name, name) == 0)
+        {
+            break;
+        }
+    }
+
+    return definition;
+}
+
+/**
+ * @brief returns the value of a term of an .if condition, a number or a
+ * name given with -D (0 if it isn't defined)
+ *
+ * @param term the term
+ * @return long the value
+ */
+static long macro_get_term_value(char *term)
+{
+    definition_t *definition;
+
+    if (isdigit(*term) || *term == '-' || *term == '+')
+    {
+        return atol(term);
+    }
+    definition = macro_find_definition(term);
+
+    return definition ? definition->value : 0;
+}
+
+/**
+ * @brief evaluates the condition of a conditional directive. .if accepts a
+ * term or two terms compared with == or !=
+ *
+ * @param kind the directive
+ * @param operand the text after the directive
+ * @return bool true if the region after the directive is assembled
+ */
+static bool macro_is_condition_true(conditional_e kind, char *operand)
+{
+    char left[LINE_LENGTH];
+    char comparison[LINE_LENGTH];
+    char right[LINE_LENGTH];
+    int scanned;
+
+    left[0] = '\0';
+    scanned = sscanf(operand, "%s %s %s", left, comparison, right);
+    if (kind == CONDITIONAL_IFDEF || kind == CONDITIONAL_IFNDEF)
+    {
+        return (macro_find_definition(left) != NULL) == (kind == CONDITIONAL_IFDEF);
+    }
+    if (scanned == 3 && strcmp(comparison, "==") == 0)
+    {
+        return macro_get_term_value(left) == macro_get_term_value(right);
+    }
+    if (scanned == 3 && strcmp(comparison, "!=") == 0)
+    {
+        return macro_get_term_value(left) != macro_get_term_value(right);
+    }
+
+    return scanned == 1 && macro_get_term_value(left) != 0;
+}
+
+/**
+ * @brief follows the nesting of the conditionals inside a skipped region
+ * and ends the region at its .else or .endif
+ *
+ * @param conditional the conditionals of the file
+ * @param kind the conditional directive of the skipped line
+ */
+static void macro_skip_line(conditional_t *conditional, conditional_e kind)
+{
+    switch (kind)
+    {
+    case CONDITIONAL_IF:
+    case CONDITIONAL_IFDEF:
+    case CONDITIONAL_IFNDEF:
+        ++(conditional->skipped_depth);
+        break;
+    case CONDITIONAL_ELSE:
+        if (conditional->skipped_depth == 0 && conditional->is_else_active)
+        {
+            conditional->is_skipping = false;
+        }
+        break;
+    case CONDITIONAL_ENDIF:
+        if (conditional->skipped_depth == 0)
+        {
+            conditional->is_skipping = false;
+            --(conditional->depth);
+        }
+        else
+        {
+            --(conditional->skipped_depth);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief handles a conditional directive of an assembled region
+ *
+ * @param conditional the conditionals of the file
+ * @param kind the directive
+ * @param operand the text after the directive
+ * @return bool false if the directive doesn't match an open conditional
+ * (it is then reported by the assembler)
+ */
+static bool macro_handle_conditional(conditional_t *conditional, conditional_e kind, char *operand)
+{
+    if (kind == CONDITIONAL_ELSE || kind == CONDITIONAL_ENDIF)
+    {
+        if (conditional->depth == 0)
+        {
+            return false;
+        }
+        if (kind == CONDITIONAL_ENDIF)
+        {
+            --(conditional->depth);
+        }
+        else
+        {
+            /* the region before the .else was assembled, so the rest is skipped */
+            conditional->is_skipping = true;
+            conditional->is_else_active = false;
+            conditional->skipped_depth = 0;
+        }
+    }
+    else
+    {
+        ++(conditional->depth);
+        if (!macro_is_condition_true(kind, operand))
+        {
+            conditional->is_skipping = true;
+            conditional->is_else_active = true;
+            conditional->skipped_depth = 0;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief adds a macro to the macros table (avl tree). The conditionals
+ * inside its content are evaluated while it is read, so only the lines of
+ * the regions that are assembled are kept
+ * 
+ * @param fp the file that contains the macro's content
+ * @param path the path of the file (NULL for the source)
+ * @param line the line in which the macro is defined
+ * @param root the root of the macros table
+ */
+static void macro_add_to_table(FILE *fp, char *path, char *line, macro_t *root)
+{
+    char macro_name[LINE_LENGTH];
+    macro_t added_macro;
+    linked_list_node_t *macro_linked_list_manager;
+    macro_line_t* macro_content;
+    char *operand;
+    conditional_t conditional;
+    conditional_e kind;
+    bool is_unclosed = false;
+
+    macro_linked_list_manager = NULL;
+    memset(&conditional, 0, sizeof(conditional_t));
+    sscanf(line, "%s", macro_name);
+    added_macro = macro_insert_node(root, hash(macro_name));
+
+    macro_content = macro_create_content_line();
+    while (!is_unclosed && fgets(macro_content->text, LINE_LENGTH, fp))
+    {
+        ++source_line;
+        macro_content->file = path;
+        macro_content->line = source_line;
+        if (macro_is_end_of_macro(macro_content->text))
+        {
+            if (conditional.depth == 0)
+            {
+                break;
+            }
+            /* a conditional that wasn't closed is reported where the macro is opened */
+            strcpy(macro_content->text, ".if\n");
+            is_unclosed = true;
+        }
+        else
+        {
+            operand = macro_content->text;
+            kind = macro_get_conditional(macro_content->text, &operand);
+            if (conditional.is_skipping)
+            {
+                macro_skip_line(&conditional, kind);
+                continue;
+            }
+            if (kind != CONDITIONAL_NONE && macro_handle_conditional(&conditional, kind, operand))
+            {
+                continue;
+            }
+        }
+        if (macro_linked_list_manager)
+        {
+            linked_list_insert_after_node(macro_linked_list_manager);
+            macro_linked_list_manager = linked_list_get_next_address(macro_linked_list_manager);
+        }
+        else
+        {
+            linked_list_push(&macro_linked_list_manager);
+            avl_tree_set_data(added_macro, macro_linked_list_manager);
+        }
+        linked_list_set_info(macro_linked_list_manager, macro_content);
+        macro_content = is_unclosed ? NULL : macro_create_content_line();
+    }
+    asm_alloc_free(macro_content); /* the line that ended the macro isn't a part of it */
+}
+
+/**
+ * @brief opens the macros, the includes and the conditionals of a file
+ * line by line. The lines of a region that isn't assembled are only
+ * scanned for the conditional directives that end it
+ *
+ * @param current_file the file that is being read
+ * @param scope the macros the file can call
+ * @param handler the handler that receives the lines
+ * @param context the context given to the handler
+ */
+static void macro_expand_scope(FILE *current_file, macro_scope_t *scope, macro_line_handler_t handler, void *context)
 {
     char line[LINE_LENGTH];
+    char name[LINE_LENGTH];
     char *line_ptr;
-    macro_t root;
     macro_t relevant_macro;
+    include_t *include;
+    conditional_t conditional;
+    conditional_e kind;
 
-    root = NULL;
+    memset(&conditional, 0, sizeof(conditional_t));
     while (fgets(line, LINE_LENGTH, current_file))
     {
+        ++source_line;
         line_ptr = line;
-        if (macro_is_definition(&line_ptr))
+        kind = macro_get_conditional(line, &line_ptr);
+        if (conditional.is_skipping)
+        {
+            macro_skip_line(&conditional, kind);
+        }
+        else if (kind != CONDITIONAL_NONE && macro_handle_conditional(&conditional, kind, line_ptr))
         {
-            macro_add_to_table(current_file, line_ptr, &root);
+            /* the directive itself isn't a part of the output */
         }
-        else if ((relevant_macro = macro_is_called(line, root)) != NULL)
+        else if (macro_is_definition(&line_ptr))
         {
-            macro_open_content(am_file, relevant_macro);
+            macro_add_to_table(current_file, scope->path, line_ptr, &(scope->macros));
+        }
+        else if (macro_is_include(line, name) && (include = macro_include(scope, name)) != NULL)
+        {
+            line_origin = ORIGIN_INCLUDE;
+            macro_open_include(handler, context, include);
+            line_origin = ORIGIN_SOURCE;
+        }
+        else if ((relevant_macro = macro_is_called(line, scope)) != NULL)
+        {
+            line_origin = ORIGIN_MACRO;
+            macro_open_content(handler, context, relevant_macro);
+            line_origin = ORIGIN_SOURCE;
         }
         else
         {
-            fputs(line, am_file);
+            /* an include that couldn't be opened is reported by the assembler */
+            origin_file = scope->path;
+            origin_line = source_line;
+            handler(line, context);
         }
     }
 
-    macro_destroy_avl_tree(root);
+    if (conditional.depth > 0)
+    {
+        /* a conditional that wasn't closed is reported at the end of the file */
+        strcpy(line, ".if\n");
+        origin_file = scope->path;
+        origin_line = source_line;
+        handler(line, context);
+    }
+}
+
+/**
+ * @brief returns the statement of a line, after its label (if it has one)
+ *
+ * @param line the line
+ * @return char* the statement
+ */
+static char *macro_skip_label(char *line)
+{
+    char label[LINE_LENGTH];
+    int length;
+
+    if (sscanf(line, "%s%n", label, &length) == 1 && label[strlen(label) - 1] == ':')
+    {
+        line += length;
+    }
+    while (isspace(*line))
+    {
+        ++line;
+    }
+    return line;
+}
+
+/**
+ * @brief checks if a statement is the given directive
+ *
+ * @param statement the statement
+ * @param directive the directive
+ * @return bool true if the statement starts with the directive
+ */
+static bool macro_is_directive(char *statement, char *directive)
+{
+    return strncmp(statement, directive, strlen(directive)) == 0 && IS_END_OF_WORD(statement[strlen(directive)]);
+}
+
+/**
+ * @brief returns the index of a section, adding it if it's new
+ *
+ * @param layout the layout
+ * @param name the name of the section
+ * @return int the index of the section
+ */
+static int macro_get_section(layout_t *layout, char *name)
+{
+    int section;
+
+    for (section = 0; section < layout->sections_count; section++)
+    {
+        if (strcmp(layout->sections[section], name) == 0)
+        {
+            return section;
+        }
+    }
+    if (layout->sections_count == layout->sections_capacity)
+    {
+        layout->sections_capacity = layout->sections_capacity ? layout->sections_capacity << 1 : 8;
+        layout->sections = asm_alloc_realloc(ALLOC_MACRO, layout->sections, layout->sections_capacity * sizeof(*(layout->sections)));
+        assert("Memory allocation failed" && layout->sections != NULL);
+    }
+    strcpy(layout->sections[layout->sections_count], name);
+    return layout->sections_count++;
+}
+
+/**
+ * @brief passes a line on to the handler of macro_expand and records
+ * where it came from
+ *
+ * @param layout the layout
+ * @param line the line
+ * @param source where the line came from
+ */
+static void macro_pass_line(layout_t *layout, char *line, line_source_t *source)
+{
+    macro_includes_t *includes = layout->includes;
+
+    if (includes->origins_count == includes->origins_capacity)
+    {
+        includes->origins_capacity = includes->origins_capacity ? includes->origins_capacity << 1 : 64;
+        includes->origins = asm_alloc_realloc(ALLOC_MACRO, includes->origins, includes->origins_capacity * sizeof(line_source_t));
+        assert("Memory allocation failed" && includes->origins != NULL);
+    }
+    includes->origins[includes->origins_count++] = *source;
+
+    source_line = source->source_line;
+    layout->handler(line, layout->context);
+}
+
+/**
+ * @brief adds a line of the source to its section (macro line handler).
+ * The lines before the first section, .align or reserved word are passed
+ * on right away (their place in the layout doesn't depend on the lines
+ * after them), the rest are kept until the end of the file
+ *
+ * @param line the line
+ * @param layout the layout
+ */
+static void macro_layout_line(char *line, void *layout)
+{
+    layout_t *current = layout;
+    layout_line_t *added;
+    char name[LINE_LENGTH];
+    char *statement = macro_skip_label(line);
+    layout_e group = LAYOUT_CODE;
+    line_source_t source;
+
+    source.source_line = source_line;
+    source.origin = line_origin;
+    source.file = origin_file;
+    source.file_line = origin_line;
+
+    if (macro_is_directive(statement, SECTION_DIRECTIVE) && sscanf(statement + strlen(SECTION_DIRECTIVE), "%s", name) == 1)
+    {
+        /* the directive is written before every group of the section's lines */
+        current->section = macro_get_section(current, name);
+        current->is_buffering = current->is_grouped = true;
+        if (statement == line + strspn(line, " \t"))
+        {
+            return;
+        }
+        /* a label can't name a section, the line is kept so that the assembler reports it */
+    }
+    if (macro_is_directive(statement, ".data") || macro_is_directive(statement, ".string")
+        || macro_is_directive(statement, ".space") || macro_is_directive(statement, ".align"))
+    {
+        group = LAYOUT_DATA;
+    }
+    if (macro_is_directive(statement, BSS_SECTION)
+        || ((macro_is_directive(statement, ".space") || macro_is_directive(statement, ".align"))
+            && strcmp(current->sections[current->section], BSS_SECTION) == 0))
+    {
+        group = LAYOUT_BSS;
+        current->is_grouped = true;
+    }
+
+    if (!current->is_buffering && (group == LAYOUT_CODE || (group == LAYOUT_DATA && !macro_is_directive(statement, ".align"))))
+    {
+        macro_pass_line(current, line, &source);
+        return;
+    }
+    current->is_buffering = true;
+
+    if (current->count == current->capacity)
+    {
+        current->capacity = current->capacity ? current->capacity << 1 : 64;
+        current->lines = asm_alloc_realloc(ALLOC_MACRO, current->lines, current->capacity * sizeof(layout_line_t));
+        assert("Memory allocation failed" && current->lines != NULL);
+    }
+    added = &(current->lines[current->count++]);
+    added->source = source;
+    added->section = current->section;
+    added->group = group;
+    if (group == LAYOUT_BSS && !macro_is_directive(statement, BSS_SECTION)
+        && strlen(line) + strlen(BSS_SECTION) < LINE_LENGTH - 1)
+    {
+        /* the words of the .bss section are reserved rather than stored: ".bss space N" */
+        strncpy(added->text, line, statement - line);
+        strcpy(added->text + (statement - line), BSS_SECTION " ");
+        strcat(added->text, statement + 1);
+    }
+    else
+    {
+        strcpy(added->text, line);
+    }
+}
+
+/**
+ * @brief passes the kept lines on: the code of every section, then the
+ * data of every section and then the reserved words, each group after the
+ * directive of its section. A file without sections or reserved words
+ * keeps the order of its lines
+ *
+ * @param layout the layout
+ */
+static void macro_flush_layout(layout_t *layout)
+{
+    char marker[LINE_LENGTH];
+    unsigned int last_line = source_line;
+    int group;
+    int section;
+    int line;
+    bool is_first;
+
+    if (!layout->is_grouped)
+    {
+        for (line = 0; line < layout->count; line++)
+        {
+            macro_pass_line(layout, layout->lines[line].text, &(layout->lines[line].source));
+        }
+    }
+
+    for (group = LAYOUT_CODE; layout->is_grouped && group <= LAYOUT_BSS; group++)
+    {
+        for (section = 0; section < layout->sections_count; section++)
+        {
+            is_first = true;
+            for (line = 0; line < layout->count; line++)
+            {
+                if (layout->lines[line].group == group && layout->lines[line].section == section)
+                {
+                    if (is_first && section > 0)
+                    {
+                        sprintf(marker, "%s %.*s\n", SECTION_DIRECTIVE, (int)(LINE_LENGTH - sizeof(SECTION_DIRECTIVE) - 2), layout->sections[section]);
+                        macro_pass_line(layout, marker, &(layout->lines[line].source));
+                    }
+                    is_first = false;
+                    macro_pass_line(layout, layout->lines[line].text, &(layout->lines[line].source));
+                }
+            }
+        }
+    }
+    source_line = last_line;
+}
+
+void macro_expand(FILE *current_file, macro_line_handler_t handler, void *context)
+{
+    macro_scope_t scope;
+    layout_t layout;
+    linked_list_node_t *include;
+
+    scope.macros = NULL;
+    scope.includes = NULL;
+    scope.dependencies = macro_includes_get_instance();
+    macro_clear_dependencies(scope.dependencies);
+    scope.dependencies->origins_count = 0;
+    scope.directory = scope.dependencies->directory;
+    scope.path = NULL;
+    source_line = 0;
+    line_origin = ORIGIN_SOURCE;
+
+    /* the prelude is searched after everything the file defines or includes */
+    if (scope.dependencies->prelude)
+    {
+        linked_list_push(&(scope.includes));
+        linked_list_set_info(scope.includes, macro_retain_include(scope.dependencies->prelude));
+        macro_add_dependency(scope.dependencies, scope.dependencies->prelude);
+    }
+
+    memset(&layout, 0, sizeof(layout_t));
+    layout.handler = handler;
+    layout.context = context;
+    layout.includes = scope.dependencies;
+    macro_get_section(&layout, "");
+    macro_expand_scope(current_file, &scope, macro_layout_line, &layout);
+    macro_flush_layout(&layout);
+    asm_alloc_free(layout.lines);
+    asm_alloc_free(layout.sections);
+
+    macro_destroy_avl_tree(scope.macros);
+    for (include = scope.includes; include; include = linked_list_get_next_address(include))
+    {
+        macro_release_include(linked_list_get_info(include));
+    }
+    linked_list_destroy(&(scope.includes));
+}
+
+unsigned int macro_get_source_line()
+{
+    return source_line;
+}
+
+void macro_write_am_file(FILE* current_file, FILE *am_file)
+{
+    macro_expand(current_file, macro_write_line, am_file);
+}
+
+macro_includes_t *macro_includes_get_instance()
+{
+    if (includes_instance == NULL)
+    {
+        includes_instance = asm_alloc_calloc(ALLOC_MACRO, 1, sizeof(macro_includes_t));
+        assert("Memory allocation failed" && includes_instance != NULL);
+    }
+    return includes_instance;
+}
+
+macro_includes_t *macro_includes_set_instance(macro_includes_t *includes)
+{
+    macro_includes_t *previous = includes_instance;
+    includes_instance = includes;
+    return previous;
+}
+
+void macro_includes_set_source(macro_includes_t *includes, char *path)
+{
+    asm_alloc_free(includes->directory);
+    includes->directory = macro_get_directory(path);
+    macro_clear_dependencies(includes);
+}
+
+bool macro_includes_set_prelude(macro_includes_t *includes, char *path)
+{
+    include_t *previous = includes->prelude;
+
+    pthread_mutex_lock(&include_lock);
+    includes->prelude = path ? macro_get_include(path) : NULL;
+    pthread_mutex_unlock(&include_lock);
+    if (previous)
+    {
+        macro_release_include(previous);
+    }
+
+    return !path || includes->prelude;
+}
+
+void macro_includes_write_dependencies(macro_includes_t *includes, FILE *d_file, char *target, char *source)
+{
+    int file;
+
+    fprintf(d_file, "%s: %s", target, source);
+    for (file = 0; file < includes->count; file++)
+    {
+        fprintf(d_file, " %s", includes->files[file]->path);
+    }
+    fputc('\n', d_file);
+
+    /* every included file is also a target, so deleting one doesn't break make */
+    for (file = 0; file < includes->count; file++)
+    {
+        fprintf(d_file, "\n%s:\n", includes->files[file]->path);
+    }
+}
+
+bool macro_includes_get_origin(macro_includes_t *includes, int line, unsigned int *source_line, line_origin_e *origin,
+                               char **file, unsigned int *file_line)
+{
+    if (line < 0 || line >= includes->origins_count)
+    {
+        return false;
+    }
+    *source_line = includes->origins[line].source_line;
+    *origin = includes->origins[line].origin;
+    *file = includes->origins[line].file;
+    *file_line = includes->origins[line].file_line;
+    return true;
+}
+
+void macro_includes_destroy(macro_includes_t *includes)
+{
+    if (includes == includes_instance)
+    {
+        includes_instance = NULL;
+    }
+    macro_clear_dependencies(includes);
+    if (includes->prelude)
+    {
+        macro_release_include(includes->prelude);
+    }
+    asm_alloc_free(includes->directory);
+    asm_alloc_free(includes->files);
+    asm_alloc_free(includes->origins);
+    asm_alloc_free(includes);
+}
+
+void macro_destroy_include_cache()
+{
+    include_t *include;
+
+    pthread_mutex_lock(&include_lock);
+    while ((include = include_cache))
+    {
+        /* the versions that are still read are freed by their last reader */
+        include_cache = include->next;
+        macro_release_include(include);
+    }
+    pthread_mutex_unlock(&include_lock);
+}
+
+void macro_define(char *definition)
+{
+    definition_t *added;
+    char *value;
+    size_t length;
+
+    value = strchr(definition, '=');
+    length = value ? (size_t)(value - definition) : strlen(definition);
+
+    added = asm_alloc_malloc(ALLOC_MACRO, sizeof(definition_t));
+    assert("Memory allocation failed" && added != NULL);
+    added->name = asm_alloc_malloc(ALLOC_MACRO, length + 1);
+    assert("Memory allocation failed" && added->name != NULL);
+    memcpy(added->name, definition, length);
+    added->name[length] = '\0';
+    added->value = value ? atol(value + 1) : 1;
+
+    /* a later definition hides an earlier one */
+    added->next = definitions;
+    definitions = added;
+    definitions_generation++;
+}
+
+void macro_undefine_all()
+{
+    definition_t *definition;
+
+    while ((definition = definitions))
+    {
+        definitions = definition->next;
+        asm_alloc_free(definition->name);
+        asm_alloc_free(definition);
+    }
+    definitions_generation++;
 }
\ No newline at end of file
@@ -1,8 +1,17 @@
+#define _POSIX_C_SOURCE 200809L
 #include "assembler.h"
+#include "asm_daemon.h"
+#include "asm_lsp.h"
+#include "asm_rebase.h"
+#include "asm_map.h"
+#include "asm_symbols.h"
+#include "asm_archive.h"
 
 /**
  * @brief converts all of the given assembly files to machine code by
- * analyzing the lines and creating .ob, .ext and .ant files
+ * analyzing the lines and creating .ob, .ext and .ant files. The file
+ * name "-" reads the source from stdin and writes the output to stdout.
+ * Options (see options.h) apply to the files that follow them
  * 
  * @param argc the amount of given parameters from terminal
  * @param argv the arguments given in the terminal
@@ -10,17 +19,438 @@
 void assembler(int argc, char* argv[])
 {
     int offset;
+    int used;
+    int prefetched = 1; /* the arguments before it were prefetched */
+    asm_io_stats_t stats;
 
-    asm_language_init();
     for (offset = 1; offset < argc; offset++)
     {
-        assembler_on_file(argv[offset]);
-    }    
+        if ((used = options_parse(argc, argv, offset)) > 0)
+        {
+            offset += used - 1;
+        }
+        else if (strcmp(argv[offset], "-") == 0)
+        {
+            assembler_on_stream(stdin, stdout);
+        }
+        else
+        {
+            if (asm_io_init(options_get_instance()->io_uring))
+            {
+                /* sources are read ahead while the files before them are assembled */
+                for (prefetched = (prefetched > offset) ? prefetched : offset;
+                     prefetched < argc && prefetched <= offset + ASM_IO_PREFETCH_WINDOW; prefetched++)
+                {
+                    if (argv[prefetched][0] != '-') /* an option's value is at worst a file that doesn't exist */
+                    {
+                        assembler_prefetch(argv[prefetched]);
+                    }
+                }
+            }
+            if (options_get_instance()->alloc_stats)
+            {
+                asm_alloc_start_file();
+            }
+            assembler_on_file(argv[offset]);
+            if (options_get_instance()->alloc_stats)
+            {
+                asm_alloc_report(stderr, argv[offset]);
+            }
+        }
+    }
+    asm_io_flush();
+    if (options_get_instance()->stats)
+    {
+        stats = asm_io_get_stats();
+        fprintf(stderr, "outputs: %u written, %u unchanged, %u removed\n", stats.written, stats.unchanged, stats.removed);
+    }
+    asm_io_destroy();
+    assembler_destroy();
 }
 
-int main(int argc, char* argv[])
+/**
+ * @brief sends a request to a running daemon:
+ * --request <socket> build|watch <file> or --request <socket> shutdown
+ * 
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @return int 0 if the daemon replied "ok", else 1
+ */
+int assembler_request(int argc, char* argv[])
+{
+    char request[ASM_DAEMON_REQUEST_LENGTH];
+
+    /* a request that doesn't fit is rejected rather than cut */
+    if (!(argc == 5 && snprintf(request, ASM_DAEMON_REQUEST_LENGTH, "%s %s", argv[3], argv[4]) < ASM_DAEMON_REQUEST_LENGTH)
+        && !(argc == 4 && snprintf(request, ASM_DAEMON_REQUEST_LENGTH, "%s", argv[3]) < ASM_DAEMON_REQUEST_LENGTH))
+    {
+        fprintf(stderr, "Usage: %s --request <socket> build|watch <file> | shutdown\n", argv[0]);
+        return 1;
+    }
+
+    return asm_daemon_request(argv[2], request, stdout) == 0 ? 0 : 1;
+}
+
+/**
+ * @brief moves an assembled program to another load address:
+ * --rebase <file> <address> (the file was assembled with --rel)
+ * 
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @return int 0 if the .ob file was rebased, else 1
+ */
+int assembler_rebase(int argc, char* argv[])
 {
-    assembler(argc, argv);
+    char *error;
+    char *end;
+    long start;
 
+    start = (argc == 4) ? strtol(argv[3], &end, 10) : 0;
+    if (argc != 4 || *end != '\0')
+    {
+        fprintf(stderr, "Usage: %s --rebase <file> <address>\n", argv[0]);
+        return 1;
+    }
+    if (!asm_rebase_file(argv[2], start, &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[2], error);
+        return 1;
+    }
+    asm_io_flush();
+    asm_io_destroy();
     return 0;
+}
+
+/**
+ * @brief prints the line of an address of an assembled program:
+ * --addr2line <file> <address> (the file was assembled with --map). A
+ * word of a macro or of an included file is printed at the line of the
+ * file its text is in, followed by the line of the source that called the
+ * macro or included the file
+ * 
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @return int 0 if the address was found, else 1
+ */
+int assembler_addr2line(int argc, char* argv[])
+{
+    static char *origins[] = {"", "macro called", "included"};
+    FILE *map_file;
+    asm_map_t *map;
+    char *path;
+    char *end;
+    char *source;
+    unsigned int source_line;
+    line_origin_e origin;
+    char *file;
+    unsigned int file_line;
+    long address;
+    bool is_found;
+
+    address = (argc == 4) ? strtol(argv[3], &end, 10) : 0;
+    if (argc != 4 || *end != '\0')
+    {
+        fprintf(stderr, "Usage: %s --addr2line <file> <address>\n", argv[0]);
+        return 1;
+    }
+
+    path = asm_alloc_malloc(ALLOC_SERVICE, strlen(argv[2]) + sizeof(".map"));
+    assert("Memory allocation failed" && path != NULL);
+    sprintf(path, "%s.map", argv[2]);
+    map_file = fopen(path, "rb");
+    map = map_file ? asm_map_read(map_file) : NULL;
+    if (map_file)
+    {
+        fclose(map_file);
+    }
+    if (!map)
+    {
+        fprintf(stderr, "%s: not a valid .map file\n", path);
+        asm_alloc_free(path);
+        return 1;
+    }
+
+    is_found = asm_map_lookup(map, address, &source, &source_line, &origin, &file, &file_line);
+    if (is_found && origin == ORIGIN_SOURCE)
+    {
+        printf("%s:%u\n", file, file_line);
+    }
+    else if (is_found)
+    {
+        printf("%s:%u (%s at %s:%u)\n", file, file_line, origins[origin], source, source_line);
+    }
+    else
+    {
+        fprintf(stderr, "%s: no word at address %ld\n", path, address);
+    }
+    asm_map_destroy(map);
+    asm_alloc_free(path);
+    return is_found ? 0 : 1;
+}
+
+/**
+ * @brief compares symbols by their value and then by their name (qsort
+ * comparator)
+ * 
+ * @param first a symbol
+ * @param second a symbol
+ * @return int the order of the symbols
+ */
+static int assembler_compare_symbols(const void *first, const void *second)
+{
+    const asm_symbol_t *first_symbol = first;
+    const asm_symbol_t *second_symbol = second;
+
+    if (first_symbol->value != second_symbol->value)
+    {
+        return first_symbol->value < second_symbol->value ? -1 : 1;
+    }
+    return strcmp(first_symbol->name, second_symbol->name);
+}
+
+/**
+ * @brief prints a symbol as nm does: its value, its type (T code, D data,
+ * A constant, U extern, upper case if it's exported) and its name, and
+ * then the number of words that refer to it
+ * 
+ * @param symbol the symbol
+ */
+static void assembler_print_symbol(asm_symbol_t *symbol)
+{
+    char type;
+
+    type = (symbol->attributes & EXTERN_FLAG) ? 'U'
+         : (symbol->attributes & CONSTANT_FLAG) ? 'a'
+         : (symbol->attributes & DATA_FLAG) ? 'd' : 't';
+    if (symbol->attributes & ENTRY_FLAG)
+    {
+        type = toupper(type);
+    }
+
+    if (symbol->attributes & EXTERN_FLAG)
+    {
+        printf("%4s %c %s %u\n", "", type, symbol->name, symbol->references);
+    }
+    else
+    {
+        printf("%04ld %c %s %u\n", symbol->value, type, symbol->name, symbol->references);
+    }
+}
+
+/**
+ * @brief lists the symbols of an assembled program, or looks up the given
+ * ones: --nm <file> [<symbol>...] (the file was assembled with --sym)
+ * 
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @return int 0 if every given symbol was found, else 1
+ */
+int assembler_nm(int argc, char* argv[])
+{
+    asm_symbol_index_t *index;
+    asm_symbol_t *symbols;
+    asm_symbol_t symbol;
+    char *path;
+    int count;
+    int position;
+    int status = 0;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s --nm <file> [<symbol>...]\n", argv[0]);
+        return 1;
+    }
+    path = asm_alloc_malloc(ALLOC_SERVICE, strlen(argv[2]) + sizeof(".sym"));
+    assert("Memory allocation failed" && path != NULL);
+    sprintf(path, "%s.sym", argv[2]);
+    if (!(index = asm_symbol_index_open(path)))
+    {
+        fprintf(stderr, "%s: not a valid .sym file\n", path);
+        asm_alloc_free(path);
+        return 1;
+    }
+
+    for (position = 3; position < argc; position++)
+    {
+        if (asm_symbol_index_find(index, argv[position], &symbol))
+        {
+            assembler_print_symbol(&symbol);
+        }
+        else
+        {
+            fprintf(stderr, "%s: no symbol %s\n", path, argv[position]);
+            status = 1;
+        }
+    }
+
+    if (argc == 3)
+    {
+        count = asm_symbol_index_get_count(index);
+        symbols = asm_alloc_malloc(ALLOC_SERVICE, (count + 1) * sizeof(asm_symbol_t));
+        assert("Memory allocation failed" && symbols != NULL);
+        for (position = 0; position < count; position++)
+        {
+            asm_symbol_index_get(index, position, &symbols[position]);
+        }
+        qsort(symbols, count, sizeof(asm_symbol_t), assembler_compare_symbols);
+        for (position = 0; position < count; position++)
+        {
+            assembler_print_symbol(&symbols[position]);
+        }
+        asm_alloc_free(symbols);
+    }
+
+    asm_symbol_index_close(index);
+    asm_alloc_free(path);
+    return status;
+}
+
+/**
+ * @brief extracts a member of an archive to the working directory
+ * 
+ * @param archive the archive
+ * @param member the index of the member
+ * @return bool false if the member has an invalid name
+ */
+static bool assembler_extract_member(asm_archive_t *archive, int member)
+{
+    FILE *file;
+    char *name;
+    unsigned char *data;
+    size_t size;
+
+    asm_archive_get_member(archive, member, &name, &data, &size);
+    if (*name == '\0' || *name == '.' || strchr(name, '/'))
+    {
+        return false;
+    }
+    file = asm_io_open(name, "w");
+    fwrite(data, 1, size, file);
+    asm_io_close(file);
+    return true;
+}
+
+/**
+ * @brief packs assembled modules into an archive and reads it:
+ * --archive create <archive> <file>... packs the .ob, .ent and .ext files,
+ * --archive list <archive> lists the members,
+ * --archive extract <archive> [<member>...] extracts all or some members and
+ * --archive find <archive> <symbol>... finds the modules that export symbols
+ * 
+ * @param argc the amount of given parameters from terminal
+ * @param argv the arguments given in the terminal
+ * @return int 0 if the command succeeded, else 1
+ */
+int assembler_archive(int argc, char* argv[])
+{
+    asm_archive_t *archive;
+    unsigned char *data;
+    char *command = argc >= 4 ? argv[2] : "";
+    char *error;
+    char *name;
+    size_t size;
+    long address;
+    int member;
+    int position;
+    int status = 0;
+
+    if (strcmp(command, "create") == 0 && argc >= 5)
+    {
+        if (!asm_archive_create(argv[3], argv + 4, argc - 4, &error))
+        {
+            fprintf(stderr, "%s: %s\n", argv[3], error);
+            status = 1;
+        }
+        asm_io_flush();
+        asm_io_destroy();
+        return status;
+    }
+    if (strcmp(command, "list") != 0 && strcmp(command, "extract") != 0
+        && (strcmp(command, "find") != 0 || argc < 5))
+    {
+        fprintf(stderr, "Usage: %s --archive create <archive> <file>... | list <archive>"
+                " | extract <archive> [<member>...] | find <archive> <symbol>...\n", argv[0]);
+        return 1;
+    }
+    if (!(archive = asm_archive_open(argv[3])))
+    {
+        fprintf(stderr, "%s: not a valid archive\n", argv[3]);
+        return 1;
+    }
+
+    for (member = 0; strcmp(command, "find") != 0 && member < asm_archive_get_count(archive); member++)
+    {
+        asm_archive_get_member(archive, member, &name, &data, &size);
+        for (position = 4; position < argc && strcmp(argv[position], name) != 0; position++)
+            ;
+        if (strcmp(command, "list") == 0)
+        {
+            printf("%8lu %s\n", (unsigned long)size, name);
+        }
+        else if ((argc == 4 || position < argc) && !assembler_extract_member(archive, member))
+        {
+            fprintf(stderr, "%s: invalid member name %s\n", argv[3], name);
+            status = 1;
+        }
+    }
+    for (position = 4; strcmp(command, "find") == 0 && position < argc; position++)
+    {
+        if (asm_archive_find(archive, argv[position], &member, &address))
+        {
+            asm_archive_get_member(archive, member, &name, &data, &size);
+            printf("%s %s %04ld\n", argv[position], name, address);
+        }
+        else
+        {
+            fprintf(stderr, "%s: no module exports %s\n", argv[3], argv[position]);
+            status = 1;
+        }
+    }
+
+    asm_archive_close(archive);
+    asm_io_flush();
+    asm_io_destroy();
+    return status;
+}
+
+int main(int argc, char* argv[])
+{
+    int status = 0;
+
+    if (argc >= 3 && strcmp(argv[1], "--daemon") == 0)
+    {
+        status = asm_daemon_run(argv[2], argc - 3, argv + 3) == 0 ? 0 : 1;
+        assembler_destroy();
+    }
+    else if (argc == 2 && strcmp(argv[1], "--lsp") == 0)
+    {
+        status = asm_lsp_run();
+        assembler_destroy();
+    }
+    else if (argc >= 3 && strcmp(argv[1], "--request") == 0)
+    {
+        status = assembler_request(argc, argv);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "--rebase") == 0)
+    {
+        status = assembler_rebase(argc, argv);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "--addr2line") == 0)
+    {
+        status = assembler_addr2line(argc, argv);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "--nm") == 0)
+    {
+        status = assembler_nm(argc, argv);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "--archive") == 0)
+    {
+        status = assembler_archive(argc, argv);
+    }
+    else
+    {
+        assembler(argc, argv);
+    }
+
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "options.h"
+
+static options_t options_instance;
+
+options_t *options_get_instance()
+{
+    return &options_instance;
+}
+
+int options_parse(int argc, char *argv[], int offset)
+{
+    char *option = argv[offset];
+    int used = 1;
+
+    if (strcmp(option, "-p") == 0 || strcmp(option, "--pipeline") == 0)
+    {
+        options_instance.pipeline = true;
+    }
+    else if (strcmp(option, "-u") == 0 || strcmp(option, "--io-uring") == 0)
+    {
+        options_instance.io_uring = true;
+    }
+    else if (strcmp(option, "-O") == 0 || strcmp(option, "--optimize") == 0)
+    {
+        options_instance.optimize = true;
+    }
+    else if (strcmp(option, "--pool-strings") == 0)
+    {
+        options_instance.pool_strings = true;
+    }
+    else if (strcmp(option, "--rel") == 0)
+    {
+        options_instance.relocations = true;
+    }
+    else if (strcmp(option, "--map") == 0)
+    {
+        options_instance.map = true;
+    }
+    else if (strcmp(option, "--sym") == 0)
+    {
+        options_instance.symbols = true;
+    }
+    else if (strcmp(option, "-MD") == 0)
+    {
+        options_instance.dependencies = true;
+    }
+    else if (strcmp(option, "--stats") == 0)
+    {
+        options_instance.stats = true;
+    }
+    else if (strcmp(option, "--alloc-stats") == 0)
+    {
+        options_instance.alloc_stats = true;
+    }
+    else if (strcmp(option, "--fail-alloc") == 0 && offset + 1 < argc)
+    {
+        /* the Nth allocation after the option fails (for testing) */
+        asm_alloc_fail_at(strtoul(argv[offset + 1], NULL, 10));
+        used = 2;
+    }
+    else if ((strcmp(option, "-j") == 0 || strcmp(option, "--chunks") == 0) && offset + 1 < argc)
+    {
+        options_instance.chunks = atoi(argv[offset + 1]);
+        used = 2;
+    }
+    else if (strcmp(option, "--ob-threads") == 0 && offset + 1 < argc)
+    {
+        options_instance.ob_threads = atoi(argv[offset + 1]);
+        used = 2;
+    }
+    else if (strcmp(option, "-D") == 0 && offset + 1 < argc)
+    {
+        macro_define(argv[offset + 1]);
+        used = 2;
+    }
+    else if (strncmp(option, "-D", 2) == 0 && option[2] != '\0')
+    {
+        macro_define(option + 2);
+    }
+    else if (strcmp(option, "--prelude") == 0 && offset + 1 < argc)
+    {
+        options_instance.prelude = argv[offset + 1];
+        used = 2;
+    }
+    else
+    {
+        used = 0;
+    }
+
+    return used;
+}
\ No newline at end of file
@@ -0,0 +1,2 @@
+"$ASM" 1 missing good
+ls 1.* good.*
@@ -0,0 +1,4 @@
+; assembled after test 1 and a missing file, its outputs are still written
+.entry MAIN
+MAIN: inc r1
+ stop
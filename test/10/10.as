@@ -0,0 +1,6 @@
+; assembled three times with --stats: the outputs are written, then left
+; as they are, then the .ext of the removed extern is removed
+.entry MAIN
+.extern LOG
+MAIN: jsr LOG
+ stop
@@ -0,0 +1,7 @@
+"$ASM" --stats 10
+ls -i 10.ob > inode
+"$ASM" --stats 10
+ls -i 10.ob | cmp -s - inode && echo "10.ob wasn't rewritten"
+sed -e '/^.extern LOG$/d' -e 's/^MAIN: jsr LOG$/MAIN: inc r1/' 10.as > edited && mv edited 10.as
+"$ASM" --stats 10
+ls 10.*
@@ -0,0 +1,7 @@
+; includes the macros of lib/macros.inc, which includes lib/regs.inc
+.include "lib/macros.inc"
+.entry MAIN
+MAIN: clr r1
+ step
+ show
+ stop
@@ -0,0 +1,2 @@
+"$ASM" -MD 11 missing
+cat 11.d
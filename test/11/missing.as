@@ -0,0 +1,3 @@
+; the second file of test 11 includes a file that doesn't exist
+.include "lib/missing.inc"
+ stop
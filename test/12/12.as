@@ -0,0 +1,7 @@
+; uses the macros of the prelude, which is given with --prelude
+.entry MAIN
+.extern PUTC
+MAIN: mov #12, r1
+ print
+ twice
+ stop
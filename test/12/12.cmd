@@ -0,0 +1,3 @@
+"$ASM" --prelude prelude.inc 12 other
+cat other.am
+"$ASM" --prelude missing.inc other
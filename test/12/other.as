@@ -0,0 +1,9 @@
+; the second file of test 12 uses the same prelude, and defines a macro
+; of its own with the name of a macro of the prelude
+.extern PUTC
+macro twice
+dec r2
+endm
+ print
+ twice
+ stop
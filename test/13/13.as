@@ -0,0 +1,15 @@
+; assembled with -D FAST -D LEVEL=2, the inactive lines are skipped
+.include "lib/defs.inc"
+.entry MAIN
+MAIN: clr r1
+ step
+ wait
+.ifndef FAST
+ bad line that is never assembled
+.endif
+.if LEVEL != 2
+ prn #0
+.else
+ prn #9
+.endif
+ stop
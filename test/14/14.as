@@ -0,0 +1,12 @@
+; constants and expressions, defined before and after they are used
+.equ SIZE 4
+.equ MASK (1 << SIZE) - 1
+.equ DOUBLE LATE * 2
+.entry START
+START: mov #MASK & 6, r1
+ add #SIZE * 3 + (END - START), r2
+ prn #DOUBLE
+ prn #-SIZE | 1
+END: stop
+TABLE: .data SIZE, MASK >> 2 | 16, LATE - 1, END - START
+.equ LATE 5
@@ -0,0 +1 @@
+"$ASM" 14 overflow
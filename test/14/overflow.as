@@ -0,0 +1,16 @@
+; the second file of test 14, every expression is out of range
+.equ MIN -9223372036854775807 - 1
+.equ BIG 9223372036854775807
+ prn #(0 - BIG - 1) / -1
+ prn #-(0 - BIG - 1)
+ prn #BIG * 2
+ prn #3037000500 * 3037000500
+ prn #BIG + 1
+ prn #-BIG - 2
+ prn #1 << 63
+ prn #1 << 64
+ prn #1 << -1
+ prn #8 >> 32
+ prn #99999999999999999999
+ .data BIG * -BIG, 1 / 0
+ stop
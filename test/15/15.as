@@ -0,0 +1,13 @@
+; assembled with -O: the instructions that do nothing are removed and the
+; labels after them move back
+.entry MAIN
+.entry NAME
+MAIN: mov r3, r3
+ add #0, r1
+ clr r2
+ mov r4, r2
+ jmp NEXT
+NEXT: lea NAME, r5
+ sub #0, r1
+ stop
+NAME: .string "abcd"
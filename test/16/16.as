@@ -0,0 +1,13 @@
+; assembled with --pool-strings: equal strings and strings that end
+; another string share their words
+.entry NAME
+.entry LAST
+.entry AGAIN
+MAIN: lea NAME, r5
+ lea LAST, r6
+ lea AGAIN, r7
+ stop
+NAME: .string "abcd"
+LAST: .string "cd"
+AGAIN: .string "abcd"
+OTHER: .string "abc"
@@ -0,0 +1,5 @@
+; assembled without and with --ob-threads 4, a file too small for more
+; than one range
+.entry MAIN
+MAIN: mov #17, r1
+ stop
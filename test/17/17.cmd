@@ -0,0 +1,16 @@
+# a file of more than 4096 words, so that each of the 4 ranges is large enough
+cp 17.as long.as
+i=0
+while [ $i -lt 500 ]; do
+    echo " add #$i, r$((i % 8))" >> long.as
+    echo "D$i: .data $i, -$i, 7, 8, 9, 10, 11" >> long.as
+    i=$((i + 1))
+done
+"$ASM" 17 long
+mkdir sequential && mv 17.ob long.ob sequential/
+"$ASM" --ob-threads 4 --stats 17 long
+for file in 17 long; do
+    cmp $file.ob sequential/$file.ob || echo "$file.ob differs with --ob-threads 4"
+done
+head -1 long.ob
+"$ASM" --ob-threads 4 --stats long
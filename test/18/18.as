@@ -0,0 +1,25 @@
+; the code of every section comes first, then the data and then the
+; reserved words of .bss, which take addresses but not lines of the .ob
+.entry BUF
+.entry TAB
+.entry END
+MAIN: lea MSG, r1
+ jsr HOT
+ stop
+.section .bss
+BUF: .space 10
+.section .rodata
+MSG: .string "hi"
+.align 4
+TAB: .data 1, 2
+.section .hot
+HOT: inc r2
+ prn BUF
+ prn BIG
+ rts
+.section .bss
+.align 8
+BIG: .space 3
+.section .rodata
+ZERO: .space 2
+END: .data 9
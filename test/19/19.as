@@ -0,0 +1,12 @@
+; assembled with --rel, moved to 500 and back to 100
+.entry MAIN
+.entry DATA
+.extern OUT
+MAIN: lea DATA, r1
+ add DATA[r2], r3
+ jsr OUT
+ jmp MAIN
+ mov #MAIN, r1
+ stop
+DATA: .data 7, -7
+PTR: .data MAIN, DATA - PTR
@@ -0,0 +1,9 @@
+"$ASM" --rel 19
+cp 19.ob 100.ob
+cp 19.ent 100.ent
+cp 19.ext 100.ext
+"$ASM" --rebase 19 500 && cat 19.ob 19.ent 19.ext
+"$ASM" --rebase 19 100 && cmp 19.ob 100.ob && cmp 19.ent 100.ent && cmp 19.ext 100.ext && echo "the same as at 100"
+printf 'MAIN: prn #MAIN * 2\n stop\n' > scaled.as
+"$ASM" --rel scaled
+ls scaled.*
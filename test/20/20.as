@@ -0,0 +1,10 @@
+; assembled with --map, every address is traced back to its line
+macro once
+dec r2
+endm
+.include "lib/util.inc"
+MAIN: mov r1, r2
+ twice
+ once
+LIST: .data 5, 6
+ stop
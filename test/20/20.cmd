@@ -0,0 +1,4 @@
+"$ASM" --map 20
+for address in 100 103 104 106 108 110 112 113 114 115; do
+    "$ASM" --addr2line 20 $address
+done
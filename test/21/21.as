@@ -0,0 +1,11 @@
+; assembled with --sym, the symbols are listed by address and looked up by name
+.entry MAIN
+.extern LOG
+.equ LIMIT 12
+MAIN: mov #LIMIT, r1
+LOOP: jsr LOG
+ dec r1
+ bne LOOP
+ prn COUNT
+ stop
+COUNT: .data LIMIT
@@ -0,0 +1,3 @@
+"$ASM" --sym 21
+"$ASM" --nm 21
+"$ASM" --nm 21 LOOP LIMIT MISSING
@@ -0,0 +1,5 @@
+; archived with util.as, the directory finds the module of every entry
+.entry MAIN
+.extern HELPER
+MAIN: jsr HELPER
+ stop
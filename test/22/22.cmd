@@ -0,0 +1,6 @@
+"$ASM" 22 util
+"$ASM" --archive create 22.aar 22 util
+"$ASM" --archive list 22.aar
+"$ASM" --archive find 22.aar HELPER TABLE MAIN MISSING
+mkdir extracted && cd extracted
+"$ASM" --archive extract ../22.aar util.ob && cmp util.ob ../util.ob && echo "util.ob extracted"
@@ -0,0 +1,6 @@
+; the second module of test 22
+.entry HELPER
+.entry TABLE
+HELPER: inc r1
+ rts
+TABLE: .data 1, 2, 3
@@ -0,0 +1,11 @@
+; assembled with --alloc-stats, and with every one of its allocations
+; failing in turn with --fail-alloc
+.entry MAIN
+.extern LOG
+macro log
+jsr LOG
+endm
+MAIN: mov #23, r1
+ log
+ stop
+TEXT: .string "memory"
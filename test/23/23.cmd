@@ -0,0 +1,23 @@
+# the number of allocations of every subsystem (the bytes depend on the platform)
+"$ASM" --alloc-stats 23 2>&1 | awk '{ print $1, $2, $3 }'
+mkdir complete && mv 23.am 23.ob 23.ent 23.ext complete/
+# every allocation fails in turn, until there are fewer allocations than the number
+failing=1
+while :; do
+    "$ASM" --fail-alloc $failing 23 > output 2>&1
+    status=$?
+    if [ $status -eq 0 ] && ! grep -q "Memory allocation failed" output; then
+        break
+    fi
+    if [ $status -ne 1 ] || [ "$(cat output)" != "Memory allocation failed" ]; then
+        echo "allocation $failing: status $status"
+        cat output
+    fi
+    ls *.tmp 2> /dev/null
+    rm -f 23.am 23.ob 23.ent 23.ext
+    failing=$((failing + 1))
+done
+echo "every failed allocation was reported"
+for suffix in am ob ent ext; do
+    cmp 23.$suffix complete/23.$suffix || echo "23.$suffix differs"
+done
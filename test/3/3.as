@@ -0,0 +1,9 @@
+; assembled from stdin, the outputs are the sections of stdout
+.entry MAIN
+.extern PRINT
+MAIN: mov #3, r1
+LOOP: dec r1
+ jsr PRINT
+ bne LOOP
+ stop
+COUNT: .data 3, -1
@@ -0,0 +1 @@
+"$ASM" - < 3.as
@@ -0,0 +1,8 @@
+; built by a daemon that watches it, then rebuilt on request
+.entry MAIN
+.extern LOG
+MAIN: mov #4, r1
+LOOP: jsr LOG
+ dec r1
+ bne LOOP
+ stop
@@ -0,0 +1,12 @@
+"$ASM" --daemon asm.sock 4 > daemon.log &
+# the socket is bound before it listens, so the daemon is ready once a request succeeds
+tries=0
+until "$ASM" --request asm.sock watch 4 > /dev/null 2>&1 || [ $tries -eq 100 ]; do sleep 0.1; tries=$((tries + 1)); done
+"$ASM" --request asm.sock build 4
+"$ASM" --request asm.sock build bad
+"$ASM" --request asm.sock build missing
+"$ASM" --request asm.sock rebuild 4
+"$ASM" --request asm.sock shutdown
+wait
+cat daemon.log
+[ -S asm.sock ] || echo "the socket was removed"
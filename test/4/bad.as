@@ -0,0 +1,4 @@
+; the second file of test 4, its errors are sent to the client
+ mov #1, r9
+ jmp NOWHERE
+ stop
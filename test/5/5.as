@@ -0,0 +1,17 @@
+; assembled sequentially and with -p, the outputs must be the same
+.entry MAIN
+.entry TEXT
+.extern PUTC
+macro print
+ prn r1
+ jsr PUTC
+endm
+MAIN: lea TEXT, r1
+LOOP: inc r1
+ print
+ cmp r1, #LAST
+ bne LOOP
+ print
+ stop
+TEXT: .string "pipeline"
+LAST: .data 8, -8
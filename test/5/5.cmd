@@ -0,0 +1,10 @@
+"$ASM" 5 bad
+mkdir sequential && mv 5.am 5.ob 5.ent 5.ext sequential/
+"$ASM" -p 5 bad
+for suffix in am ob ent ext; do
+    cmp 5.$suffix sequential/5.$suffix || echo "5.$suffix differs with -p"
+done
+# the options that need all of the lines first turn the macro stage thread off
+mkdir options && cp 5.as options/ && cd options
+"$ASM" -p -O 5
+"$ASM" -p --map 5
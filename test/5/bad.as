@@ -0,0 +1,4 @@
+; the second file of test 5, its errors are the same in both modes
+MAIN: mov #1, NOWHERE
+MAIN: stop
+ .data x
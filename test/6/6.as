@@ -0,0 +1,6 @@
+; the start of a file that 6.cmd makes long enough for four chunks, its
+; labels are used across the chunks
+.entry MAIN
+.entry LAST
+.extern LOG
+MAIN: jmp LAST
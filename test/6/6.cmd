@@ -0,0 +1,20 @@
+# 1200 more lines, each pair refers to the previous pair and to labels of other chunks
+cp 6.as long.as
+i=1
+while [ $i -le 600 ]; do
+    echo "L$i: add #$i, r1" >> long.as
+    echo " jsr LOG" >> long.as
+    i=$((i + 1))
+done
+echo "LAST: prn L1" >> long.as
+echo " prn L600" >> long.as
+echo " stop" >> long.as
+echo "TABLE: .data 1, -1" >> long.as
+"$ASM" long
+mkdir sequential && mv long.am long.ob long.ent long.ext sequential/
+"$ASM" -j 4 long
+for suffix in am ob ent ext; do
+    cmp long.$suffix sequential/long.$suffix || echo "long.$suffix differs with -j 4"
+done
+wc -l < long.ob
+cat long.ent
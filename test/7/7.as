@@ -0,0 +1,7 @@
+; assembled with two other files, without and with -u
+.entry MAIN
+.extern SUM
+MAIN: mov #7, r1
+ jsr SUM
+ prn r1
+ stop
@@ -0,0 +1,7 @@
+"$ASM" 7 sum missing text
+mkdir sequential && mv *.am *.ob *.ent *.ext sequential/
+"$ASM" -u 7 sum missing text
+for output in sequential/*; do
+    cmp "${output#sequential/}" "$output" || echo "${output#sequential/} differs with -u"
+done
+ls *.am *.ob *.ent *.ext
@@ -0,0 +1,5 @@
+; the second file of test 7
+.entry SUM
+SUM: add TOTAL, r1
+ rts
+TOTAL: .data 35
@@ -0,0 +1,3 @@
+; the third file of test 7
+GREETING: .string "io_uring"
+ .data 1, 2, 3
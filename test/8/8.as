@@ -0,0 +1,4 @@
+; opened in the language server, then edited line by line
+MAIN: mov #1, r1
+ jmp NOWHERE
+ stop
@@ -0,0 +1,19 @@
+# sends every argument as a message with its Content-Length header
+send() {
+    for message in "$@"; do
+        printf 'Content-Length: %d\r\n\r\n%s' ${#message} "$message"
+    done
+}
+uri='"file:///test/8.as"'
+text=$(awk '{ printf "%s\\n", $0 }' 8.as)
+send '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}' \
+     '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":'"$uri"',"version":1,"text":"'"$text"'"}}}' \
+     '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":'"$uri"',"version":2},"contentChanges":[{"range":{"start":{"line":2,"character":5},"end":{"line":2,"character":12}},"text":"MAIN"}]}}' \
+     '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":'"$uri"',"version":3},"contentChanges":[{"range":{"start":{"line":3,"character":0},"end":{"line":3,"character":0}},"text":" bad r1\\n"}]}}' \
+     '{"jsonrpc":"2.0","id":2,"method":"hover","params":{}}' \
+     '{"jsonrpc":"2.0","id":3,"method":"shutdown"}' \
+     '{"jsonrpc":"2.0","method":"exit"}' > requests
+"$ASM" --lsp < requests > replies
+echo "exit status $?"
+# a reply per line, without the headers
+tr -d '\r' < replies | awk '{ gsub(/Content-Length: [0-9]+/, "\n"); print }' | grep .
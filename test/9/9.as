@@ -0,0 +1,11 @@
+; rebuilt by the daemon after every edit, only the changed lines are
+; encoded again
+.entry MAIN
+.entry COUNT
+.extern LOG
+MAIN: mov COUNT, r1
+LOOP: jsr LOG
+ dec r1
+ bne LOOP
+ stop
+COUNT: .data 3
@@ -0,0 +1,26 @@
+# builds 9.as with the daemon and from scratch, and compares the outputs
+compare() {
+    "$ASM" --request asm.sock build 9
+    mkdir -p full && cp 9.as full/ && (cd full && "$ASM" 9)
+    for suffix in ob ent ext; do
+        cmp 9.$suffix full/9.$suffix || echo "9.$suffix differs from a full build"
+    done
+}
+"$ASM" --daemon asm.sock 9 > daemon.log &
+# the socket is bound before it listens, so the daemon is ready once a request succeeds
+tries=0
+until "$ASM" --request asm.sock watch 9 > /dev/null 2>&1 || [ $tries -eq 100 ]; do sleep 0.1; tries=$((tries + 1)); done
+compare
+echo "a changed operand"
+sed 's/^ dec r1$/ sub #2, r1/' 9.as > edited && mv edited 9.as
+compare
+echo "inserted lines move the labels after them"
+awk '/^ stop$/ { print " prn r1"; print "END: inc r2" } { print }' 9.as > edited && mv edited 9.as
+compare
+echo "an error and its fix"
+sed 's/^ prn r1$/ prn NOWHERE/' 9.as > edited && mv edited 9.as
+"$ASM" --request asm.sock build 9
+sed 's/^ prn NOWHERE$/ prn COUNT/' 9.as > edited && mv edited 9.as
+compare
+"$ASM" --request asm.sock shutdown
+wait
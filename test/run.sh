@@ -0,0 +1,44 @@
+#!/bin/sh
+# assembles every test/N/N.as in a copy of its directory and compares the
+# outputs with the expected ones. N.args holds the options the file is
+# assembled with (the errors are compared with N.out if there is one) and
+# N.cmd replaces the assembly with commands, run with $ASM set to the
+# assembler, whose output is compared with N.out
+# usage: test/run.sh [assembler]
+
+ASM=$(cd "$(dirname "${1:-assembler}")" && pwd)/$(basename "${1:-assembler}")
+TESTS=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+OUTPUTS="am ob ent ext rel sym map out"
+failed=0
+
+export ASM
+for test in "$TESTS"/*/; do
+    n=$(basename "$test")
+    [ -f "$test$n.as" ] || continue
+    mkdir "$WORK/$n"
+    for file in "$test"*; do
+        case "$file" in
+        *.am|*.ob|*.ent|*.ext|*.rel|*.sym|*.map|*.out) ;;
+        *) cp -r "$file" "$WORK/$n/" ;;
+        esac
+    done
+
+    if [ -f "$test$n.cmd" ]; then
+        (cd "$WORK/$n" && sh "./$n.cmd" > "$n.out" 2>&1)
+    elif [ -f "$test$n.out" ]; then
+        (cd "$WORK/$n" && "$ASM" $(cat "$test$n.args" 2>/dev/null) "$n" > "$n.out" 2>&1)
+    else
+        (cd "$WORK/$n" && "$ASM" $(cat "$test$n.args" 2>/dev/null) "$n" > /dev/null 2>&1)
+    fi
+
+    for suffix in $OUTPUTS; do
+        if [ -f "$test$n.$suffix" ] || [ -f "$WORK/$n/$n.$suffix" ]; then
+            cmp -s "$test$n.$suffix" "$WORK/$n/$n.$suffix" || { echo "$n.$suffix differs"; failed=1; }
+        fi
+    done
+done
+
+rm -rf "$WORK"
+[ $failed = 0 ] && echo "all tests passed"
+exit $failed
\ No newline at end of file